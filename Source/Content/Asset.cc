@@ -37,6 +37,8 @@ Asset::Asset (quint16 assetID)
 	mReferences = 1;
 	mAssetID = assetID;
 	mManaged = false;
+
+	Content::Register (this);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,6 +50,17 @@ Asset::Asset (const Asset& asset)
 	mManaged = false;
 	mAssetID = asset.mAssetID;
 	mSource  = asset.mSource;
+
+	Content::Register (this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Asset::~Asset (void)
+{
+	// Invalidate outstanding handles
+	Content::Unregister (this);
 }
 
 
@@ -61,24 +74,23 @@ Asset::Asset (const Asset& asset)
 
 void Asset::Retain (void)
 {
-	++mReferences;
+	mReferences.ref();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
+/// <remarks> Destruction is deferred until Content::Collect. </remarks>
 
 void Asset::Release (bool force)
 {
-	// Check if the asset needs to be deleted
-	if (force || mReferences == 1)
+	// Forcing only disposes of assets which are still alive
+	if (force)
 	{
-		// Asset is managed by the content manager
-		if (mManaged) Content::mLoaded.remove (mSource);
-
-		// Delete asset
-		delete this;
+		if (mReferences.fetchAndStoreOrdered (0) > 0)
+			Content::Dispose (this);
 	}
 
-	// Decrement references
-	else --mReferences;
+	// The last reference disposes of the asset
+	else if (!mReferences.deref())
+		Content::Dispose (this);
 }
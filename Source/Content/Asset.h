@@ -15,6 +15,7 @@
 #define CONTENT_ASSET_H
 
 #include <QString.h>
+#include <QAtomic.h>
 
 
 
@@ -56,12 +57,18 @@ public:
 	Asset (const Asset& asset);
 
 protected:
-	virtual ~Asset (void) { }
+	virtual ~Asset (void);
+
+	// Drops references held to other assets
+	virtual void	ReleaseDependencies	(void) { }
 
 public:
 	// Methods
 	quint16			GetAssetID		(void) const { return mAssetID;		}
-	quint16			GetReferences	(void) const { return mReferences;	}
+	quint32			GetReferences	(void) const { return mReferences;	}
+
+	quint32			GetHandle		(void) const { return mHandle;		}
+	quint32			GetGeneration	(void) const { return mGeneration;	}
 
 	void			Retain			(void);
 	void			Release			(bool force = false);
@@ -77,10 +84,14 @@ protected:
 	// Fields
 	bool			mManaged;		// Asset is managed
 	quint16			mAssetID;		// Asset type ID
-	quint16			mReferences;	// References to this asset
+	QAtomicInt		mReferences;	// References to this asset
 	QString			mSource;		// Source of this asset
 
 private:
+	// Slot in the content handle table
+	quint32			mHandle;
+	quint32			mGeneration;
+
 	// State of the asset ID generator
 	static quint16	mAssetIDCounter;
 
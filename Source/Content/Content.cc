@@ -36,6 +36,12 @@
 
 QMap<QString, Asset*> Content::mLoaded;
 
+QVector<Content::Slot> Content::mSlots;
+QVector<quint32> Content::mFreeSlots;
+
+QList<Asset*> Content::mDisposed;
+QMutex Content::mMutex;
+
 
 
 //----------------------------------------------------------------------------//
@@ -48,15 +54,25 @@ QMap<QString, Asset*> Content::mLoaded;
 Asset* Content::Load (const QString& filename)
 {
 	// Check if asset was previously loaded
+	mMutex.lock();
 	Asset* asset = mLoaded.value (filename);
 
 	if (asset != nullptr)
 	{
-		// Return loaded asset
-		asset->mReferences += 1;
-		return asset;
+		// Don't revive assets which are waiting to be deleted
+		for (int refs = asset->mReferences; refs > 0; refs = asset->mReferences)
+		{
+			if (asset->mReferences.testAndSetOrdered (refs, refs + 1))
+			{
+				// Return loaded asset
+				mMutex.unlock();
+				return asset;
+			}
+		}
 	}
 
+	mMutex.unlock();
+
 	// Get information about the file
 	QString file = filename;
 	QFileInfo info (file);
@@ -96,7 +112,10 @@ Asset* Content::Load (const QString& filename)
 	// Add asset to the list
 	asset->mSource  = filename;
 	asset->mManaged = true;
+
+	mMutex.lock();
 	mLoaded.insert (filename, asset);
+	mMutex.unlock();
 
 	// All done
 	return asset;
@@ -105,6 +124,28 @@ Asset* Content::Load (const QString& filename)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
+Asset* Content::Load (const QString& filename, quint16 assetID)
+{
+	// Attempt to load the asset
+	Asset* asset = Load (filename);
+	if (asset == nullptr) return nullptr;
+
+	// Verify the type of the asset
+	if (asset->mAssetID != assetID)
+	{
+		asset->Release();
+
+		Console::Error ("Asset has an unexpected type: %s",
+			filename.toAscii().data());
+		return nullptr;
+	}
+
+	return asset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
 bool Content::Process (const QString& filename)
 {
 	// Get information about the file
@@ -237,11 +278,72 @@ Asset* Content::Reload (Asset* asset)
 
 void Content::UnloadAll (void)
 {
-	// Delete all loaded assets
-	foreach (Asset* asset, mLoaded)
-		delete asset;
+	// Delete released assets
+	Collect();
 
+	mMutex.lock();
+	QList<Asset*> remaining = mLoaded.values();
 	mLoaded.clear();
+	mMutex.unlock();
+
+	if (!remaining.isEmpty())
+		Console::Warning ("%d assets are still referenced", remaining.size());
+
+	// Handles expire when an asset is deleted
+	QList<AssetHandle<Asset> > handles;
+	foreach (Asset* asset, remaining)
+		handles.append (AssetHandle<Asset> (asset));
+
+	// Break references between assets first so that
+	// the order they are deleted in no longer matters
+	foreach (const AssetHandle<Asset>& handle, handles)
+	{
+		Asset* asset = handle.Get();
+		if (asset != nullptr) asset->ReleaseDependencies();
+	}
+
+	// Forcing only disposes of assets which are not yet queued
+	foreach (const AssetHandle<Asset>& handle, handles)
+	{
+		Asset* asset = handle.Get();
+		if (asset != nullptr) asset->Release (true);
+	}
+
+	Collect();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Asset* Content::Resolve (quint32 handle, quint32 generation)
+{
+	QMutexLocker locker (&mMutex);
+
+	// Check that the handle still refers to the same asset
+	if (handle >= (quint32) mSlots.size()) return nullptr;
+	const Slot& slot = mSlots[handle];
+	return slot.Generation == generation ? slot.Target : nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// <remarks> Must be called from the thread which owns the GL context. </remarks>
+
+void Content::Collect (void)
+{
+	forever
+	{
+		mMutex.lock();
+		QList<Asset*> disposed = mDisposed;
+		mDisposed.clear();
+		mMutex.unlock();
+
+		if (disposed.isEmpty()) break;
+
+		// Deleting an asset may release others
+		foreach (Asset* asset, disposed)
+			delete asset;
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -267,3 +369,67 @@ Processor* Content::FindProcessor (const QString& extension)
 	// None found
 	return nullptr;
 }
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                           Content //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Content::Register (Asset* asset)
+{
+	QMutexLocker locker (&mMutex);
+
+	// Reuse a free slot if one is available
+	if (mFreeSlots.isEmpty())
+	{
+		Slot slot;
+		slot.Target = nullptr;
+		slot.Generation = 1;
+
+		mFreeSlots.append (mSlots.size());
+		mSlots.append (slot);
+	}
+
+	asset->mHandle = mFreeSlots.last();
+	mFreeSlots.removeLast();
+
+	mSlots[asset->mHandle].Target = asset;
+	asset->mGeneration = mSlots[asset->mHandle].Generation;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Content::Unregister (Asset* asset)
+{
+	QMutexLocker locker (&mMutex);
+
+	// Expire all handles to the slot
+	Slot& slot = mSlots[asset->mHandle];
+	slot.Target = nullptr;
+	++slot.Generation;
+
+	mFreeSlots.append (asset->mHandle);
+
+	// Asset may have been deleted without being released
+	if (asset->mManaged && mLoaded.value (asset->mSource) == asset)
+		mLoaded.remove (asset->mSource);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Content::Dispose (Asset* asset)
+{
+	QMutexLocker locker (&mMutex);
+
+	// Stop handing out the asset
+	if (asset->mManaged && mLoaded.value (asset->mSource) == asset)
+		mLoaded.remove (asset->mSource);
+
+	mDisposed.append (asset);
+}
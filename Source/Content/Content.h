@@ -14,11 +14,15 @@
 #ifndef CONTENT_H
 #define CONTENT_H
 
-class Asset;
 class Processor;
 class QString;
 
+#include "Content/Asset.h"
+
 #include <QMap.h>
+#include <QList.h>
+#include <QMutex.h>
+#include <QVector.h>
 
 
 
@@ -26,6 +30,9 @@ class QString;
 // Classes                                                                    //
 //----------------------------------------------------------------------------//
 
+template <class T>
+class AssetHandle;
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
@@ -42,16 +49,103 @@ private:
 public:
 	// Static
 	static Asset*		Load			(const QString& filename);
+	static Asset*		Load			(const QString& filename, quint16 assetID);
 	static bool			Process			(const QString& filename);
 
+	template <class T>
+	static AssetHandle<T> Load			(const QString& filename);
+
 	static Asset*		Reload			(Asset* asset);
 	static void			UnloadAll		(void);
 
+	static Asset*		Resolve			(quint32 handle, quint32 generation);
+	static void			Collect			(void);
+
 	static Processor*	FindProcessor	(const QString& extension);
 
+private:
+	// Internal
+	static void			Register		(Asset* asset);
+	static void			Unregister		(Asset* asset);
+	static void			Dispose			(Asset* asset);
+
+private:
+	// Types
+	struct Slot
+	{
+		Asset*	Target;			// Asset occupying the slot
+		quint32	Generation;		// Incremented when the slot is freed
+	};
+
 private:
 	// Map of all currently loaded assets
 	static QMap<QString, Asset*> mLoaded;
+
+	// Generational handle table
+	static QVector<Slot> mSlots;
+	static QVector<quint32> mFreeSlots;
+
+	// Assets waiting to be deleted
+	static QList<Asset*> mDisposed;
+
+	// Guards all of the above
+	static QMutex mMutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Weak reference which expires when the asset is deleted. </summary>
+
+template <class T>
+class AssetHandle
+{
+public:
+	// Constructors
+	AssetHandle (void) : mHandle (0), mGeneration (0) { }
+
+	AssetHandle (T* asset) :
+		mHandle     (asset == nullptr ? 0 : asset->GetHandle    ()),
+		mGeneration (asset == nullptr ? 0 : asset->GetGeneration()) { }
+
+public:
+	// Methods
+	T*		Get			(void) const { return static_cast<T*> (Content::Resolve (mHandle, mGeneration)); }
+	bool	IsValid		(void) const { return Get() != nullptr; }
+
+	void	Release		(void)
+	{
+		// Release the asset if it's still alive
+		T* asset = Get();
+		if (asset != nullptr)
+			asset->Release();
+
+		mHandle     = 0;
+		mGeneration = 0;
+	}
+
+public:
+	// Operators
+	T*		operator ->	(void) const { return Get(); }
+			operator T*	(void) const { return Get(); }
+
+private:
+	// Fields
+	quint32	mHandle;		// Slot in the handle table
+	quint32	mGeneration;	// Generation of the slot
 };
 
+
+
+//----------------------------------------------------------------------------//
+// Static                                                             Content //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Loads an asset and verifies that it's of type T. </summary>
+
+template <class T>
+AssetHandle<T> Content::Load (const QString& filename)
+{
+	return AssetHandle<T> (static_cast<T*> (Load (filename, T::AssetID)));
+}
+
 #endif // CONTENT_H
@@ -22,8 +22,40 @@
 #include "Graphics/Model.h"
 #include "Graphics/Material.h"
 #include "Graphics/Texture.h"
+#include "Graphics/Skeleton.h"
+#include "Graphics/Animation.h"
 
 #include <QIODevice.h>
+#include <QBuffer.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Types                                                                      //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Chunks are optional and follow the physics mesh, unknown chunks are skipped
+
+static enum ModelChunks
+{
+	SubsetChunk			= 10,
+	SkeletonChunk		= 20,
+	AnimationChunk		= 30,
+	BoundsChunk			= 40,
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+#pragma pack (push, 1)
+struct ChunkHeader
+{
+	quint16 Type;			// Chunk data type
+	quint32 Length;			// Chunk data length
+};
+#pragma pack (pop)
 
 
 
@@ -146,6 +178,415 @@ static bool ExportMesh (QIODevice& device, const Mesh* mesh)
 
 
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static bool ReadName (QIODevice& device, QString& name)
+{
+	quint8 length = 0;
+	if (device.read ((char*) &length, sizeof (quint8)) != sizeof (quint8))
+		return false;
+
+	QByteArray data = device.read (length);
+	if (data.length() != length) return false;
+
+	name = QString (data);
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void WriteName (QIODevice& device, const QString& name)
+{
+	QByteArray data = name.toAscii().left (255);
+	quint8 length = data.length();
+
+	device.write ((char*) &length, sizeof (quint8));
+	device.write (data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static bool ImportSubsets (QIODevice& device, Model* model)
+{
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		Mesh* mesh = model->Meshes[i];
+		mesh->Subsets.clear();
+
+		// Read the number of subsets
+		quint32 subsetCount = 0;
+		if (device.read ((char*) &subsetCount, sizeof (quint32)) != sizeof (quint32))
+		{
+			Console::Error ("Unable to read mesh subset count");
+			return false;
+		}
+
+		for (quint32 j = 0; j < subsetCount; ++j)
+		{
+			Mesh::Subset subset;
+
+			// Read the subset range, name and bounds
+			if (device.read ((char*) &subset.IndexOffset, sizeof (quint32)) != sizeof (quint32) ||
+				device.read ((char*) &subset.IndexCount,  sizeof (quint32)) != sizeof (quint32) ||
+				!ReadName (device, subset.Name) ||
+				device.read ((char*) &subset.Bounds, sizeof (BoundingBox)) != sizeof (BoundingBox))
+			{
+				Console::Error ("Unable to read mesh subset");
+				return false;
+			}
+
+			mesh->Subsets.append (subset);
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportSubsets (QIODevice& device, const Model* model)
+{
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		const Mesh* mesh = model->Meshes[i];
+
+		// Write the number of subsets
+		quint32 subsetCount = mesh->Subsets.length();
+		device.write ((char*) &subsetCount, sizeof (quint32));
+
+		foreach (const Mesh::Subset& subset, mesh->Subsets)
+		{
+			// Write the subset range, name and bounds
+			device.write ((char*) &subset.IndexOffset, sizeof (quint32));
+			device.write ((char*) &subset.IndexCount,  sizeof (quint32));
+			WriteName (device, subset.Name);
+			device.write ((char*) &subset.Bounds, sizeof (BoundingBox));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static bool ImportSkeleton (QIODevice& device, Model* model)
+{
+	// Read the number of bones
+	quint16 boneCount = 0;
+	if (device.read ((char*) &boneCount, sizeof (quint16)) != sizeof (quint16))
+	{
+		Console::Error ("Unable to read skeleton bone count");
+		return false;
+	}
+
+	Skeleton* skeleton = new Skeleton();
+	model->SetSkeleton (skeleton);
+
+	for (quint16 i = 0; i < boneCount; ++i)
+	{
+		Skeleton::Bone bone;
+
+		// Read the bone name, parent and transforms
+		if (!ReadName (device, bone.Name) ||
+			device.read ((char*) &bone.Parent,      sizeof (qint32)) != sizeof (qint32) ||
+			device.read ((char*) &bone.Transform,   sizeof (Matrix)) != sizeof (Matrix) ||
+			device.read ((char*) &bone.BindInverse, sizeof (Matrix)) != sizeof (Matrix))
+		{
+			Console::Error ("Unable to read skeleton bone");
+			return false;
+		}
+
+		skeleton->Bones.append (bone);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportSkeleton (QIODevice& device, const Skeleton* skeleton)
+{
+	// Write the number of bones
+	quint16 boneCount = skeleton->Bones.length();
+	device.write ((char*) &boneCount, sizeof (quint16));
+
+	foreach (const Skeleton::Bone& bone, skeleton->Bones)
+	{
+		// Write the bone name, parent and transforms
+		WriteName (device, bone.Name);
+		device.write ((char*) &bone.Parent,      sizeof (qint32));
+		device.write ((char*) &bone.Transform,   sizeof (Matrix));
+		device.write ((char*) &bone.BindInverse, sizeof (Matrix));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static bool ImportAnimations (QIODevice& device, Model* model)
+{
+	// Read the number of animations
+	quint16 animationCount = 0;
+	if (device.read ((char*) &animationCount, sizeof (quint16)) != sizeof (quint16))
+	{
+		Console::Error ("Unable to read animation count");
+		return false;
+	}
+
+	for (quint16 i = 0; i < animationCount; ++i)
+	{
+		Animation* animation = new Animation();
+		model->Animations.Add (animation);
+
+		// Read the animation header
+		quint16 trackCount = 0;
+		if (!ReadName (device, animation->Name) ||
+			device.read ((char*) &animation->Duration, sizeof (float  )) != sizeof (float  ) ||
+			device.read ((char*) &trackCount,          sizeof (quint16)) != sizeof (quint16))
+		{
+			Console::Error ("Unable to read animation header");
+			return false;
+		}
+
+		for (quint16 j = 0; j < trackCount; ++j)
+		{
+			Animation::Track track;
+
+			// Read the track header
+			quint32 keyframeCount = 0;
+			if (device.read ((char*) &track.Bone,    sizeof (qint32 )) != sizeof (qint32 ) ||
+				device.read ((char*) &keyframeCount, sizeof (quint32)) != sizeof (quint32))
+			{
+				Console::Error ("Unable to read animation track");
+				return false;
+			}
+
+			// Read the keyframes
+			track.Keyframes.resize (keyframeCount);
+			qint64 length = keyframeCount * sizeof (Animation::Keyframe);
+
+			if (device.read ((char*) track.Keyframes.data(), length) != length)
+			{
+				Console::Error ("Unable to read animation keyframes");
+				return false;
+			}
+
+			animation->Tracks.append (track);
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportAnimations (QIODevice& device, const Model* model)
+{
+	// Write the number of animations
+	quint16 animationCount = model->Animations.Length();
+	device.write ((char*) &animationCount, sizeof (quint16));
+
+	for (quint16 i = 0; i < animationCount; ++i)
+	{
+		const Animation* animation = model->Animations[i];
+
+		// Write the animation header
+		quint16 trackCount = animation->Tracks.length();
+		WriteName (device, animation->Name);
+		device.write ((char*) &animation->Duration, sizeof (float  ));
+		device.write ((char*) &trackCount,          sizeof (quint16));
+
+		foreach (const Animation::Track& track, animation->Tracks)
+		{
+			// Write the track header
+			quint32 keyframeCount = track.Keyframes.size();
+			device.write ((char*) &track.Bone,    sizeof (qint32 ));
+			device.write ((char*) &keyframeCount, sizeof (quint32));
+
+			// Write the keyframes
+			device.write ((char*) track.Keyframes.constData(),
+				keyframeCount * sizeof (Animation::Keyframe));
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static bool ImportBounds (QIODevice& device, Model* model)
+{
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		Mesh* mesh = model->Meshes[i];
+
+		// Read the bounding box and sphere
+		if (device.read ((char*) &mesh->Bounds, sizeof (BoundingBox   )) != sizeof (BoundingBox   ) ||
+			device.read ((char*) &mesh->Sphere, sizeof (BoundingSphere)) != sizeof (BoundingSphere))
+		{
+			Console::Error ("Unable to read mesh bounds");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportBounds (QIODevice& device, const Model* model)
+{
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		const Mesh* mesh = model->Meshes[i];
+
+		// Write the bounding box and sphere
+		device.write ((char*) &mesh->Bounds, sizeof (BoundingBox   ));
+		device.write ((char*) &mesh->Sphere, sizeof (BoundingSphere));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Meshes are left without bounds when no bounds chunk was found
+
+static bool ImportChunks (QIODevice& device, Model* model, bool& hasBounds)
+{
+	hasBounds = false;
+
+	// Chunks are optional
+	while (!device.atEnd())
+	{
+		ChunkHeader header;
+		if (device.read ((char*) &header, sizeof (ChunkHeader)) != sizeof (ChunkHeader))
+		{
+			Console::Error ("Unable to read model chunk header");
+			return false;
+		}
+
+		// Read the chunk data
+		QByteArray data = device.read (header.Length);
+		if ((quint32) data.length() != header.Length)
+		{
+			Console::Error ("Unable to read model chunk");
+			return false;
+		}
+
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::ReadOnly);
+
+		// Chunk contains mesh subsets
+		if (header.Type == SubsetChunk)
+		{
+			if (!ImportSubsets (buffer, model))
+				return false;
+		}
+
+		// Chunk contains the skeleton
+		else if (header.Type == SkeletonChunk)
+		{
+			if (!ImportSkeleton (buffer, model))
+				return false;
+		}
+
+		// Chunk contains animation clips
+		else if (header.Type == AnimationChunk)
+		{
+			if (!ImportAnimations (buffer, model))
+				return false;
+		}
+
+		// Chunk contains mesh bounds
+		else if (header.Type == BoundsChunk)
+		{
+			if (!ImportBounds (buffer, model))
+				return false;
+
+			hasBounds = true;
+		}
+
+		// Skip unknown chunks
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportChunk (QIODevice& device, quint16 type, const QByteArray& data)
+{
+	ChunkHeader header;
+	header.Type   = type;
+	header.Length = data.length();
+
+	device.write ((char*) &header, sizeof (ChunkHeader));
+	device.write (data);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ExportChunks (QIODevice& device, const Model* model)
+{
+	// Check if any mesh has subsets
+	bool hasSubsets = false;
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+		if (!model->Meshes[i]->Subsets.isEmpty())
+			hasSubsets = true;
+
+	// Write the subset chunk
+	if (hasSubsets)
+	{
+		QByteArray data;
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::WriteOnly);
+
+		ExportSubsets (buffer, model);
+		ExportChunk (device, SubsetChunk, data);
+	}
+
+	// Write the skeleton chunk
+	if (model->GetSkeleton() != nullptr)
+	{
+		QByteArray data;
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::WriteOnly);
+
+		ExportSkeleton (buffer, model->GetSkeleton());
+		ExportChunk (device, SkeletonChunk, data);
+	}
+
+	// Write the animation chunk
+	if (!model->Animations.IsEmpty())
+	{
+		QByteArray data;
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::WriteOnly);
+
+		ExportAnimations (buffer, model);
+		ExportChunk (device, AnimationChunk, data);
+	}
+
+	// Write the bounds chunk
+	if (!model->Meshes.IsEmpty())
+	{
+		QByteArray data;
+		QBuffer buffer (&data);
+		buffer.open (QIODevice::WriteOnly);
+
+		ExportBounds (buffer, model);
+		ExportChunk (device, BoundsChunk, data);
+	}
+}
+
+
+
 //----------------------------------------------------------------------------//
 // Internal                                                      AstProcessor //
 //----------------------------------------------------------------------------//
@@ -195,7 +636,7 @@ Asset* AstProcessor::ImportModel (QIODevice& device, Asset* asset)
 			if (!managed) model->Release(); return nullptr;
 		}
 
-		Texture* texture = (Texture*) Content::Load (QString (filename));
+		Texture* texture = Content::Load<Texture> (QString (filename));
 		model->Textures.Add (texture);
 
 		if (texture == nullptr)
@@ -261,6 +702,21 @@ Asset* AstProcessor::ImportModel (QIODevice& device, Asset* asset)
 		model->SetPhysicsMesh (mesh);
 	}
 
+	// Read optional chunks
+	bool hasBounds = false;
+	if (!ImportChunks (device, model, hasBounds))
+	{
+		Console::Error ("Unable to read model chunks");
+		if (!managed) model->Release(); return nullptr;
+	}
+
+	// Older files don't store bounds
+	if (!hasBounds)
+	{
+		for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+			model->Meshes[i]->ComputeBounds();
+	}
+
 	return model;
 }
 
@@ -325,5 +781,8 @@ bool AstProcessor::ExportModel (QIODevice& device, const Asset* asset)
 		return false;
 	}
 
+	// Write optional chunks
+	ExportChunks (device, model);
+
 	return true;
 }
@@ -112,8 +112,11 @@ Asset* AstProcessor::ImportParticleSystem (QIODevice& device, Asset* asset)
 		if (!managed) system->Release(); return nullptr;
 	}
 
-	Texture* texture = (Texture*) Content::Load (QString (filename));
+	// The system retains its own reference
+	AssetHandle<Texture> texture = Content::Load<Texture> (QString (filename));
+
 	system->SetTexture (texture);
+	texture.Release();
 
 	return system;
 }
@@ -61,6 +61,35 @@ Asset* AstProcessor::ImportShader (QIODevice& device, Asset* asset)
 		if (!managed) shader->Release(); return nullptr;
 	}
 
+	// Older shaders end without varyings
+	if (device.atEnd()) return shader;
+
+	quint32 varyingCount = 0;
+	if (device.read ((char*) &varyingCount, sizeof (quint32)) != sizeof (quint32))
+	{
+		Console::Error ("Error reading varying count");
+		if (!managed) shader->Release(); return nullptr;
+	}
+
+	for (quint32 i = 0; i < varyingCount; ++i)
+	{
+		quint32 length = 0;
+		if (device.read ((char*) &length, sizeof (quint32)) != sizeof (quint32))
+		{
+			Console::Error ("Error reading varying");
+			if (!managed) shader->Release(); return nullptr;
+		}
+
+		QByteArray name = device.read (length);
+		if ((quint32) name.length() != length)
+		{
+			Console::Error ("Error reading varying");
+			if (!managed) shader->Release(); return nullptr;
+		}
+
+		shader->Varyings << name;
+	}
+
 	return shader;
 }
 
@@ -90,5 +119,16 @@ bool AstProcessor::ExportShader (QIODevice& device, const Asset* asset)
 	device.write (vert);
 	device.write (frag);
 
+	// Write transform feedback outputs
+	quint32 varyingCount = shader->Varyings.size();
+	device.write ((char*) &varyingCount, sizeof (quint32));
+
+	for (quint32 i = 0; i < varyingCount; ++i)
+	{
+		quint32 length = shader->Varyings[i].length();
+		device.write ((char*) &length, sizeof (quint32));
+		device.write (shader->Varyings[i]);
+	}
+
 	return true;
 }
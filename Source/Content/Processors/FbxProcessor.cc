@@ -11,6 +11,7 @@
 // Prefaces                                                                   //
 //----------------------------------------------------------------------------//
 
+#include <cstring>
 #include "FbxProcessor.h"
 
 #include "Graphics/Mesh.h"
@@ -18,26 +19,378 @@
 #include "Graphics/Texture.h"
 #include "Graphics/Vertex.h"
 #include "Graphics/Material.h"
+#include "Graphics/Skeleton.h"
+#include "Graphics/Animation.h"
 
+#include "Math/Matrix.h"
 #include "Math/Vector2.h"
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
+#include "Math/Quaternion.h"
 
 #include "Engine/Console.h"
 #include "Content/Content.h"
 
 #include <QFile.h>
+#include <QSet.h>
+#include <QHash.h>
+#include <QVector.h>
 #include <QFileInfo.h>
+#include <QtConcurrentMap.h>
 
 #define FBXSDK_NEW_API
 #include <fbxsdk.h>
 
 
 
+//----------------------------------------------------------------------------//
+// Types                                                                      //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+typedef QHash<FbxNode*, qint32> BoneMap;
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+struct Influence
+{
+	float Indices[4];	// Strongest bone indices
+	float Weights[4];	// Matching bone weights
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static const double AnimationRate = 30.0;
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+struct MeshJob
+{
+	FbxNode*	Node;		// Scene node in walk order
+	FbxMesh*	Source;		// Mesh to convert or null
+	Mesh*		Result;		// Converted mesh
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Read locked view of a layer element for bulk access
+
+template <class T>
+class LayerArray
+{
+public:
+	//----------------------------------------------------------------------------//
+	// Constructors                                                               //
+	//----------------------------------------------------------------------------//
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	LayerArray (FbxLayerElementTemplate<T>* element)
+	{
+		mElement = element;
+		mDirect  = nullptr;
+		mIndices = nullptr;
+		mMapping = FbxLayerElement::eNone;
+
+		if (mElement == nullptr) return;
+		mMapping = mElement->GetMappingMode();
+		if (mMapping == FbxLayerElement::eNone) return;
+
+		// Lock the direct and index arrays
+		mDirect = mElement->GetDirectArray().GetLocked (FbxLayerElementArray::eReadLock);
+
+		if (mElement->GetReferenceMode() != FbxLayerElement::eDirect)
+			mIndices = mElement->GetIndexArray().GetLocked (FbxLayerElementArray::eReadLock);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	~LayerArray (void)
+	{
+		if (mDirect  != nullptr) mElement->GetDirectArray().Release (&mDirect );
+		if (mIndices != nullptr) mElement->GetIndexArray ().Release (&mIndices);
+	}
+
+public:
+	//----------------------------------------------------------------------------//
+	// Methods                                                                    //
+	//----------------------------------------------------------------------------//
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	bool IsValid (void) const { return mDirect != nullptr; }
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	FbxLayerElement::EMappingMode GetMappingMode (void) const { return mMapping; }
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	const T& Get (qint32 controlPoint, qint32 polygonVertex, qint32 polygon) const
+	{
+		qint32 index = 0;
+		switch (mMapping)
+		{
+			case FbxLayerElement::eByControlPoint : index = controlPoint;  break;
+			case FbxLayerElement::eByPolygonVertex: index = polygonVertex; break;
+			case FbxLayerElement::eByPolygon      : index = polygon;       break;
+		}
+
+		return mDirect[mIndices != nullptr ? mIndices[index] : index];
+	}
+
+private:
+	//----------------------------------------------------------------------------//
+	// Fields                                                                     //
+	//----------------------------------------------------------------------------//
+
+	FbxLayerElementTemplate<T>*		mElement;	// Source layer element
+	FbxLayerElement::EMappingMode	mMapping;	// Element mapping mode
+
+	T*								mDirect;	// Locked direct array
+	int*							mIndices;	// Locked index array
+};
+
+
+
 //----------------------------------------------------------------------------//
 // Internal                                                                   //
 //----------------------------------------------------------------------------//
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// FBX matrices store translation in the fourth row
+
+static Matrix ConvertMatrix (const FbxAMatrix& m)
+{
+	return Matrix
+	(
+		(float) m[0][0], (float) m[1][0], (float) m[2][0], (float) m[3][0],
+		(float) m[0][1], (float) m[1][1], (float) m[2][1], (float) m[3][1],
+		(float) m[0][2], (float) m[1][2], (float) m[2][2], (float) m[3][2],
+		(float) m[0][3], (float) m[1][3], (float) m[2][3], (float) m[3][3]
+	);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void LoadSkeleton (Model* model, FbxNode* fbxNode, qint32 parent, BoneMap& bones)
+{
+	const FbxNodeAttribute* fbxAttribute = fbxNode->GetNodeAttribute();
+	if (fbxAttribute != nullptr && fbxAttribute->GetAttributeType() == FbxNodeAttribute::eSkeleton)
+	{
+		// Create the skeleton on the first bone
+		if (model->GetSkeleton() == nullptr)
+			model->SetSkeleton (new Skeleton());
+
+		Skeleton* skeleton = model->GetSkeleton();
+
+		Skeleton::Bone bone;
+		bone.Name        = fbxNode->GetName();
+		bone.Parent      = parent;
+		bone.Transform   = ConvertMatrix (fbxNode->EvaluateLocalTransform());
+		bone.BindInverse = Matrix::Invert (ConvertMatrix (fbxNode->EvaluateGlobalTransform()));
+
+		// Children reference this bone
+		parent = skeleton->Bones.length();
+		bones.insert (fbxNode, parent);
+		skeleton->Bones.append (bone);
+	}
+
+	// Load children nodes recursively
+	const qint32 childCount = fbxNode->GetChildCount();
+	for (qint32 i = 0; i < childCount; ++i)
+		LoadSkeleton (model, fbxNode->GetChild (i), parent, bones);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns the transform of a mesh when it was bound to the skeleton. </summary>
+
+static FbxAMatrix GetBindShape (FbxMesh* fbxMesh)
+{
+	FbxAMatrix fbxMeshBind;
+	if (fbxMesh->GetDeformerCount (FbxDeformer::eSkin) == 0)
+		return fbxMeshBind;
+
+	FbxSkin* fbxSkin = (FbxSkin*) fbxMesh->GetDeformer (0, FbxDeformer::eSkin);
+	if (fbxSkin->GetClusterCount() > 0)
+		fbxSkin->GetCluster (0)->GetTransformMatrix (fbxMeshBind);
+
+	return fbxMeshBind;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Skinned vertices have the bind shape baked in, so the inverse bind
+/// pose only depends on the bone and every mesh agrees on it
+
+static void LoadBindPose (Model* model, FbxMesh* fbxMesh, const BoneMap& bones)
+{
+	Skeleton* skeleton = model->GetSkeleton();
+	if (skeleton == nullptr || fbxMesh->GetDeformerCount (FbxDeformer::eSkin) == 0)
+		return;
+
+	FbxSkin* fbxSkin = (FbxSkin*) fbxMesh->GetDeformer (0, FbxDeformer::eSkin);
+	const qint32 clusterCount = fbxSkin->GetClusterCount();
+
+	for (qint32 i = 0; i < clusterCount; ++i)
+	{
+		FbxCluster* fbxCluster = fbxSkin->GetCluster (i);
+
+		// Find the bone of this cluster
+		qint32 bone = bones.value (fbxCluster->GetLink(), -1);
+		if (bone < 0) continue;
+
+		// Compute the inverse bind pose of the bone
+		FbxAMatrix fbxLinkBind;
+		fbxCluster->GetTransformLinkMatrix (fbxLinkBind);
+
+		skeleton->Bones[bone].BindInverse =
+			ConvertMatrix (fbxLinkBind.Inverse());
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Keeps the four strongest influences of every control point
+
+static bool LoadSkin (FbxMesh* fbxMesh, const BoneMap&
+	bones, QVector<Influence>& influences)
+{
+	if (bones.isEmpty() || fbxMesh->GetDeformerCount (FbxDeformer::eSkin) == 0)
+		return false;
+
+	Influence empty = { { 0, 0, 0, 0 }, { 0, 0, 0, 0 } };
+	influences.fill (empty, fbxMesh->GetControlPointsCount());
+
+	FbxSkin* fbxSkin = (FbxSkin*) fbxMesh->GetDeformer (0, FbxDeformer::eSkin);
+	const qint32 clusterCount = fbxSkin->GetClusterCount();
+
+	for (qint32 i = 0; i < clusterCount; ++i)
+	{
+		FbxCluster* fbxCluster = fbxSkin->GetCluster (i);
+
+		// Find the bone of this cluster
+		qint32 bone = bones.value (fbxCluster->GetLink(), -1);
+		if (bone < 0) continue;
+
+		const qint32  count   = fbxCluster->GetControlPointIndicesCount();
+		const int*    points  = fbxCluster->GetControlPointIndices();
+		const double* weights = fbxCluster->GetControlPointWeights();
+
+		for (qint32 j = 0; j < count; ++j)
+		{
+			if (points[j] < 0 || points[j] >= influences.size()) continue;
+			Influence& influence = influences[points[j]];
+
+			// Replace the weakest influence
+			qint32 weakest = 0;
+			for (qint32 k = 1; k < 4; ++k)
+				if (influence.Weights[k] < influence.Weights[weakest]) weakest = k;
+
+			if (weights[j] > influence.Weights[weakest])
+			{
+				influence.Indices[weakest] = (float) bone;
+				influence.Weights[weakest] = (float) weights[j];
+			}
+		}
+	}
+
+	// Normalize the influence weights
+	for (qint32 i = 0; i < influences.size(); ++i)
+	{
+		Influence& influence = influences[i];
+		float total = influence.Weights[0] + influence.Weights[1] +
+					  influence.Weights[2] + influence.Weights[3];
+
+		if (total > 0)
+			for (qint32 k = 0; k < 4; ++k)
+				influence.Weights[k] /= total;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void LoadAnimations (Model* model, FbxScene* fbxScene, const BoneMap& bones)
+{
+	if (model->GetSkeleton() == nullptr) return;
+	const qint32 stackCount = fbxScene->GetSrcObjectCount (FbxAnimStack::ClassId);
+
+	for (qint32 i = 0; i < stackCount; ++i)
+	{
+		FbxAnimStack* fbxStack = fbxScene->GetSrcObject (FBX_TYPE (FbxAnimStack), i);
+		if (fbxStack == nullptr) continue;
+
+		// Evaluate nodes using this animation stack
+		fbxScene->SetCurrentAnimationStack (fbxStack);
+
+		FbxTimeSpan fbxSpan = fbxStack->GetLocalTimeSpan();
+		double start    = fbxSpan.GetStart().GetSecondDouble();
+		double duration = fbxSpan.GetDuration().GetSecondDouble();
+		if (duration <= 0) continue;
+
+		Animation* animation = new Animation();
+		animation->Name     = fbxStack->GetName();
+		animation->Duration = (float) duration;
+
+		const qint32 frameCount = (qint32) (duration * AnimationRate) + 1;
+
+		for (BoneMap::const_iterator bone = bones.constBegin(); bone != bones.constEnd(); ++bone)
+		{
+			Animation::Track track;
+			track.Bone = bone.value();
+			track.Keyframes.resize (frameCount);
+
+			// Sample the local bone transform
+			for (qint32 frame = 0; frame < frameCount; ++frame)
+			{
+				double time = qMin (frame / AnimationRate, duration);
+
+				FbxTime fbxTime;
+				fbxTime.SetSecondDouble (start + time);
+				FbxAMatrix fbxLocal = bone.key()->EvaluateLocalTransform (fbxTime);
+
+				FbxVector4    t = fbxLocal.GetT();
+				FbxQuaternion r = fbxLocal.GetQ();
+				FbxVector4    s = fbxLocal.GetS();
+
+				Animation::Keyframe& keyframe = track.Keyframes[frame];
+				keyframe.Time        = (float) time;
+				keyframe.Translation = Vector3    ((float) t[0], (float) t[1], (float) t[2]);
+				keyframe.Rotation    = Quaternion ((float) r[0], (float) r[1], (float) r[2], (float) r[3]);
+				keyframe.Scale       = Vector3    ((float) s[0], (float) s[1], (float) s[2]);
+			}
+
+			// Collapse tracks that never change
+			bool constant = true;
+			for (qint32 frame = 1; frame < frameCount && constant; ++frame)
+				constant =
+					track.Keyframes[frame].Translation == track.Keyframes[0].Translation &&
+					track.Keyframes[frame].Rotation    == track.Keyframes[0].Rotation    &&
+					track.Keyframes[frame].Scale       == track.Keyframes[0].Scale;
+
+			if (constant) track.Keyframes.resize (1);
+			animation->Tracks.append (track);
+		}
+
+		model->Animations.Add (animation);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
@@ -53,7 +406,7 @@ static void LoadTextures (Model* model, FbxScene* fbxScene)
 		if (fbxTexture != nullptr && fbxTexture->GetUserDataPtr() == nullptr)
 		{
 			// Add the texture to the model
-			Texture* texture = (Texture*) Content::Load (fbxTexture->GetFileName());
+			Texture* texture = Content::Load<Texture> (fbxTexture->GetFileName());
 
 			if (texture == nullptr)
 			{
@@ -142,48 +495,53 @@ static Material* CreateMaterial (Model* model, FbxSurfaceMaterial* fbxMaterial)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static Mesh* CreateMesh (Model* model, FbxMesh* fbxMesh)
+static void WriteInfluence (float* vertex, const Influence& influence)
+{
+	for (qint32 i = 0; i < 4; ++i)
+	{
+		vertex[ 9 + i] = influence.Indices[i];
+		vertex[13 + i] = influence.Weights[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static Mesh* CreateMesh (FbxMesh* fbxMesh, const BoneMap& bones)
 {
 	//----------------------------------------------------------------------------//
 	// Metadata                                                                   //
 	//----------------------------------------------------------------------------//
 
-	// Congregate all data of a mesh to be cached
-	bool hasNormal    = fbxMesh->GetElementNormalCount() > 0;
-	bool hasTextureUV = fbxMesh->GetElementUVCount()     > 0;
+	// Only the first normal and texture UV layers are used
+	FbxGeometryElementNormal* fbxNormalElement = nullptr;
+	FbxGeometryElementUV*  fbxTextureUVElement = nullptr;
 
-	FbxGeometryElement::EMappingMode fbxNormalMappingMode    = FbxGeometryElement::eNone;
-	FbxGeometryElement::EMappingMode fbxTextureUVMappingMode = FbxGeometryElement::eNone;
+	if (fbxMesh->GetElementNormalCount() > 0)
+		fbxNormalElement = fbxMesh->GetElementNormal (0);
 
-	bool allByControlPoint = true;
+	if (fbxMesh->GetElementUVCount() > 0)
+		fbxTextureUVElement = fbxMesh->GetElementUV (0);
 
-	// Check normals
-	if (hasNormal)
-	{
-		// Get the normal mapping mode of this mesh
-		fbxNormalMappingMode = fbxMesh->GetElementNormal(0)->GetMappingMode();
+	// Lock the layer arrays for bulk access
+	LayerArray<FbxVector4> normals    (fbxNormalElement   );
+	LayerArray<FbxVector2> textureUVs (fbxTextureUVElement);
 
-		// There are no relevant normals in this mesh
-		if (fbxNormalMappingMode == FbxGeometryElement::eNone)
-			hasNormal = false;
+	bool hasNormal    = normals   .IsValid();
+	bool hasTextureUV = textureUVs.IsValid();
 
-		if (hasNormal && fbxNormalMappingMode != FbxGeometryElement::eByControlPoint)
-			allByControlPoint = false;
-	}
+	// Vertices can be shared when every layer maps to control points
+	bool allByControlPoint =
+		(!hasNormal    || normals   .GetMappingMode() == FbxGeometryElement::eByControlPoint) &&
+		(!hasTextureUV || textureUVs.GetMappingMode() == FbxGeometryElement::eByControlPoint);
 
-	// Check texture UVs
-	if (hasTextureUV)
-	{
-		// Get the texture UV mapping mode of this mesh
-		fbxTextureUVMappingMode = fbxMesh->GetElementUV(0)->GetMappingMode();
+	// Check skin
+	QVector<Influence> influences;
+	bool hasSkin = LoadSkin (fbxMesh, bones, influences);
 
-		// There are no relevant texture UVs in this mesh
-		if (fbxTextureUVMappingMode == FbxGeometryElement::eNone)
-			hasTextureUV = false;
-
-		if (hasTextureUV && fbxTextureUVMappingMode != FbxGeometryElement::eByControlPoint)
-			allByControlPoint = false;
-	}
+	// Move skinned vertices into the space they were bound in
+	FbxAMatrix fbxBindShape;
+	if (hasSkin) fbxBindShape = GetBindShape (fbxMesh);
 
 
 
@@ -198,31 +556,28 @@ static Mesh* CreateMesh (Model* model, FbxMesh* fbxMesh)
 	qint32 polygonVertexCount = fbxMesh->GetControlPointsCount();
 	if (!allByControlPoint) polygonVertexCount = polygonCount * 3;
 
-	// Get the name of the Texture UV
-	FbxStringList fbxUVNames;
-	fbxMesh->GetUVSetNames(fbxUVNames);
-	const char* fbxUVName = nullptr;
-
 	// Create a new mesh object
 	Mesh* mesh = new Mesh();
 
-	if (hasNormal && hasTextureUV)
+	// Skinned meshes always use the full vertex layout
+	if (hasSkin)
 	{
-		fbxUVName = fbxUVNames[0];
+		mesh->Create (polygonVertexCount, VertexPositionNormalTextureSkin::ElementCount,
+			VertexPositionNormalTextureSkin::VertexElements, polygonCount * 3, 4);
+		memset (mesh->GetVertices()->GetData(), 0, mesh->GetVertices()->GetDataLength());
+	}
+
+	else if (hasNormal && hasTextureUV)
 		mesh->Create (polygonVertexCount, VertexPositionNormalTexture::ElementCount,
 			VertexPositionNormalTexture::VertexElements, polygonCount * 3, 4);
-	}
 
 	else if (hasNormal)
 		mesh->Create (polygonVertexCount, VertexPositionNormal::ElementCount,
 			VertexPositionNormal::VertexElements, polygonCount * 3, 4);
 
 	else if (hasTextureUV)
-	{
-		fbxUVName = fbxUVNames[0];
 		mesh->Create (polygonVertexCount, VertexPositionTexture::ElementCount,
 			VertexPositionTexture::VertexElements, polygonCount * 3, 4);
-	}
 
 	else mesh->Create (polygonVertexCount, VertexPosition::ElementCount,
 			VertexPosition::VertexElements, polygonCount * 3, 4);
@@ -231,72 +586,56 @@ static Mesh* CreateMesh (Model* model, FbxMesh* fbxMesh)
 	quint32* indices    = (quint32*) mesh->GetIndices ()->GetData();
 	quint32  vertexSize = mesh->GetVertices()->GetVertexDeclaration()->GetVertexSize() / 4;
 
+	// Texture UVs directly follow the position without normals
+	quint32 textureUVOffset = hasNormal || hasSkin ? 7 : 4;
+
+	// Mesh is triangulated so every polygon has three vertices
+	const FbxVector4* controlPoints   = fbxMesh->GetControlPoints();
+	const int*        polygonVertices = fbxMesh->GetPolygonVertices();
+
 
 
 	//----------------------------------------------------------------------------//
 	// Control Point                                                              //
 	//----------------------------------------------------------------------------//
 
-	const FbxVector4* controlPoints = fbxMesh->GetControlPoints();
-
-	FbxVector4 fbxCurrentVertex;
-	FbxVector4 fbxCurrentNormal;
-	FbxVector2 fbxCurrentTextureUV;
-
 	if (allByControlPoint)
 	{
-		const FbxGeometryElementNormal* fbxNormalElement = nullptr;
-		const FbxGeometryElementUV*  fbxTextureUVElement = nullptr;
-
-		if (hasNormal)
-			fbxNormalElement = fbxMesh->GetElementNormal(0);
-
-		if (hasTextureUV)
-			fbxTextureUVElement = fbxMesh->GetElementUV(0);
-
 		// Vertices
 		for (qint32 i = 0, index = 0; i < polygonVertexCount; ++i, index += vertexSize)
 		{
 			// Save the vertex position
-			fbxCurrentVertex = controlPoints[i];
-			vertices[index + 0] = (float) fbxCurrentVertex[0];
-			vertices[index + 1] = (float) fbxCurrentVertex[1];
-			vertices[index + 2] = (float) fbxCurrentVertex[2];
+			const FbxVector4 fbxVertex = fbxBindShape.MultT (controlPoints[i]);
+			vertices[index + 0] = (float) fbxVertex[0];
+			vertices[index + 1] = (float) fbxVertex[1];
+			vertices[index + 2] = (float) fbxVertex[2];
 			vertices[index + 3] = 1.0f;
 
 			// Save the vertex normal
 			if (hasNormal)
 			{
-				int normalIndex = i;
-				if (fbxNormalElement->GetReferenceMode() == FbxLayerElement::eIndexToDirect)
-					normalIndex = fbxNormalElement->GetIndexArray().GetAt (i);
-
-				fbxCurrentNormal = fbxNormalElement->GetDirectArray().GetAt (normalIndex);
-				vertices[index + 4] = (float) fbxCurrentNormal[0];
-				vertices[index + 5] = (float) fbxCurrentNormal[1];
-				vertices[index + 6] = (float) fbxCurrentNormal[2];
+				const FbxVector4 fbxNormal = fbxBindShape.MultR (normals.Get (i, 0, 0));
+				vertices[index + 4] = (float) fbxNormal[0];
+				vertices[index + 5] = (float) fbxNormal[1];
+				vertices[index + 6] = (float) fbxNormal[2];
 			}
 
 			// Save the vertex texture UV
 			if (hasTextureUV)
 			{
-				int textureUVIndex = i;
-				if (fbxTextureUVElement->GetReferenceMode() == FbxLayerElement::eIndexToDirect)
-					textureUVIndex = fbxTextureUVElement->GetIndexArray().GetAt (i);
-
-				fbxCurrentTextureUV = fbxTextureUVElement->GetDirectArray().GetAt (textureUVIndex);
-				vertices[index + 7] = (float) fbxCurrentTextureUV[0];
-				vertices[index + 8] = (float) fbxCurrentTextureUV[1];
+				const FbxVector2& fbxTextureUV = textureUVs.Get (i, 0, 0);
+				vertices[index + textureUVOffset + 0] = (float) fbxTextureUV[0];
+				vertices[index + textureUVOffset + 1] = (float) fbxTextureUV[1];
 			}
+
+			// Save the vertex bone influences
+			if (hasSkin)
+				WriteInfluence (vertices + index, influences[i]);
 		}
 
 		// Indices
-		for (qint32 i = 0, index = 0; i < polygonCount; ++i, index += 3)
-		{
-			indices[index + 0] = (quint32) fbxMesh->GetPolygonVertex (i, 0);
-			indices[index + 1] = (quint32) fbxMesh->GetPolygonVertex (i, 1);
-			indices[index + 2] = (quint32) fbxMesh->GetPolygonVertex (i, 2);
-		}
+		for (qint32 i = 0; i < polygonCount * 3; ++i)
+			indices[i] = (quint32) polygonVertices[i];
 
 		// All done
 		return mesh;
@@ -308,42 +647,47 @@ static Mesh* CreateMesh (Model* model, FbxMesh* fbxMesh)
 	// Polygon Vertex                                                             //
 	//----------------------------------------------------------------------------//
 
-	qint32 index = 0;
-	qint32 vertexCount = 0;
-	qint32 indexCount  = 0;
-
-	for (qint32 polygonIndex = 0; polygonIndex < polygonCount; ++polygonIndex, indexCount += 3)
-		for (qint32 verticeIndex = 0; verticeIndex < 3; ++verticeIndex, vertexCount += vertexSize, ++index)
+	for (qint32 polygonIndex = 0, index = 0; polygonIndex < polygonCount; ++polygonIndex)
+		for (qint32 verticeIndex = 0; verticeIndex < 3; ++verticeIndex, ++index)
 		{
 			// Get the index of the control point based on the current polygon vertex
-			const qint32 controlPointIndex = fbxMesh->GetPolygonVertex (polygonIndex, verticeIndex);
+			const qint32 controlPointIndex = polygonVertices[index];
+			float* vertex = vertices + index * vertexSize;
 
 			// Save the index position
-			indices[indexCount + verticeIndex] = (quint32) index;
+			indices[index] = (quint32) index;
 
 			// Save the vertex position
-			fbxCurrentVertex = controlPoints[controlPointIndex];
-			vertices[vertexCount + 0] = (float) fbxCurrentVertex[0];
-			vertices[vertexCount + 1] = (float) fbxCurrentVertex[1];
-			vertices[vertexCount + 2] = (float) fbxCurrentVertex[2];
-			vertices[vertexCount + 3] = 1.0f;
+			const FbxVector4 fbxVertex = fbxBindShape.MultT (controlPoints[controlPointIndex]);
+			vertex[0] = (float) fbxVertex[0];
+			vertex[1] = (float) fbxVertex[1];
+			vertex[2] = (float) fbxVertex[2];
+			vertex[3] = 1.0f;
 
 			// Save the vertex normal
 			if (hasNormal)
 			{
-				fbxMesh->GetPolygonVertexNormal (polygonIndex, verticeIndex, fbxCurrentNormal);
-				vertices[vertexCount + 4] = (float) fbxCurrentNormal[0];
-				vertices[vertexCount + 5] = (float) fbxCurrentNormal[1];
-				vertices[vertexCount + 6] = (float) fbxCurrentNormal[2];
+				const FbxVector4 fbxNormal = fbxBindShape.MultR (normals.Get
+					(controlPointIndex, index, polygonIndex));
+
+				vertex[4] = (float) fbxNormal[0];
+				vertex[5] = (float) fbxNormal[1];
+				vertex[6] = (float) fbxNormal[2];
 			}
 
 			// Save the vertex texture UV
 			if (hasTextureUV)
 			{
-				fbxMesh->GetPolygonVertexUV (polygonIndex, verticeIndex, fbxUVName, fbxCurrentTextureUV);
-				vertices[vertexCount + 7] = (float) fbxCurrentTextureUV[0];
-				vertices[vertexCount + 8] = (float) fbxCurrentTextureUV[1];
+				const FbxVector2& fbxTextureUV = textureUVs.Get
+					(controlPointIndex, index, polygonIndex);
+
+				vertex[textureUVOffset + 0] = (float) fbxTextureUV[0];
+				vertex[textureUVOffset + 1] = (float) fbxTextureUV[1];
 			}
+
+			// Save the vertex bone influences
+			if (hasSkin)
+				WriteInfluence (vertex, influences[controlPointIndex]);
 		}
 
 	// All done
@@ -353,13 +697,35 @@ static Mesh* CreateMesh (Model* model, FbxMesh* fbxMesh)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static void LoadGeometry (Model* model, FbxNode* fbxNode)
+struct ConvertMesh
 {
-	//----------------------------------------------------------------------------//
-	// Mesh                                                                       //
-	//----------------------------------------------------------------------------//
+	typedef void result_type;
+	ConvertMesh (const BoneMap& bones) : Bones (bones) { }
+
+	void operator() (MeshJob& job) const
+	{
+		if (job.Source != nullptr)
+			job.Result = CreateMesh (job.Source, Bones);
+
+		if (job.Result != nullptr)
+			job.Result->ComputeBounds();
+	}
+
+	const BoneMap& Bones;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Walks the scene and prepares mesh jobs, the FBX manager is not
+/// thread-safe so triangulation has to happen here
 
-	Mesh* mesh = nullptr;
+static void CollectGeometry (Model* model, FbxNode* fbxNode, const BoneMap&
+	bones, QList<MeshJob>& jobs, QSet<FbxMesh*>& converted)
+{
+	MeshJob job;
+	job.Node   = fbxNode;
+	job.Source = nullptr;
+	job.Result = nullptr;
 
 	const FbxNodeAttribute* fbxAttribute = fbxNode->GetNodeAttribute();
 	if (fbxAttribute != nullptr)
@@ -374,63 +740,88 @@ static void LoadGeometry (Model* model, FbxNode* fbxNode)
 			FbxGeometryConverter converter (fbxNode->GetFbxManager());
 			converter.TriangulateInPlace   (fbxNode);
 
-			// Retrieve FBX mesh data
+			// Instanced meshes are only converted once
 			FbxMesh* fbxMesh = fbxNode->GetMesh();
-			if (fbxMesh != nullptr && fbxMesh->GetNode() != nullptr && fbxMesh->GetUserDataPtr() == nullptr)
+			if (fbxMesh != nullptr && fbxMesh->GetNode() != nullptr && !converted.contains (fbxMesh))
 			{
-				// Load mesh data
-				mesh = CreateMesh (model, fbxMesh);
-				mesh->Name = fbxNode->GetName();
-
-				// Add the mesh to the model
-				model->Meshes.Add (mesh);
-
-				// Save the index position of this texture so it can be referenced later
-				fbxMesh->SetUserDataPtr ((void*) model->Meshes.Length());
+				converted.insert (fbxMesh);
+				LoadBindPose (model, fbxMesh, bones);
+				job.Source = fbxMesh;
 			}
 		}
 	}
 
+	// Nodes without meshes can still carry materials
+	if (job.Source != nullptr || fbxNode->GetMaterialCount() > 0)
+		jobs.append (job);
 
+	// Collect children nodes recursively
+	const qint32 childCount = fbxNode->GetChildCount();
+	for (qint32 i = 0; i < childCount; ++i)
+		CollectGeometry (model, fbxNode->GetChild (i), bones, jobs, converted);
+}
 
-	//----------------------------------------------------------------------------//
-	// Materials                                                                  //
-	//----------------------------------------------------------------------------//
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Merges converted meshes and materials in scene order so the
+/// resulting indices never depend on job scheduling
 
-	const qint32 materialCount = fbxNode->GetMaterialCount();
-	for (qint32 i = 0; i < materialCount; ++i)
+static void MergeGeometry (Model* model, const QList<MeshJob>& jobs)
+{
+	foreach (const MeshJob& job, jobs)
 	{
-		// Get FBX material data
-		FbxSurfaceMaterial* fbxMaterial = fbxNode->GetMaterial (i);
-		if (fbxMaterial == nullptr) continue;
+		Mesh* mesh = job.Result;
+		FbxNode* fbxNode = job.Node;
 
-		if (fbxMaterial->GetUserDataPtr() == nullptr)
+		// Add the mesh to the model
+		if (mesh != nullptr)
 		{
-			// Load material data
-			Material* material = CreateMaterial (model, fbxMaterial);
+			mesh->Name = fbxNode->GetName();
+			model->Meshes.Add (mesh);
+		}
 
-			// Add the material to the model
-			model->Materials.Add (material);
+		const qint32 materialCount = fbxNode->GetMaterialCount();
+		for (qint32 i = 0; i < materialCount; ++i)
+		{
+			// Get FBX material data
+			FbxSurfaceMaterial* fbxMaterial = fbxNode->GetMaterial (i);
+			if (fbxMaterial == nullptr) continue;
 
-			// Save the index position of this texture so it can be referenced later
-			fbxMaterial->SetUserDataPtr ((void*) model->Materials.Length());
-		}
+			if (fbxMaterial->GetUserDataPtr() == nullptr)
+			{
+				// Load material data
+				Material* material = CreateMaterial (model, fbxMaterial);
+
+				// Add the material to the model
+				model->Materials.Add (material);
+
+				// Save the index position of this texture so it can be referenced later
+				fbxMaterial->SetUserDataPtr ((void*) model->Materials.Length());
+			}
 
-		// Only one material per mesh is supported, use the first material
-		if (mesh != nullptr && i == 0)
-			mesh->Material = (quint32) fbxMaterial->GetUserDataPtr() - 1;
+			// Only one material per mesh is supported, use the first material
+			if (mesh != nullptr && i == 0)
+				mesh->Material = (quint32) fbxMaterial->GetUserDataPtr() - 1;
+		}
 	}
+}
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
 
+static void LoadGeometry (Model* model, FbxNode* fbxRoot, const BoneMap& bones)
+{
+	QList<MeshJob> jobs;
+	QSet<FbxMesh*> converted;
 
-	//----------------------------------------------------------------------------//
-	// Children                                                                   //
-	//----------------------------------------------------------------------------//
+	// Triangulate and collect meshes serially
+	CollectGeometry (model, fbxRoot, bones, jobs, converted);
 
-	// Load children nodes recursively
-	const qint32 childCount = fbxNode->GetChildCount();
-	for (qint32 i = 0; i < childCount; ++i)
-		LoadGeometry (model, fbxNode->GetChild (i));
+	// Convert every mesh in parallel
+	QtConcurrent::blockingMap (jobs, ConvertMesh (bones));
+
+	// Assign meshes and materials in scene order
+	MergeGeometry (model, jobs);
 }
 
 
@@ -540,8 +931,15 @@ Asset* ::FbxProcessor::Import (QFile& file, Asset* asset)
 	// Load texture data
 	LoadTextures (model, fbxScene);
 
+	// Load skeleton data
+	BoneMap bones;
+	LoadSkeleton (model, fbxRoot, -1, bones);
+
 	// Load mesh data
-	LoadGeometry (model, fbxRoot);
+	LoadGeometry (model, fbxRoot, bones);
+
+	// Load animation data
+	LoadAnimations (model, fbxScene, bones);
 
 	// All done
 	fbxScene->Destroy();
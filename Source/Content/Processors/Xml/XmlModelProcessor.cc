@@ -11,6 +11,7 @@
 // Prefaces                                                                   //
 //----------------------------------------------------------------------------//
 
+#include <cstring>
 #include "Version.h"
 #include "../XmlProcessor.h"
 #include "Engine/Console.h"
@@ -21,13 +22,16 @@
 #include "Graphics/Vertex.h"
 #include "Graphics/Material.h"
 #include "Graphics/Texture.h"
+#include "Graphics/Skeleton.h"
+#include "Graphics/Animation.h"
 
-#include <QDom.h>
+#include <QMap.h>
+#include <QList.h>
 #include <QFile.h>
 #include <QFileInfo.h>
 #include <QIODevice.h>
 #include <QString.h>
-#include <QStringList.h>
+#include <QXmlStream.h>
 
 
 
@@ -40,155 +44,344 @@
 
 static void MergeAnimation (Model* result, Model* model)
 {
-}
+	const Skeleton* source = model->GetSkeleton();
+	if (source == nullptr)
+	{
+		Console::Warning ("Animation model has no skeleton");
+		return;
+	}
 
-////////////////////////////////////////////////////////////////////////////////
-/// <summary> </summary>
+	// Adopt the skeleton of the first animation
+	if (result->GetSkeleton() == nullptr)
+		result->SetSkeleton (new Skeleton (*source));
 
-static void ParseChannel (QDomElement& element,
-	Material::Channel& channel, const QMap<QString, qint32>& textures)
-{
-	// Parse color
-	QString color = element.attribute ("Color");
-	if (!color.isEmpty())
+	const Skeleton* target = result->GetSkeleton();
+
+	for (quint32 i = 0; i < model->Animations.Length(); ++i)
 	{
-		QStringList list = color.split (',', QString::SkipEmptyParts);
-		if (list.length() >= 4)
+		Animation* animation = new Animation (*model->Animations[i]);
+		animation->Tracks.clear();
+
+		// Remap the tracks onto the result skeleton by bone name
+		foreach (const Animation::Track& track, model->Animations[i]->Tracks)
 		{
-			channel.Color.R = list.at(0).toFloat();
-			channel.Color.G = list.at(1).toFloat();
-			channel.Color.B = list.at(2).toFloat();
-			channel.Color.A = list.at(3).toFloat();
+			if (track.Bone < 0 || track.Bone >= source->Bones.length()) continue;
+
+			Animation::Track remapped = track;
+			remapped.Bone = target->FindBone (source->Bones[track.Bone].Name);
+
+			if (remapped.Bone < 0)
+				 Console::Warning ("Unable to find bone: %s", source->
+					Bones[track.Bone].Name.toAscii().data());
+			else animation->Tracks.append (remapped);
 		}
+
+		result->Animations.Add (animation);
 	}
-	
-	// Parse texture
-	if (textures.contains (element.attribute ("Texture")))
-		 channel.Texture = textures[element.attribute ("Texture")];
-	else channel.Texture = -1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static Material* LoadMaterial (QDomElement& element, const QMap<QString, qint32>& textures)
+static bool IsSameDeclaration (const Mesh* a, const Mesh* b)
 {
-	Material* material = new Material();
+	VertexDeclaration* da = a->GetVertices()->GetVertexDeclaration();
+	VertexDeclaration* db = b->GetVertices()->GetVertexDeclaration();
 
-	bool status;
+	// Element layouts must match exactly
+	return da->GetElementCount() == db->GetElementCount() &&
+		memcmp (da->GetElements(), db->GetElements(),
+		da->GetElementCount() * sizeof (VertexElement)) == 0;
+}
 
-	// Parse through this node
-	QDomNode node = element.firstChild();
-	while (!node.isNull())
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static Mesh* MergeMeshes (const QList<Mesh*>& meshes)
+{
+	const Mesh* first = meshes.first();
+	VertexDeclaration* declaration = first->GetVertices()->GetVertexDeclaration();
+
+	// Count the merged vertices and indices
+	quint32 vertexCount = 0;
+	quint32 indexCount  = 0;
+
+	foreach (const Mesh* mesh, meshes)
 	{
-		// Get the node element
-		QDomElement element = node.toElement();
+		vertexCount += mesh->GetVertices()->GetVertexCount();
+		indexCount  += mesh->GetIndices ()->GetIndexCount ();
+	}
 
-		// Get the next XML node
-		node = node.nextSibling();
-		if (element.isNull()) continue;
+	// Use the smallest index size able to address every vertex
+	quint8 indexSize = vertexCount <= 0x10000 ? 2 : 4;
 
-		// Parse the ambient channel
-		if (element.tagName() == "Ambient")
-			ParseChannel (element, material->Ambient, textures);
+	Mesh* result = new Mesh();
+	result->Create (vertexCount, declaration->GetElementCount(),
+		declaration->GetElements(), indexCount, indexSize);
 
-		// Parse the diffuse channel
-		if (element.tagName() == "Diffuse")
-			ParseChannel (element, material->Diffuse, textures);
+	result->Name     = first->Name;
+	result->Material = first->Material;
 
-		// Parse the specular channel
-		if (element.tagName() == "Specular")
-			ParseChannel (element, material->Specular, textures);
+	quint8* vertices = result->GetVertices()->GetData();
+	quint8* indices  = result->GetIndices ()->GetData();
+
+	quint32 vertexBase = 0;
+	quint32 indexBase  = 0;
+
+	foreach (const Mesh* mesh, meshes)
+	{
+		VertexBuffer* meshVertices = mesh->GetVertices();
+		IndexBuffer*  meshIndices  = mesh->GetIndices ();
 
-		// Parse the emissive channel
-		if (element.tagName() == "Emissive")
-			ParseChannel (element, material->Emissive, textures);
+		// Append the vertices
+		memcpy (vertices, meshVertices->GetData(), meshVertices->GetDataLength());
+		vertices += meshVertices->GetDataLength();
 
-		// Parse the alpha value
-		if (element.tagName() == "Alpha")
+		// Append the rebased indices
+		for (quint32 i = 0; i < meshIndices->GetIndexCount(); ++i)
 		{
-			material->Alpha = element.attribute ("Value").toFloat (&status);
-			if (!status) material->Alpha = 1.0f;
+			quint32 index = vertexBase + meshIndices->GetIndex (i);
+
+			if (indexSize == 2)
+				 ((quint16*) indices)[indexBase + i] = (quint16) index;
+			else ((quint32*) indices)[indexBase + i] = index;
 		}
 
-		// Parse the shininess value
-		if (element.tagName() == "Shininess")
+		// Remember the source mesh range
+		Mesh::Subset subset;
+		subset.IndexOffset = indexBase;
+		subset.IndexCount  = meshIndices->GetIndexCount();
+		subset.Name        = mesh->Name;
+		result->Subsets.append (subset);
+
+		vertexBase += meshVertices->GetVertexCount();
+		indexBase  += meshIndices ->GetIndexCount ();
+	}
+
+	result->ComputeBounds();
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Meshes sharing a material and vertex declaration become one mesh
+
+static void BatchMeshes (Model* model)
+{
+	QList<Mesh*> results;
+	QList<bool > merged;
+
+	quint32 meshCount = model->Meshes.Length();
+	for (quint32 i = 0; i < meshCount; ++i)
+		merged.append (false);
+
+	for (quint32 i = 0; i < meshCount; ++i)
+	{
+		if (merged[i]) continue;
+		Mesh* mesh = model->Meshes[i];
+
+		// Meshes without material or data stay separate
+		if (mesh->Material < 0 || mesh->IsPurged())
 		{
-			material->Shininess = element.attribute ("Value").toFloat (&status);
-			if (!status) material->Shininess = 2.0f;
+			results.append (new Mesh (*mesh));
+			continue;
 		}
 
-		// Parse the normal texture
-		if (element.tagName() == "Normal")
+		// Collect compatible meshes
+		QList<Mesh*> group;
+		group.append (mesh);
+
+		for (quint32 j = i + 1; j < meshCount; ++j)
 		{
-			if (textures.contains (element.attribute ("Texture")))
-				 material->Normal = textures[element.attribute ("Texture")];
-			else material->Normal = -1;
+			Mesh* other = model->Meshes[j];
+			if (merged[j] || other->IsPurged() ||
+				other->Material != mesh->Material ||
+				!IsSameDeclaration (mesh, other)) continue;
+
+			group.append (other);
+			merged[j] = true;
 		}
+
+		if (group.length() == 1)
+			 results.append (new Mesh (*mesh));
+		else results.append (MergeMeshes (group));
 	}
 
-	return material;
-}
+	Console::Message ("Batched %d meshes into %d", meshCount, results.length());
 
+	// Replace the model meshes
+	model->Meshes.Clear();
+	foreach (Mesh* mesh, results)
+		model->Meshes.Add (mesh);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static void LoadMaterials (Model* model, QDomElement& element)
+static void ParseChannel (QXmlStreamReader& reader,
+	Material::Channel& channel, const QMap<QString, qint32>& textures)
 {
-	QMap<QString, qint32> textures;
-	QMap<QString, qint32> materials;
-
-	// Parse through this node
-	QDomNode node = element.firstChild();
+	const QXmlStreamAttributes attributes = reader.attributes();
 
-	if (!node.isNull())
+	// Parse color
+	float color[4];
+	if (XmlProcessor::ParseFloats (attributes.value
+		(QLatin1String ("Color")), color, 4) == 4)
 	{
-		model->Textures.Clear();
-		model->Materials.Clear();
-
-		for (quint32 i = 0; i < model->Meshes.Length(); ++i)
-			model->Meshes[i]->Material = -1;
+		channel.Color.R = color[0];
+		channel.Color.G = color[1];
+		channel.Color.B = color[2];
+		channel.Color.A = color[3];
 	}
 
-	while (!node.isNull())
-	{
-		// Get the node element
-		QDomElement element = node.toElement();
+	// Parse texture
+	channel.Texture = textures.value (attributes.value
+		(QLatin1String ("Texture")).toString(), -1);
 
-		// Get the next XML node
-		node = node.nextSibling();
-		if (element.isNull()) continue;
+	reader.skipCurrentElement();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
 
-		// Load texture value
-		if (element.tagName() == "Texture")
+static Material* LoadMaterial (QXmlStreamReader& reader, const QMap<QString, qint32>& textures)
+{
+	Material* material = new Material();
+
+	// Parse through this element
+	while (reader.readNextStartElement())
+	{
+		switch (XmlProcessor::GetTag (reader.name()))
 		{
-			Texture* texture = (Texture*) Content::Load (element.attribute ("File"));
-			if (texture != nullptr)
-			{
-				textures.insert (element.attribute ("Name"), model->Textures.Length());
-				model->Textures.Add (texture);
-			}
+			// Parse the ambient channel
+			case XmlProcessor::AmbientTag:
+				ParseChannel (reader, material->Ambient, textures);
+				break;
+
+			// Parse the diffuse channel
+			case XmlProcessor::DiffuseTag:
+				ParseChannel (reader, material->Diffuse, textures);
+				break;
+
+			// Parse the specular channel
+			case XmlProcessor::SpecularTag:
+				ParseChannel (reader, material->Specular, textures);
+				break;
+
+			// Parse the emissive channel
+			case XmlProcessor::EmissiveTag:
+				ParseChannel (reader, material->Emissive, textures);
+				break;
+
+			// Parse the alpha value
+			case XmlProcessor::AlphaTag:
+				if (XmlProcessor::ParseFloats (reader.attributes().value
+					(QLatin1String ("Value")), &material->Alpha, 1) != 1)
+					material->Alpha = 1.0f;
+
+				reader.skipCurrentElement();
+				break;
+
+			// Parse the shininess value
+			case XmlProcessor::ShininessTag:
+				if (XmlProcessor::ParseFloats (reader.attributes().value
+					(QLatin1String ("Value")), &material->Shininess, 1) != 1)
+					material->Shininess = 2.0f;
+
+				reader.skipCurrentElement();
+				break;
+
+			// Parse the normal texture
+			case XmlProcessor::NormalTag:
+				material->Normal = textures.value (reader.attributes().value
+					(QLatin1String ("Texture")).toString(), -1);
+
+				reader.skipCurrentElement();
+				break;
+
+			default:
+				reader.skipCurrentElement();
+				break;
 		}
+	}
+
+	return material;
+}
 
-		// Load material value
-		else if (element.tagName() == "Material")
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void LoadMaterials (Model* model, QXmlStreamReader& reader)
+{
+	QMap<QString, qint32> textures;
+	QMap<QString, qint32> materials;
+
+	// Parse through this element
+	bool first = true;
+	while (reader.readNextStartElement())
+	{
+		// Any child replaces the material information
+		if (first)
 		{
-			Material* material = LoadMaterial (element, textures);
-			materials.insert (element.attribute ("Name"), model->Materials.Length());
-			model->Materials.Add (material);
+			model->Textures.Clear();
+			model->Materials.Clear();
+
+			for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+				model->Meshes[i]->Material = -1;
+
+			first = false;
 		}
 
-		// Assign a material value
-		else if (element.tagName() == "Assign")
+		const QXmlStreamAttributes attributes = reader.attributes();
+
+		switch (XmlProcessor::GetTag (reader.name()))
 		{
-			QString object = element.attribute ("Object");
-			for (quint32 i = 0; i < model->Meshes.Length(); ++i)
-				if (model->Meshes[i]->Name == object)
+			// Load texture value
+			case XmlProcessor::TextureTag:
+			{
+				Texture* texture = Content::Load<Texture>
+					(attributes.value (QLatin1String ("File")).toString());
+
+				if (texture != nullptr)
 				{
-					model->Meshes[i]->Material = materials[element.attribute ("Material")];
-					break;
+					textures.insert (attributes.value (QLatin1String
+						("Name")).toString(), model->Textures.Length());
+					model->Textures.Add (texture);
 				}
+
+				reader.skipCurrentElement();
+				break;
+			}
+
+			// Load material value
+			case XmlProcessor::MaterialTag:
+			{
+				materials.insert (attributes.value (QLatin1String
+					("Name")).toString(), model->Materials.Length());
+				model->Materials.Add (LoadMaterial (reader, textures));
+				break;
+			}
+
+			// Assign a material value
+			case XmlProcessor::AssignTag:
+			{
+				const QStringRef object = attributes.value (QLatin1String ("Object"));
+				for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+					if (object == model->Meshes[i]->Name)
+					{
+						model->Meshes[i]->Material = materials[attributes.
+							value (QLatin1String ("Material")).toString()];
+						break;
+					}
+
+				reader.skipCurrentElement();
+				break;
+			}
+
+			default:
+				reader.skipCurrentElement();
+				break;
 		}
 	}
 }
@@ -202,18 +395,18 @@ static void LoadMaterials (Model* model, QDomElement& element)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-Asset* XmlProcessor::ImportModel (QFile& file, QDomDocument& document, Asset* asset)
+Asset* XmlProcessor::ImportModel (QFile& file, QXmlStreamReader& reader, Asset* asset)
 {
-	// Get the root element of the document
-	QDomElement root = document.documentElement();
-
 	// Verify version
-	if (root.attribute ("Version") != VERSION)
+	if (reader.attributes().value (QLatin1String ("Version")) != QLatin1String (VERSION))
 	{
 		Console::Error ("Unsupported file version");
 		return nullptr;
 	}
 
+	// Check whether static meshes should be batched
+	bool batch = reader.attributes().value (QLatin1String ("Batch")) == QLatin1String ("True");
+
 	// Create the model object
 	Model* model;
 	bool managed = asset != nullptr;
@@ -226,28 +419,23 @@ Asset* XmlProcessor::ImportModel (QFile& file, QDomDocument& document, Asset* as
 	QFileInfo info (file);
 
 	// Parse XML data
-	QDomNode node = root.firstChild();
-	while (!node.isNull())
+	while (reader.readNextStartElement())
 	{
-		// Get the node element
-		QDomElement element = node.toElement();
-
-		// Get the next XML node
-		node = node.nextSibling();
-		if (element.isNull()) continue;
+		Tag tag = GetTag (reader.name());
 
 		// Get the localized filename of the model
-		QString filename = info.path() + "/" + element.attribute ("File");
+		QString filename = info.path() + "/" + reader.
+			attributes().value (QLatin1String ("File")).toString();
 
 		// Load model
-		Model* elementModel = (Model*) Content::Load (filename);
-		if (elementModel == nullptr) continue;
+		Model* elementModel = Content::Load<Model> (filename);
+		if (elementModel == nullptr) { reader.skipCurrentElement(); continue; }
 
 		// Load material information
-		LoadMaterials (elementModel, element);
+		LoadMaterials (elementModel, reader);
 
 		// Load reference model information
-		if (element.tagName() == "Reference")
+		if (tag == ReferenceTag)
 		{
 			// Merge the reference model
 			for (quint32 i = 0; i < elementModel->Meshes.Length(); ++i)
@@ -261,10 +449,14 @@ Asset* XmlProcessor::ImportModel (QFile& file, QDomDocument& document, Asset* as
 				elementModel->Textures[i]->Retain();
 				model->Textures.Add (elementModel->Textures[i]);
 			}
+
+			// Adopt the skeleton of skinned meshes
+			if (model->GetSkeleton() == nullptr && elementModel->GetSkeleton() != nullptr)
+				model->SetSkeleton (new Skeleton (*elementModel->GetSkeleton()));
 		}
 
 		// Load physics model information
-		else if (element.tagName() == "Physics")
+		else if (tag == PhysicsTag)
 		{
 			// Replace the physics mesh
 			model->SetPhysicsMesh (new Mesh
@@ -272,7 +464,7 @@ Asset* XmlProcessor::ImportModel (QFile& file, QDomDocument& document, Asset* as
 		}
 
 		// Load animation information information
-		else if (element.tagName() == "Animation")
+		else if (tag == AnimationTag)
 		{
 			// Merge the animation
 			MergeAnimation (model, elementModel);
@@ -281,6 +473,18 @@ Asset* XmlProcessor::ImportModel (QFile& file, QDomDocument& document, Asset* as
 		elementModel->Release();
 	}
 
+	// Check for parse errors
+	if (reader.hasError())
+	{
+		Console::Error ("Unable to read XML file: %s",
+			reader.errorString().toAscii().data());
+
+		if (!managed) model->Release(); return nullptr;
+	}
+
+	// Merge static meshes by material
+	if (batch) BatchMeshes (model);
+
 	// All done
 	return model;
 }
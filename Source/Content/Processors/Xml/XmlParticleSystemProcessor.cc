@@ -18,15 +18,15 @@
 #include "Content/Asset.h"
 #include "Engine/Console.h"
 #include "Graphics/ParticleSystem.h"
+#include "Graphics/Texture.h"
 
 #include "Math/Vector3.h"
 #include "Graphics/Color.h"
 
-#include <QDom.h>
 #include <QFile.h>
 #include <QFileInfo.h>
 #include <QIODevice.h>
-#include <QStringList.h>
+#include <QXmlStream.h>
 
 
 
@@ -37,37 +37,38 @@
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static void ParseVector3 (QDomElement& element, Vector3& value)
+static void ParseFloat (const QStringRef& text, float& value, float fallback)
 {
-	QString vector = element.attribute ("Value");
-	if (!vector.isEmpty())
+	if (XmlProcessor::ParseFloats (text, &value, 1) != 1)
+		value = fallback;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static void ParseVector3 (const QStringRef& text, Vector3& value)
+{
+	float values[3];
+	if (XmlProcessor::ParseFloats (text, values, 3) == 3)
 	{
-		QStringList list = vector.split (',', QString::SkipEmptyParts);
-		if (list.length() >= 3)
-		{
-			value.X = list.at(0).toFloat();
-			value.Y = list.at(1).toFloat();
-			value.Z = list.at(2).toFloat();
-		}
+		value.X = values[0];
+		value.Y = values[1];
+		value.Z = values[2];
 	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static void ParseColor (QDomElement& element, Color& value)
+static void ParseColor (const QStringRef& text, Color& value)
 {
-	QString color = element.attribute ("Value");
-	if (!color.isEmpty())
+	float values[4];
+	if (XmlProcessor::ParseFloats (text, values, 4) == 4)
 	{
-		QStringList list = color.split (',', QString::SkipEmptyParts);
-		if (list.length() >= 4)
-		{
-			value.R = list.at(0).toFloat();
-			value.G = list.at(1).toFloat();
-			value.B = list.at(2).toFloat();
-			value.A = list.at(3).toFloat();
-		}
+		value.R = values[0];
+		value.G = values[1];
+		value.B = values[2];
+		value.A = values[3];
 	}
 }
 
@@ -80,13 +81,10 @@ static void ParseColor (QDomElement& element, Color& value)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-Asset* XmlProcessor::ImportParticleSystem (QFile& file, QDomDocument& document, Asset* asset)
+Asset* XmlProcessor::ImportParticleSystem (QFile& file, QXmlStreamReader& reader, Asset* asset)
 {
-	// Get the root element of the document
-	QDomElement root = document.documentElement();
-
 	// Verify version
-	if (root.attribute ("Version") != VERSION)
+	if (reader.attributes().value (QLatin1String ("Version")) != QLatin1String (VERSION))
 	{
 		Console::Error ("Unsupported file version");
 		return nullptr;
@@ -100,98 +98,58 @@ Asset* XmlProcessor::ImportParticleSystem (QFile& file, QDomDocument& document,
 		 system = (ParticleSystem*) asset;
 	else system = new ParticleSystem();
 
-	bool status;
-	QFileInfo info (file);
+	float quantity;
 
 	// Parse XML data
-	QDomNode node = root.firstChild();
-	while (!node.isNull())
+	while (reader.readNextStartElement())
 	{
-		// Get the node element
-		QDomElement element = node.toElement();
-
-		// Get the next XML node
-		node = node.nextSibling();
-		if (element.isNull()) continue;
+		// Every property is stored in the value attribute
+		const QStringRef value = reader.attributes().value (QLatin1String ("Value"));
 
 		// Load particle system data
-		if (element.tagName() == "Position")
-			ParseVector3 (element, system->Position);
-
-		if (element.tagName() == "Diffuse")
-			ParseColor (element, system->Diffuse);
-
-		if (element.tagName() == "Alpha")
-		{
-			system->Alpha = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Alpha = 1.0f;
-		}
-
-		if (element.tagName() == "Speed")
-		{
-			system->Speed = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Speed = 1.0f;
-		}
-
-		if (element.tagName() == "Spread")
-		{
-			system->Spread = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Spread = 1.0f;
-		}
-
-		if (element.tagName() == "Shape")
+		switch (GetTag (reader.name()))
 		{
-			system->Shape = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Shape = 1.0f;
+			case PositionTag	: ParseVector3 (value, system->Position);				break;
+			case DiffuseTag		: ParseColor   (value, system->Diffuse);				break;
+
+			case AlphaTag		: ParseFloat (value, system->Alpha,			1.0f);	break;
+			case SpeedTag		: ParseFloat (value, system->Speed,			1.0f);	break;
+			case SpreadTag		: ParseFloat (value, system->Spread,		1.0f);	break;
+			case ShapeTag		: ParseFloat (value, system->Shape,			1.0f);	break;
+			case SizeTag		: ParseFloat (value, system->Size,			1.0f);	break;
+			case GravityTag		: ParseFloat (value, system->Gravity,		0.0f);	break;
+			case SystemHeightTag: ParseFloat (value, system->SystemHeight,	1.0f);	break;
+			case SystemShapeTag	: ParseFloat (value, system->SystemShape,	1.0f);	break;
+			case FadeInTimeTag	: ParseFloat (value, system->FadeInTime,	1.0f);	break;
+			case FadeOutTimeTag	: ParseFloat (value, system->FadeOutTime,	1.0f);	break;
+
+			case QuantityTag:
+				if (ParseFloats (value, &quantity, 1) == 1)
+					system->Create ((quint16) quantity);
+				break;
+
+			case TextureTag:
+			{
+				// The system retains its own reference
+				AssetHandle<Texture> texture =
+					Content::Load<Texture> (value.toString());
+
+				system->SetTexture (texture);
+				texture.Release();
+				break;
+			}
 		}
 
-		if (element.tagName() == "Size")
-		{
-			system->Size = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Size = 1.0f;
-		}
-
-		if (element.tagName() == "Gravity")
-		{
-			system->Gravity = element.attribute ("Value").toFloat (&status);
-			if (!status) system->Gravity = 0.0f;
-		}
-
-		if (element.tagName() == "SystemHeight")
-		{
-			system->SystemHeight = element.attribute ("Value").toFloat (&status);
-			if (!status) system->SystemHeight = 1.0f;
-		}
-
-		if (element.tagName() == "SystemShape")
-		{
-			system->SystemShape = element.attribute ("Value").toFloat (&status);
-			if (!status) system->SystemShape = 1.0f;
-		}
-
-		if (element.tagName() == "FadeInTime")
-		{
-			system->FadeInTime = element.attribute ("Value").toFloat (&status);
-			if (!status) system->FadeInTime = 1.0f;
-		}
-
-		if (element.tagName() == "FadeOutTime")
-		{
-			system->FadeOutTime = element.attribute ("Value").toFloat (&status);
-			if (!status) system->FadeOutTime = 1.0f;
-		}
+		reader.skipCurrentElement();
+	}
 
-		if (element.tagName() == "Quantity")
-		{
-			quint16 quantity = element.attribute ("Value").toFloat (&status);
-			if (status) system->Create (quantity);
-		}
+	// Check for parse errors
+	if (reader.hasError())
+	{
+		Console::Error ("Unable to read XML file: %s",
+			reader.errorString().toAscii().data());
 
-		if (element.tagName() == "Texture")
-		{
-			Texture* texture = (Texture*) Content::Load (element.attribute ("Value"));
-			system->SetTexture (texture);
-		}
+		if (!managed) system->Release(); return nullptr;
 	}
 
 	return system;
@@ -18,10 +18,10 @@
 #include "Engine/Console.h"
 #include "Graphics/Shader.h"
 
-#include <QDom.h>
 #include <QFile.h>
 #include <QFileInfo.h>
 #include <QIODevice.h>
+#include <QXmlStream.h>
 
 
 
@@ -32,14 +32,18 @@
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-static void ParseShader (QFile& file, QDomElement& element, QByteArray& data)
+static void ParseShader (QFile& file, QXmlStreamReader& reader, QByteArray& data)
 {
+	const QXmlStreamAttributes attributes = reader.attributes();
+
 	// Get the localized filename of the shader
 	QFileInfo info (file);
-	QString filename = info.path() + "/" + element.attribute ("File");
+	QString filename = info.path() + "/" +
+		attributes.value (QLatin1String ("File")).toString();
 
 	// Get the entry point of the shader (if any)
-	QString entry = element.attribute ("Entry");
+	QString entry = attributes.value (QLatin1String ("Entry")).toString();
+	reader.skipCurrentElement();
 
 	// Open shader file
 	QFile input (filename);
@@ -70,13 +74,10 @@ static void ParseShader (QFile& file, QDomElement& element, QByteArray& data)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-Asset* XmlProcessor::ImportShader (QFile& file, QDomDocument& document, Asset* asset)
+Asset* XmlProcessor::ImportShader (QFile& file, QXmlStreamReader& reader, Asset* asset)
 {
-	// Get the root element of the document
-	QDomElement root = document.documentElement();
-
 	// Verify version
-	if (root.attribute ("Version") != VERSION)
+	if (reader.attributes().value (QLatin1String ("Version")) != QLatin1String (VERSION))
 	{
 		Console::Error ("Unsupported file version");
 		return nullptr;
@@ -93,23 +94,40 @@ Asset* XmlProcessor::ImportShader (QFile& file, QDomDocument& document, Asset* a
 	shader->Create();
 
 	// Parse XML data
-	QDomNode node = root.firstChild();
-	while (!node.isNull())
+	while (reader.readNextStartElement())
 	{
-		// Get the node element
-		QDomElement element = node.toElement();
-
-		// Get the next XML node
-		node = node.nextSibling();
-		if (element.isNull()) continue;
+		switch (GetTag (reader.name()))
+		{
+			// Load vertex shader information
+			case VertexTag:
+				ParseShader (file, reader, shader->Vertex);
+				break;
+
+			// Load fragment shader information
+			case FragmentTag:
+				ParseShader (file, reader, shader->Fragment);
+				break;
+
+			// Load transform feedback outputs
+			case VaryingTag:
+				shader->Varyings << reader.attributes().value
+					(QLatin1String ("Name")).toString().toAscii();
+				reader.skipCurrentElement();
+				break;
+
+			default:
+				reader.skipCurrentElement();
+				break;
+		}
+	}
 
-		// Load vertex shader information
-		if (element.tagName() == "Vertex")
-			ParseShader (file, element, shader->Vertex);
+	// Check for parse errors
+	if (reader.hasError())
+	{
+		Console::Error ("Unable to read XML file: %s",
+			reader.errorString().toAscii().data());
 
-		// Load fragment shader information
-		else if (element.tagName() == "Fragment")
-			ParseShader (file, element, shader->Fragment);
+		if (!managed) shader->Release(); return nullptr;
 	}
 
 	// All done
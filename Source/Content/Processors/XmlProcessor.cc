@@ -11,12 +11,100 @@
 // Prefaces                                                                   //
 //----------------------------------------------------------------------------//
 
+#include <cmath>
 #include "XmlProcessor.h"
 #include "Engine/Console.h"
 
-#include <QDom.h>
 #include <QFile.h>
+#include <QHash.h>
 #include <QIODevice.h>
+#include <QXmlStream.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static const char* TagNames[XmlProcessor::TagCount] =
+{
+	"",
+
+	"Model",
+	"Shader",
+	"ParticleSystem",
+
+	"Reference",
+	"Physics",
+	"Animation",
+	"Texture",
+	"Material",
+	"Assign",
+	"Ambient",
+	"Diffuse",
+	"Specular",
+	"Emissive",
+	"Alpha",
+	"Shininess",
+	"Normal",
+
+	"Vertex",
+	"Fragment",
+	"Varying",
+
+	"Position",
+	"Speed",
+	"Spread",
+	"Shape",
+	"Size",
+	"Gravity",
+	"SystemHeight",
+	"SystemShape",
+	"FadeInTime",
+	"FadeOutTime",
+	"Quantity",
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// FNV-1a over UTF-16 code units
+
+static quint32 HashTag (const QChar* data, qint32 length)
+{
+	quint32 hash = 2166136261u;
+	for (qint32 i = 0; i < length; ++i)
+	{
+		hash ^= data[i].unicode();
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static QHash<quint32, qint32> CreateTagTable (void)
+{
+	QHash<quint32, qint32> table;
+	for (qint32 i = 1; i < XmlProcessor::TagCount; ++i)
+	{
+		QString name (TagNames[i]);
+		table.insert (HashTag (name.constData(), name.length()), i);
+	}
+
+	return table;
+}
+
+// Tags by the hash of their name, built before any
+// thread can import and only ever read afterwards
+static const QHash<quint32, qint32> TagTable = CreateTagTable();
+
+// Larger exponents overflow a float anyway
+static const qint32 MaxExponent = 300;
 
 
 
@@ -29,31 +117,117 @@
 
 Asset* XmlProcessor::Import (QFile& file, Asset* asset)
 {
-	QDomDocument doc;
+	QXmlStreamReader reader (&file);
 
-	// Attempt to read as XML
-	if (!doc.setContent (&file))
+	// Attempt to read the root element
+	if (!reader.readNextStartElement())
 	{
 		Console::Error ("Unable to read XML file");
 		return nullptr;
 	}
 
-	// Get the root element of the document
-	QDomElement root = doc.documentElement();
-
-	// Document is a model
-	if (root.tagName() == "Model")
-		return ImportModel (file, doc, asset);
+	switch (GetTag (reader.name()))
+	{
+		// Document is a model
+		case ModelTag:
+			return ImportModel (file, reader, asset);
 
-	// Document is a shader
-	if (root.tagName() == "Shader")
-		return ImportShader (file, doc, asset);
+		// Document is a shader
+		case ShaderTag:
+			return ImportShader (file, reader, asset);
 
-	// Document is a particle system
-	if (root.tagName() == "ParticleSystem")
-		return ImportParticleSystem (file, doc, asset);
+		// Document is a particle system
+		case ParticleSystemTag:
+			return ImportParticleSystem (file, reader, asset);
+	}
 
 	// Document is of an unknown type
 	Console::Error ("File is not the right type");
 	return nullptr;
 }
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                        XmlProcessor //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+XmlProcessor::Tag XmlProcessor::GetTag (const QStringRef& name)
+{
+	quint32 hash = HashTag (name.constData(), name.length());
+
+	// Look up the hash and confirm with the name
+	qint32 tag = TagTable.value (hash, UnknownTag);
+	if (tag != UnknownTag && name == QLatin1String (TagNames[tag]))
+		return (Tag) tag;
+
+	return UnknownTag;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Parses a comma separated list of floats without allocating,
+/// returns the number of values read
+
+quint32 XmlProcessor::ParseFloats (const QStringRef& text, float* values, quint32 count)
+{
+	const QChar* data = text.constData();
+	const QChar* end  = data + text.length();
+
+	quint32 parsed = 0;
+	while (parsed < count)
+	{
+		// Skip separators
+		while (data < end && (data->isSpace() || *data == QLatin1Char (','))) ++data;
+		if (data == end) break;
+
+		// Parse the sign
+		bool negative = false;
+		if (*data == QLatin1Char ('-') || *data == QLatin1Char ('+'))
+			negative = *data++ == QLatin1Char ('-');
+
+		// Parse the integer and fraction
+		double value = 0;
+		bool digits = false;
+
+		while (data < end && data->isDigit())
+			{ value = value * 10 + data++->digitValue(); digits = true; }
+
+		if (data < end && *data == QLatin1Char ('.'))
+		{
+			double scale = 0.1;
+			for (++data; data < end && data->isDigit(); ++data, scale *= 0.1)
+				{ value += data->digitValue() * scale; digits = true; }
+		}
+
+		// Stop on malformed values
+		if (!digits) break;
+
+		// Parse the exponent
+		if (data < end && (*data == QLatin1Char ('e') || *data == QLatin1Char ('E')))
+		{
+			++data;
+			bool negativeExponent = false;
+			if (data < end && (*data == QLatin1Char ('-') || *data == QLatin1Char ('+')))
+				negativeExponent = *data++ == QLatin1Char ('-');
+
+			// Keep consuming digits but stop growing the exponent
+			qint32 exponent = 0;
+			for (; data < end && data->isDigit(); ++data)
+				exponent = qMin (exponent * 10 + data->digitValue(), MaxExponent);
+
+			double scale = pow (10.0, exponent);
+			value = negativeExponent ? value / scale : value * scale;
+		}
+
+		// Values must be followed by a separator
+		if (data < end && !data->isSpace() && *data != QLatin1Char (',')) break;
+
+		values[parsed++] = (float) (negative ? -value : value);
+	}
+
+	return parsed;
+}
@@ -14,9 +14,11 @@
 #ifndef CONTENT_XML_PROCESSOR_H
 #define CONTENT_XML_PROCESSOR_H
 
-class QDomDocument;
+class QStringRef;
+class QXmlStreamReader;
 
 #include "Content/Processor.h"
+#include <QGlobal.h>
 
 
 
@@ -29,15 +31,70 @@ class QDomDocument;
 
 class XmlProcessor : public Processor
 {
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	enum Tag
+	{
+		UnknownTag = 0,
+
+		// Documents
+		ModelTag,
+		ShaderTag,
+		ParticleSystemTag,
+
+		// Model
+		ReferenceTag,
+		PhysicsTag,
+		AnimationTag,
+		TextureTag,
+		MaterialTag,
+		AssignTag,
+		AmbientTag,
+		DiffuseTag,
+		SpecularTag,
+		EmissiveTag,
+		AlphaTag,
+		ShininessTag,
+		NormalTag,
+
+		// Shader
+		VertexTag,
+		FragmentTag,
+		VaryingTag,
+
+		// Particle system
+		PositionTag,
+		SpeedTag,
+		SpreadTag,
+		ShapeTag,
+		SizeTag,
+		GravityTag,
+		SystemHeightTag,
+		SystemShapeTag,
+		FadeInTimeTag,
+		FadeOutTimeTag,
+		QuantityTag,
+
+		TagCount
+	};
+
 public:
 	// Methods
 	virtual Asset* Import		(QFile& file, Asset* asset = nullptr);
 
+public:
+	// Static
+	static Tag		GetTag		(const QStringRef& name);
+	static quint32	ParseFloats	(const QStringRef& text, float* values, quint32 count);
+
 private:
 	// Internal
-	Asset* ImportModel			(QFile& file, QDomDocument& document, Asset* asset);
-	Asset* ImportShader			(QFile& file, QDomDocument& document, Asset* asset);
-	Asset* ImportParticleSystem	(QFile& file, QDomDocument& document, Asset* asset);
+	Asset* ImportModel			(QFile& file, QXmlStreamReader& reader, Asset* asset);
+	Asset* ImportShader			(QFile& file, QXmlStreamReader& reader, Asset* asset);
+	Asset* ImportParticleSystem	(QFile& file, QXmlStreamReader& reader, Asset* asset);
 };
 
 #endif // CONTENT_XML_PROCESSOR_H
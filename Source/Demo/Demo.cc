@@ -11,6 +11,7 @@
 // Prefaces                                                                   //
 //----------------------------------------------------------------------------//
 
+#include <cstring>
 #include "Demo/Demo.h"
 #include "Demo/ShadowMap.h"
 #include "Demo/Camera.h"
@@ -24,18 +25,102 @@
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
 #include "Math/Random.h"
+#include "Math/RadixSort.h"
+#include "Math/BoundingFrustum.h"
 
 #include "Graphics/Mesh.h"
 #include "Graphics/Light.h"
 #include "Graphics/Model.h"
 #include "Graphics/Shader.h"
 #include "Graphics/Texture.h"
+#include "Graphics/TextureArray.h"
 #include "Graphics/Material.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/UniformBlocks.h"
 #include "Graphics/ParticleSystem.h"
+#include "Graphics/SkinBuffer.h"
+#include "Graphics/ParticleBuffer.h"
+
+#include <QThread.h>
+#include <QElapsedTimer.h>
+#include <QVarLengthArray.h>
+#include <QtConcurrentMap.h>
 
 #define GLEW_STATIC
 #include <glew.h>
 
+// Smallest number of packets worth a recording job, the jungle
+// submits one packet per subset, about thirty, which are merged
+// back into roughly one draw per material when recorded
+static const quint32 MinPacketsPerJob = 8;
+
+// Width and height of every shadow cascade, four cascades
+// at this size fill as many texels as a single 2048 map
+static const quint32 ShadowSize = 1024;
+static const quint32 ShadowCascades = 4;
+
+// Shadow blur quality, the radius is in downsampled texels
+static const quint32 ShadowDownsample = 2;
+static const quint32 ShadowBlurRadius = 2;
+
+// Particle slots of the water spray
+static const quint32 SprayCapacity = 2048;
+
+// Stones circling the spray, drawn as one instanced batch
+static const quint32 StoneCount = 24;
+
+// Jungle meshes rasterized into the occlusion buffer
+static const qint32 OccluderMaterial = 0;
+static const float OccluderMinSize = 20.0f;
+
+// Longest frame in milliseconds passed to the animations, so
+// a stall or a debugger break does not jump them ahead
+static const quint32 MaxFrameTime = 100;
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Identifies the packets drawn into a shadow cascade. </summary>
+/// FNV-1a over the mesh, subset and transform of every visible caster
+
+static quint32 HashCasters (const RenderQueue& queue,
+	const quint8* visible, const Shader* program)
+{
+	quint32 hash = 2166136261u;
+	for (quint32 i = 0; i < queue.GetPacketCount(); ++i)
+	{
+		const RenderQueue::Packet& packet = queue.GetPacket (i);
+		if (packet.Program != program || !visible[i]) continue;
+
+		const quint8* mesh = (const quint8*) &packet.Geometry;
+		const quint8* part = (const quint8*) &packet.Part;
+		const quint8* transform = (const quint8*) &packet.Transform;
+
+		for (quint32 b = 0; b < sizeof (packet.Geometry); ++b)
+			{ hash ^= mesh[b]; hash *= 16777619u; }
+
+		for (quint32 b = 0; b < sizeof (packet.Part); ++b)
+			{ hash ^= part[b]; hash *= 16777619u; }
+
+		for (quint32 b = 0; b < sizeof (Matrix); ++b)
+			{ hash ^= transform[b]; hash *= 16777619u; }
+	}
+
+	return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether a packet is another subset of the same mesh,
+/// 		  drawn with the same state as the previous packet. </summary>
+
+static inline bool IsSameDraw (const RenderQueue::Packet& previous,
+	const RenderQueue::Packet& packet)
+{
+	return packet.Part	   >= 0 &&
+		   packet.Geometry  == previous.Geometry &&
+		   packet.Program   == previous.Program  &&
+		   packet.Surface   == previous.Surface  &&
+		   packet.Transform == previous.Transform;
+}
+
 
 
 //----------------------------------------------------------------------------//
@@ -61,33 +146,65 @@ Demo::Demo (void)
 
 	mRandom = new Random();
 
-	mDefault = new Texture();
-	mDefault->Create (1, 1, 24);
-	mDefault->GetData()[0] = 0;
-	mDefault->GetData()[1] = 0;
-	mDefault->GetData()[2] = 0;
-	mDefault->Load();
-	mDefault->Purge();
+	mFrame.Sky     = nullptr;
+	mFrame.Phong   = nullptr;
+	mFrame.Skinned = nullptr;
+	mFrame.Jungle  = nullptr;
+	mFrame.Sphere  = nullptr;
+	mFrame.Vine    = nullptr;
+	mFrame.Stone   = nullptr;
 
-	mSky   = (Shader*) Content::Load ("Shaders/Sky.ast");
-	mPhong = (Shader*) Content::Load ("Shaders/Phong.ast");
-	mQuad  = (Shader*) Content::Load ("Shaders/Quad.ast" );
+	mSky     = Content::Load<Shader> ("Shaders/Sky.ast"    );
+	mPhong   = Content::Load<Shader> ("Shaders/Phong.ast"  );
+	mQuad    = Content::Load<Shader> ("Shaders/Quad.ast"   );
+	mSkinned = Content::Load<Shader> ("Shaders/Skinned.ast");
 
-	if (mSky   != nullptr) { mSky  ->Load(); mSky  ->Purge(); }
-	if (mPhong != nullptr) { mPhong->Load(); mPhong->Purge(); }
-	if (mQuad  != nullptr) { mQuad ->Load(); mQuad ->Purge(); }
+	if (mSky     != nullptr) { mSky    ->Load(); mSky    ->Purge(); }
+	if (mPhong   != nullptr) { mPhong  ->Load(); mPhong  ->Purge(); }
+	if (mQuad    != nullptr) { mQuad   ->Load(); mQuad   ->Purge(); }
+	if (mSkinned != nullptr) { mSkinned->Load(); mSkinned->Purge(); }
 
-	mJungle = (Model*) Content::Load ("Models/Jungle.ast");
+	LoadUniforms();
+
+	mJungle = Content::Load<Model> ("Models/Jungle.ast");
 
 	if (mJungle != nullptr)
 	{
 		mJungle->LoadTextures();
 		mJungle->LoadGeometry();
+		mJungle->LoadMaterials();
+
+		// Materials sample the packed texture arrays
+		mJungle->UnloadTextures();
 		mJungle->PurgeTextures();
+
+		// The terrain and rocks are solid, palm fronds are alpha
+		// tested and small stones would not hide anything
+		if (mOcclusion.Create (256, 128))
+		{
+			for (quint32 i = 0; i < mJungle->Meshes.Length(); ++i)
+			{
+				const Mesh* mesh = mJungle->Meshes[i];
+				if (mesh->Material != OccluderMaterial) continue;
+
+				// Meshes without subsets are tested as a whole
+				bool whole = mesh->Subsets.isEmpty();
+				for (qint32 s = 0; s < (whole ? 1 : mesh->Subsets.size()); ++s)
+				{
+					const BoundingBox& bounds = whole ?
+						mesh->Bounds : mesh->Subsets[s].Bounds;
+					Vector3 size = bounds.Max - bounds.Min;
+
+					if (Math::Max (size.X, size.Z) >= OccluderMinSize)
+						mOcclusion.AddOccluder (mesh, Matrix::Identity, whole ? -1 : s);
+				}
+			}
+		}
+
 		mJungle->PurgeGeometry();
 	}
 
-	mSphere = (Model*) Content::Load ("Models/Sphere.ast");
+	mSphere = Content::Load<Model> ("Models/Sphere.ast");
 
 	if (mSphere != nullptr)
 	{
@@ -97,15 +214,98 @@ Demo::Demo (void)
 		mSphere->PurgeGeometry();
 	}
 
-	mClouds = (ParticleSystem*) Content::Load ("Particles/Clouds.ast");
-	mRain   = (ParticleSystem*) Content::Load ("Particles/Rain.ast");
-	mStars  = (ParticleSystem*) Content::Load ("Particles/Stars.ast");
+	mVine = Content::Load<Model> ("Models/Vine.ast");
+	mVineWorld = Matrix::CreateTranslation (-25, 0, 35);
+
+	if (mVine != nullptr)
+	{
+		mVine->LoadTextures();
+		mVine->LoadGeometry();
+		mVine->LoadMaterials();
+
+		mVine->UnloadTextures();
+		mVine->PurgeTextures();
+
+		// Influences are checked before the geometry is purged
+		if (mAnimator.Create (mVine))
+			mAnimator.Play ("Sway");
+
+		mVine->PurgeGeometry();
+	}
+
+	mStone = Content::Load<Model> ("Models/Stone.ast");
+
+	if (mStone != nullptr)
+	{
+		mStone->LoadTextures();
+		mStone->LoadGeometry();
+		mStone->LoadMaterials();
+
+		mStone->UnloadTextures();
+		mStone->PurgeTextures();
+		mStone->PurgeGeometry();
+
+		// Scatter the stones in a loose ring, they never move
+		for (quint32 i = 0; i < StoneCount; ++i)
+		{
+			float angle = Math::ToRadians (i * 360.0f / StoneCount);
+			float distance = 10.0f + mRandom->NextReal() * 4.0f;
+			float scale = 1.5f + mRandom->NextReal() * 1.5f;
+
+			Matrix world = Matrix::CreateTranslation
+				(25 + distance * Math::Cosr (angle), 0,
+				 35 + distance * Math::Sinr (angle)) *
+				Matrix::CreateRotationY (mRandom->NextReal() * 6.2832f) *
+				Matrix::CreateScale (scale);
+
+			mStoneWorlds.append (world);
+			mStoneBounds.append (BoundingBox::Transform
+				(mStone->Meshes[0]->Bounds, world));
+		}
+
+		mStones.SetModel (mStone);
+	}
+
+	mClouds = Content::Load<ParticleSystem> ("Particles/Clouds.ast");
+	mRain   = Content::Load<ParticleSystem> ("Particles/Rain.ast");
+	mStars  = Content::Load<ParticleSystem> ("Particles/Stars.ast");
 
 	if (mClouds != nullptr) mClouds->Load();
 	if (mRain   != nullptr) mRain  ->Load();
 	if (mStars  != nullptr) mStars ->Load();
 
+	// Clouds and rain overlap themselves, the stars are too far apart
+	if (mClouds != nullptr) mClouds->DepthSort = true;
+	if (mRain   != nullptr) mRain  ->DepthSort = true;
+
 	mStopRain = false;
+	mTimeRecording = false;
+	mLastTime = 0;
+
+	// Simulate the spray on the GPU, falling back to the CPU
+	if (mSpray.Load (SprayCapacity) || mSpray.Load (SprayCapacity, true))
+	{
+		AssetHandle<Texture> texture = Content::Load<Texture> ("Textures/Rain.ast");
+		mSpray.SetTexture (texture);
+		texture.Release();
+
+		mSpray.Position		= Vector3 (25.0f, 0.0f, 35.0f);
+		mSpray.Velocity		= Vector3 ( 0.0f, 25.0f, 0.0f);
+		mSpray.Spread		= 6.0f;
+		mSpray.Rate			= 400.0f;
+		mSpray.MinLife		= 2.0f;
+		mSpray.MaxLife		= 4.0f;
+		mSpray.Wind			= Vector3 (4.0f, 0.0f, 2.0f);
+		mSpray.Drag			= 0.2f;
+		mSpray.Bounce		= 0.3f;
+		mSpray.Diffuse		= Color (0.6f, 0.8f, 1.0f);
+		mSpray.Alpha		= 0.6f;
+		mSpray.Size			= 0.5f;
+		mSpray.DepthSort	= mSpray.IsSoftware();
+	}
+
+	// One command buffer per worker thread
+	mBuffers.resize (qBound (1, QThread::idealThreadCount(), 8));
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -121,19 +321,24 @@ Demo::~Demo (void)
 	if (mLight1  != nullptr) delete mLight1;
 	if (mLight2  != nullptr) delete mLight2;
 
-	if (mDefault != nullptr) mDefault->Release();
 	if (mRandom  != nullptr) delete mRandom;
 
-	if (mSky   != nullptr) mSky  ->Release();
-	if (mPhong != nullptr) mPhong->Release();
-	if (mQuad  != nullptr) mQuad ->Release();
+	mAnimator.Destroy();
+	mSpray.Unload();
 
-	if (mJungle != nullptr) mJungle->Release();
-	if (mSphere != nullptr) mSphere->Release();
+	mSky    .Release();
+	mPhong  .Release();
+	mQuad   .Release();
+	mSkinned.Release();
 
-	if (mClouds != nullptr) mClouds->Release();
-	if (mRain   != nullptr) mRain  ->Release();
-	if (mStars  != nullptr) mStars ->Release();
+	mJungle.Release();
+	mSphere.Release();
+	mVine  .Release();
+	mStone .Release();
+
+	mClouds.Release();
+	mRain  .Release();
+	mStars .Release();
 }
 
 
@@ -147,8 +352,12 @@ Demo::~Demo (void)
 
 void Demo::Update (quint32 elapsedTime, quint32 totalTime)
 {
-	// Recreate buffers if the viewport has changed
-	if (Engine::HasSizeChanged()) mShadowMap->Create();
+	// The shadow map does not depend on the viewport
+	if (mShadowMap->GetID() == 0)
+	{
+		mShadowMap->BlurRadius = ShadowBlurRadius;
+		mShadowMap->Create (ShadowSize, ShadowCascades, ShadowDownsample);
+	}
 
 	// Update keyboard state
 	mCurrKeyboard.Sync();
@@ -173,6 +382,31 @@ void Demo::Update (quint32 elapsedTime, quint32 totalTime)
 		 mCurrKeyboard.Keys[SDLK_KP5])
 		mStopRain = !mStopRain;
 
+	// Print sort timings
+	if (!mPrevKeyboard.Keys[SDLK_KP9] &&
+		 mCurrKeyboard.Keys[SDLK_KP9])
+		RadixSort::Benchmark();
+
+	// Print skinning timings
+	if (!mPrevKeyboard.Keys[SDLK_KP7] &&
+		 mCurrKeyboard.Keys[SDLK_KP7])
+		SkinBuffer::Benchmark();
+
+	// Print occlusion timings
+	if (!mPrevKeyboard.Keys[SDLK_KP8] &&
+		 mCurrKeyboard.Keys[SDLK_KP8])
+		OcclusionBuffer::Benchmark();
+
+	// Print particle timings
+	if (!mPrevKeyboard.Keys[SDLK_KP6] &&
+		 mCurrKeyboard.Keys[SDLK_KP6])
+		ParticleBuffer::Benchmark();
+
+	// Print recording timings of the next frame
+	if (!mPrevKeyboard.Keys[SDLK_KP4] &&
+		 mCurrKeyboard.Keys[SDLK_KP4])
+		mTimeRecording = true;
+
 	// Save keyboard state
 	mPrevKeyboard = mCurrKeyboard;
 
@@ -194,29 +428,25 @@ void Demo::Update (quint32 elapsedTime, quint32 totalTime)
 	mLight1->Position = mCamera1->Position;
 	mLight2->Position = mCamera2->Position;
 
-	// Update matrix values
-	Matrix modelViewProj = Engine::GetPerspective() * mActiveCamera->View;
+	// Update the shared uniform blocks
+	const Light* lights[] = { mLight1, mLight2 };
+	UniformBlocks::SetCamera (mActiveCamera->View, Engine::GetPerspective());
+	UniformBlocks::SetLights (lights, 2);
 
-	// Update shader values
-	if (mPhong != nullptr)
-	{
-		mPhong->SetValue ("Projection", Engine::GetPerspective());
-		mPhong->SetValue ("ModelView", mActiveCamera->View);
+	// Slowly rotate the sky sphere
+	mSkyWorld = Matrix::CreateFromAxisAngle
+		(Vector3::UnitY, Math::ToRadians (totalTime / 500.0f));
 
-		mPhong->SetValue ("LightCount", 2);
-		mPhong->SetValue ("LightPos[0]", mLight1->Position);
-		mPhong->SetValue ("LightPos[1]", mLight2->Position);
-		mPhong->SetValue ("LightColor[0]", mLight1->Diffuse);
-		mPhong->SetValue ("LightColor[1]", mLight2->Diffuse);
+	// The engine counts frames, animations and particles need milliseconds
+	quint32 frameTime = mLastTime == 0 ? 0 : totalTime - mLastTime;
+	frameTime = qMin (frameTime, MaxFrameTime);
+	mLastTime = totalTime;
 
-		mPhong->SetValue ("ShadowLight", Engine::GetPerspective() * mCamera3->View);
-	}
+	mAnimator.Update (frameTime);
 
-	if (mSky != nullptr)
-	{
-		mSky->SetValue ("ModelViewProj", Engine::GetPerspective() * mActiveCamera->View *
-			Matrix::CreateFromAxisAngle (Vector3::UnitY, Math::ToRadians (totalTime / 500.0f)));
-	}
+	// Software particles are sorted for the active camera
+	mSpray.View = mActiveCamera->View;
+	mSpray.Update (frameTime);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -224,61 +454,168 @@ void Demo::Update (quint32 elapsedTime, quint32 totalTime)
 
 void Demo::Render (quint32 elapsedTime, quint32 totalTime)
 {
+	// Resolve the handles once, nothing below locks the content
+	mFrame.Sky     = mSky;
+	mFrame.Phong   = mPhong;
+	mFrame.Skinned = mSkinned;
+	mFrame.Jungle  = mJungle;
+	mFrame.Sphere  = mSphere;
+	mFrame.Vine    = mVine;
+	mFrame.Stone   = mStone;
+
 	// Ensure that the model is valid
-	if (mJungle == nullptr ||
-		mPhong  == nullptr ||
-		mSphere == nullptr) return;
-	
-	// Render the depth map
-	mShadowMap->Begin (*mCamera3);
-	for (quint32 i = 0; i < mJungle->Meshes.Length(); ++i)
-		mJungle->Meshes[i]->Draw();
-	mShadowMap->End();
+	if (mFrame.Jungle == nullptr ||
+		mFrame.Phong  == nullptr ||
+		mFrame.Sky    == nullptr ||
+		mFrame.Sphere == nullptr) return;
 
-	// Set shadow map inside the shader
-	GL_CALL (glActiveTexture (GL_TEXTURE6));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, mShadowMap->GetID()));
-	mPhong->SetValue ("ShadowMap", 6);
-	
-	// Render the final model on the screen
-	for (quint32 i = 0; i < mJungle->Meshes.Length(); ++i)
+	// Build this frame's draw packets
+	mQueue.Clear();
+	Submit (mFrame.Jungle, Matrix::Identity);
+	Submit (mFrame.Sphere, mSkyWorld);
+
+	if (mFrame.Vine != nullptr && mFrame.Skinned != nullptr)
+		Submit (mFrame.Vine, mVineWorld);
+
+	// Fit the light around the scene, the sky does not cast shadows
+	const Matrix& projection = Engine::GetPerspective();
+	BoundingBox scene (Vector3::Zero, Vector3::Zero);
+	bool first = true;
+
+	for (quint32 i = 0; i < mQueue.GetPacketCount(); ++i)
 	{
-		// Get the model mesh
-		Mesh* mesh = mJungle->Meshes[i];
-		if (mesh->Material < 0) continue;
+		if (mQueue.GetPacket (i).Bucket == RenderQueue::BackgroundLayer) continue;
+		const BoundingBox& bounds = mQueue.GetBounds()[i];
+
+		scene = first ? bounds : BoundingBox::CreateMerged (scene, bounds);
+		first = false;
+	}
+
+	mShadowMap->Fit (*mCamera3, scene, mActiveCamera->View, projection);
+
+	// Cull against the camera
+	mQueue.Cull (BoundingFrustum (projection * mActiveCamera->View), mVisible);
+
+	// Hide packets behind the occluders
+	if (mOcclusion.HasOccluders())
+	{
+		mOcclusion.Render (projection * mActiveCamera->View);
+		mOcclusion.Cull (mQueue.GetPacketCount(),
+			mQueue.GetBounds(), mVisible.data());
+	}
 
-		// Apply the material
-		ApplyMaterial (mPhong, mJungle,
-			mJungle->Materials[mesh->Material]);
+	// Sort the packets visible to the camera
+	mQueue.Sort (mActiveCamera->View, Engine::GetFarClip(), mVisible.constData());
 
-		// Draw the mesh
-		mesh->Draw();
+	// Render every cascade of the depth map
+	for (quint32 c = 0; c < mShadowMap->GetCascadeCount(); ++c)
+	{
+		// Cull against the cascade
+		mQueue.Cull (BoundingFrustum (mShadowMap->GetMatrix (c)), mShadowVisible);
+
+		// Skip cascades whose light and casters have not changed
+		quint32 casters = HashCasters (mQueue, mShadowVisible.constData(), mFrame.Phong);
+		if (mShadowMap->IsCached (c, casters)) continue;
+
+		// Skinned packets do not cast, the depth shader has no bone palette
+		mShadowMap->Begin (*mCamera3, c);
+		for (quint32 i = 0; i < mQueue.GetPacketCount(); ++i)
+		{
+			const RenderQueue::Packet& packet = mQueue.GetPacket (i);
+			if (packet.Program != mFrame.Phong || !mShadowVisible[i]) continue;
+
+			if (packet.Part < 0)
+			{
+				mShadowMap->Draw (packet.Geometry, packet.Transform);
+				continue;
+			}
+
+			// Subsets were submitted back to back, merge the visible ones
+			const Mesh* mesh = packet.Geometry;
+			mFlags.resize (mesh->Subsets.size());
+			memset (mFlags.data(), 0, mFlags.size());
+			mFlags[packet.Part] = 1;
+
+			while (i + 1 < mQueue.GetPacketCount() &&
+				IsSameDraw (packet, mQueue.GetPacket (i + 1)))
+			{
+				if (mShadowVisible[++i])
+					mFlags[mQueue.GetPacket (i).Part] = 1;
+			}
+
+			mRanges.resize (2 * mFlags.size());
+			quint32 count = mesh->MergeSubsets (mFlags.constData(), mRanges.data());
+			mShadowMap->Draw (mesh, packet.Transform, mRanges.constData(), count);
+		}
+		mShadowMap->End (c, casters);
 	}
 
-	// Render the sky sphere
-	for (quint32 i = 0; i < mSphere->Meshes.Length(); ++i)
+	// Upload the cascades even when every layer was cached
+	UniformBlocks::Update();
+
+	// Set shadow map inside the shader
+	RenderState::BindTexture (6, GL_TEXTURE_2D_ARRAY, mShadowMap->GetID());
+	mFrame.Phong->SetValue (mPhongUniforms.ShadowMap, 6);
+
+	// Skinned packets read the bone palette
+	if (mFrame.Skinned != nullptr)
 	{
-		// Get the model mesh
-		Mesh* mesh = mSphere->Meshes[i];
-		if (mesh->Material < 0) continue;
+		mFrame.Skinned->SetValue (mSkinnedUniforms.ShadowMap, 6);
+		mAnimator.Apply();
+	}
+
+	if (mTimeRecording)
+	{
+		BenchmarkQueue();
+		mTimeRecording = false;
+	}
+
+	// Split the sorted packets between the workers
+	quint32 count = qBound<quint32> (1,
+		mQueue.Length() / MinPacketsPerJob, mBuffers.size());
+
+	RecordQueue (count);
+
+	// Replay the commands in queue order
+	for (quint32 i = 0; i < count; ++i)
+		mBuffers[i].Execute();
 
-		// Apply the material
-		mSky->SetValue ("Texture", mSphere->Textures
-			[mSphere->Materials[mesh->Material]->Diffuse.Texture], 7);
+	// Stones share one draw per mesh and cast no shadows,
+	// the depth shader only reads the world uniform
+	if (mFrame.Stone != nullptr)
+	{
+		mStones.Clear();
+		BoundingFrustum frustum (projection * mActiveCamera->View);
+
+		mStoneVisible.resize (mStoneBounds.size());
+		frustum.Cull (mStoneBounds.size(),
+			mStoneBounds.constData(), mStoneVisible.data());
+
+		for (qint32 i = 0; i < mStoneWorlds.size(); ++i)
+			if (mStoneVisible[i]) mStones.Add (mStoneWorlds[i]);
 
-		// Draw the mesh
-		mesh->Draw();
+		if (mStones.Upload()) DrawBatch (mStones);
 	}
 
-	// Draw the particle systems
+	// Draw the particle systems, sorted at the time the shader sees
+	float time = UniformBlocks::GetFrame().Time;
+
 	if (mClouds != nullptr)
-		mClouds->Draw (totalTime, mActiveCamera->View);
+	{
+		mClouds->Sort (mActiveCamera->View, time);
+		mClouds->Draw();
+	}
 
 	if (mRain != nullptr && !mStopRain)
-		mRain->Draw (totalTime, mActiveCamera->View);
+	{
+		mRain->Sort (mActiveCamera->View, time);
+		mRain->Draw();
+	}
 
 	if (mStars != nullptr)
-		mStars->Draw (totalTime, mActiveCamera->View);
+		mStars->Draw();
+
+	mSpray.Draw();
 }
 
 
@@ -290,37 +627,239 @@ void Demo::Render (quint32 elapsedTime, quint32 totalTime)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-void Demo::ApplyMaterial (Shader* shader, const Model* model, const Material* material) const
+void Demo::LoadUniforms (void)
+{
+	if (mPhong   != nullptr) LoadUniforms (mPhong,   mPhongUniforms  );
+	if (mSkinned != nullptr) LoadUniforms (mSkinned, mSkinnedUniforms);
+
+	if (mSky != nullptr)
+	{
+		mSkyUniforms.World		= mSky->Handle ("World");
+		mSkyUniforms.Texture	= mSky->Handle ("Texture");
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Looks up the uniforms shared by the lit shaders. </summary>
+
+void Demo::LoadUniforms (Shader* shader, PhongUniforms& uniforms)
+{
+	uniforms.World		= shader->Handle ("World");
+	uniforms.ShadowMap	= shader->Handle ("ShadowMap");
+	uniforms.Instanced	= shader->Handle ("Instanced");
+
+	// Material textures always use the same units
+	shader->SetValue ("AmbientTexture",  1 + Material::AmbientSlot );
+	shader->SetValue ("DiffuseTexture",  1 + Material::DiffuseSlot );
+	shader->SetValue ("SpecularTexture", 1 + Material::SpecularSlot);
+	shader->SetValue ("EmissiveTexture", 1 + Material::EmissiveSlot);
+	shader->SetValue ("NormalTexture",   1 + Material::NormalSlot  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records the draw commands of a range of queued packets. </summary>
+/// Called from worker threads, so no GL calls are allowed here
+
+void Demo::Record (CommandBuffer& buffer, quint32 begin, quint32 end) const
+{
+	buffer.Reset();
+
+	QVarLengthArray<quint8,  64> flags;
+	QVarLengthArray<quint32, 64> ranges;
+
+	const Material* applied = nullptr;
+	for (quint32 i = begin; i < end; ++i)
+	{
+		const RenderQueue::Packet& packet = mQueue[i];
+
+		if (packet.Program == mFrame.Phong ||
+			packet.Program == mFrame.Skinned)
+		{
+			// Packets sharing a material are adjacent
+			if (packet.Surface != applied)
+			{
+				ApplyMaterial (buffer, packet.Owner, packet.Geometry->Material);
+				applied = packet.Surface;
+			}
+
+			buffer.SetValue (packet.Program, packet.Program == mFrame.Phong ?
+				mPhongUniforms.World : mSkinnedUniforms.World, packet.Transform);
+		}
+
+		else
+		{
+			buffer.SetValue (packet.Program, mSkyUniforms.World, packet.Transform);
+			buffer.SetValue (packet.Program, mSkyUniforms.Texture, packet.Owner->Textures
+				[packet.Surface->Diffuse.Texture], 7);
+		}
+
+		// Whole meshes and sorted transparent subsets draw alone
+		if (packet.Part < 0 || packet.Bucket == RenderQueue::TransparentLayer)
+		{
+			buffer.Draw (packet.Geometry, packet.Part);
+			continue;
+		}
+
+		// Opaque subsets sharing a material are grouped by the sort,
+		// those following each other in index order share one draw
+		const Mesh* mesh = packet.Geometry;
+		flags.resize (mesh->Subsets.size());
+		memset (flags.data(), 0, flags.size());
+		flags[packet.Part] = 1;
+
+		while (i + 1 < end && IsSameDraw (packet, mQueue[i + 1]))
+			flags[mQueue[++i].Part] = 1;
+
+		ranges.resize (2 * flags.size());
+		quint32 count = mesh->MergeSubsets (flags.constData(), ranges.data());
+
+		if (count == 0) buffer.Draw (mesh);
+		for (quint32 r = 0; r < count; ++r)
+			buffer.DrawRange (mesh, ranges[2 * r], ranges[2 * r + 1]);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records the sorted packets into the first count
+/// 		  buffers as contiguous ranges. </summary>
+
+void Demo::RecordQueue (quint32 count)
+{
+	quint32 length = mQueue.Length();
+	quint32 range  = (length + count - 1) / count;
+
+	mJobs.resize (count);
+	for (quint32 i = 0; i < count; ++i)
+	{
+		mJobs[i].Owner  = this;
+		mJobs[i].Buffer = &mBuffers[i];
+		mJobs[i].Begin  = qMin (i * range, length);
+		mJobs[i].End    = qMin (i * range + range, length);
+	}
+
+	// Record every range in parallel
+	if (count > 1)
+		QtConcurrent::blockingMap (mJobs, &RecordJob::Run);
+	else mJobs[0].Run();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Prints how long recording this frame's queue takes
+/// 		  for every number of workers. </summary>
+
+void Demo::BenchmarkQueue (void)
+{
+	QElapsedTimer timer;
+
+	Console::Message ("\nRecord benchmark");
+	Console::Message ("----------------");
+	Console::Message ("%u packets, %u per job minimum",
+		mQueue.Length(), MinPacketsPerJob);
+
+	for (quint32 count = 1; count <= (quint32) mBuffers.size(); ++count)
+	{
+		// Take the best of several runs
+		qint64 best = -1;
+		for (quint32 run = 0; run < 5; ++run)
+		{
+			timer.start();
+			RecordQueue (count);
+			qint64 elapsed = timer.nsecsElapsed();
+
+			if (best < 0 || elapsed < best)
+				best = elapsed;
+		}
+
+		Console::Message ("%8u jobs: %8.3f ms", count, best / 1000000.0);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Demo::ApplyMaterial (CommandBuffer& buffer,
+	const Model* model, qint32 material) const
+{
+	// Constants come from the precompiled material block
+	buffer.BindBlock (model->GetMaterialBuffer(), UniformBuffer::MaterialBinding,
+		model->GetMaterialOffset (material), sizeof (Material::Block));
+
+	// Materials sharing arrays only differ by their layers,
+	// so these binds are filtered out by the render state
+	for (quint32 i = 0; i < Material::SlotCount; ++i)
+	{
+		const TextureArray* array = model->GetMaterialTexture
+			(material, (Material::TextureSlot) i);
+
+		// Missing textures are never sampled
+		if (array != nullptr)
+		{
+			buffer.BindTexture (1 + i, array->GetTexID(),
+				CommandBuffer::Texture2DArray);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Queues every mesh of a model using its material. </summary>
+
+void Demo::Submit (const Model* model, const Matrix& world)
 {
-	if (shader == nullptr) return;
+	// The sky sphere uses its own shader
+	bool sky = model == mFrame.Sphere;
+
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		// Get the model mesh
+		const Mesh* mesh = model->Meshes[i];
+		if (mesh->Material < 0) continue;
+
+		const Material* material = model->Materials[mesh->Material];
+
+		RenderQueue::Layer layer = sky ? RenderQueue::BackgroundLayer :
+			material->Alpha < 1.0f ? RenderQueue::TransparentLayer :
+			RenderQueue::OpaqueLayer;
 
-	shader->SetValue ("Ambient.Color",  material->Ambient.Color );
-	shader->SetValue ("Diffuse.Color",  material->Diffuse.Color );
-	shader->SetValue ("Specular.Color", material->Specular.Color);
-	shader->SetValue ("Emissive.Color", material->Emissive.Color);
+		// Skinned models read the bone palette of the animator
+		Shader* shader = sky ? mFrame.Sky : model->GetSkeleton() != nullptr ?
+			mFrame.Skinned : mFrame.Phong;
 
-	if (material->Ambient.Texture != -1)
-		 shader->SetValue ("Ambient.Texture", model->Textures[material->Ambient.Texture], 1);
-	else shader->SetValue ("Ambient.Texture", mDefault, 1);
+		// Merged meshes are culled one source mesh at a time
+		if (mesh->Subsets.isEmpty())
+			mQueue.Submit (layer, shader, model, mesh, material, world);
 
-	if (material->Diffuse.Texture != -1)
-		 shader->SetValue ("Diffuse.Texture", model->Textures[material->Diffuse.Texture], 2);
-	else shader->SetValue ("Diffuse.Texture", mDefault, 2);
+		for (qint32 s = 0; s < mesh->Subsets.size(); ++s)
+			mQueue.Submit (layer, shader, model, mesh, material, world, s);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws every uploaded instance of a batch with Phong. </summary>
+/// Must run after the recorded buffers, it issues GL calls directly
+
+void Demo::DrawBatch (const ModelInstanceBatch& batch)
+{
+	if (batch.IsEmpty()) return;
+	const Model* model = batch.GetModel();
 
-	if (material->Specular.Texture != -1)
-		 shader->SetValue ("Specular.Texture", model->Textures[material->Specular.Texture], 3);
-	else shader->SetValue ("Specular.Texture", mDefault, 3);
+	// Read world matrices from the instance stream
+	mFrame.Phong->SetValue (mPhongUniforms.Instanced, true);
 
-	if (material->Emissive.Texture != -1)
-		 shader->SetValue ("Emissive.Texture", model->Textures[material->Emissive.Texture], 4);
-	else shader->SetValue ("Emissive.Texture", mDefault, 4);
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+	{
+		const Mesh* mesh = model->Meshes[i];
+		if (mesh->Material < 0) continue;
 
-	shader->SetValue ("Alpha", material->Alpha);
-	shader->SetValue ("Shininess", material->Shininess);
+		CommandBuffer& buffer = mBuffers[0];
+		buffer.Reset();
+		buffer.UseProgram (mFrame.Phong);
+		ApplyMaterial (buffer, model, mesh->Material);
+		buffer.Execute();
+
+		batch.Draw (i);
+	}
 
-	if (material->Normal != -1)
-		 shader->SetValue ("Normal", model->Textures[material->Normal], 5);
-	else shader->SetValue ("Normal", 0);
+	mFrame.Phong->SetValue (mPhongUniforms.Instanced, false);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
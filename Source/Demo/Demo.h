@@ -30,6 +30,15 @@ class ShadowMap;
 #include <QGlobal.h>
 
 #include "Engine/Input.h"
+#include "Content/Content.h"
+#include "Graphics/Shader.h"
+#include "Graphics/RenderQueue.h"
+#include "Graphics/CommandBuffer.h"
+#include "Graphics/OcclusionBuffer.h"
+#include "Graphics/Animator.h"
+#include "Graphics/ParticleSimulator.h"
+#include "Graphics/ModelInstanceBatch.h"
+#include <QVector.h>
 
 
 
@@ -42,6 +51,65 @@ class ShadowMap;
 
 class Demo
 {
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class PhongUniforms
+	{
+	public:
+		// Properties
+		UniformHandle	World;
+		UniformHandle	ShadowMap;
+		UniformHandle	Instanced;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class SkyUniforms
+	{
+	public:
+		// Properties
+		UniformHandle	World;
+		UniformHandle	Texture;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Assets resolved once at the start of a frame. </summary>
+	/// Workers read these instead of locking the content manager
+
+	class FrameAssets
+	{
+	public:
+		// Properties
+		Shader*			Sky;
+		Shader*			Phong;
+		Shader*			Skinned;
+		Model*			Jungle;
+		Model*			Sphere;
+		Model*			Vine;
+		Model*			Stone;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Records a range of queued packets on a worker thread. </summary>
+
+	class RecordJob
+	{
+	public:
+		// Methods
+		void Run (void) { Owner->Record (*Buffer, Begin, End); }
+
+	public:
+		// Properties
+		const Demo*		Owner;			// Demo owning the queue
+		CommandBuffer*	Buffer;			// Buffer receiving commands
+		quint32			Begin;			// First packet to record
+		quint32			End;			// One past the last packet
+	};
+
 public:
 	// Constructors
 	 Demo (void);
@@ -54,8 +122,16 @@ public:
 
 private:
 	// Internal
-	void ApplyMaterial	(Shader* shader, const Model* model, const Material* material) const;
-
+	void LoadUniforms	(void);
+	void LoadUniforms	(Shader* shader, PhongUniforms& uniforms);
+	void Record			(CommandBuffer& buffer, quint32 begin, quint32 end) const;
+	void RecordQueue	(quint32 count);
+	void BenchmarkQueue	(void);
+	void ApplyMaterial	(CommandBuffer& buffer, const Model* model,
+						 qint32 material) const;
+
+	void Submit			(const Model* model, const Matrix& world);
+	void DrawBatch		(const ModelInstanceBatch& batch);
 	void DrawQuad		(qint32 x, qint32 y, qint32 width, qint32 height) const;
 
 private:
@@ -69,24 +145,51 @@ private:
 	Light*				mLight1;
 	Light*				mLight2;
 
-	Texture*			mDefault;
 	Random*				mRandom;
 
-	Shader*				mSky;
-	Shader*				mPhong;
-	Shader*				mQuad;
-
-	Model*				mJungle;
-	Model*				mSphere;
+	AssetHandle<Shader>	mSky;
+	AssetHandle<Shader>	mPhong;
+	AssetHandle<Shader>	mQuad;
+	AssetHandle<Shader>	mSkinned;
+
+	PhongUniforms		mPhongUniforms;
+	PhongUniforms		mSkinnedUniforms;
+	SkyUniforms			mSkyUniforms;
+	RenderQueue			mQueue;
+	QVector<quint8>		mVisible;		// Packets seen by the camera
+	QVector<quint8>		mShadowVisible;	// Packets seen by a shadow cascade
+	QVector<quint8>		mFlags;			// Visible subsets of a caster
+	QVector<quint32>	mRanges;		// Merged caster index ranges
+	OcclusionBuffer		mOcclusion;		// Hides packets behind the jungle
+	QVector<CommandBuffer> mBuffers;
+	QVector<RecordJob>	mJobs;
+	Matrix				mSkyWorld;
+
+	AssetHandle<Model>	mJungle;
+	AssetHandle<Model>	mSphere;
+	AssetHandle<Model>	mVine;
+	FrameAssets			mFrame;			// Handles resolved this frame
+
+	Animator			mAnimator;		// Skins the vine on the GPU
+	Matrix				mVineWorld;
+
+	AssetHandle<Model>	mStone;
+	ModelInstanceBatch	mStones;		// Visible stones around the spray
+	QVector<Matrix>		mStoneWorlds;
+	QVector<BoundingBox> mStoneBounds;	// World bounds of every stone
+	QVector<quint8>		mStoneVisible;
 
 	Keyboard			mPrevKeyboard;
 	Keyboard			mCurrKeyboard;
 
-	ParticleSystem*		mClouds;
-	ParticleSystem*		mRain;
-	ParticleSystem*		mStars;
+	AssetHandle<ParticleSystem> mClouds;
+	AssetHandle<ParticleSystem> mRain;
+	AssetHandle<ParticleSystem> mStars;
+	ParticleSimulator	mSpray;			// Water bouncing off the ground
 
 	bool				mStopRain;
+	bool				mTimeRecording;	// Time the next frame's recording
+	quint32				mLastTime;		// Total time of the previous update
 };
 
 #endif // DEMO_H
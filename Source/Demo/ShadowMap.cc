@@ -12,6 +12,9 @@
 //----------------------------------------------------------------------------//
 
 #include "Math/Matrix.h"
+#include "Math/Vector3.h"
+#include "Math/BoundingBox.h"
+#include "Math/Math.h"
 
 #include "Demo/Camera.h"
 #include "Demo/ShadowMap.h"
@@ -20,6 +23,8 @@
 
 #include "Graphics/Mesh.h"
 #include "Graphics/Shader.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/UniformBlocks.h"
 #include "Content/Content.h"
 
 #define GLEW_STATIC
@@ -36,9 +41,12 @@
 
 ShadowMap::ShadowMap (void)
 {
-	mDepth		= nullptr;
-	mBlurH		= nullptr;
-	mBlurV		= nullptr;
+	Distance		= 1500.0f;
+	Lambda			= 0.75f;
+	BlurRadius		= 4;
+
+	mTapCount		= 0;
+	mKernelRadius	= 0;
 
 	mColorTexID		= 0;
 	mDepthTexID		= 0;
@@ -46,6 +54,24 @@ ShadowMap::ShadowMap (void)
 
 	mBlurTexID		= 0;
 	mBlurBufferID	= 0;
+
+	mCascadeTexID	= 0;
+	mCascadeBufferID= 0;
+
+	mSize			= 0;
+	mBlurSize		= 0;
+	mCascadeCount	= 0;
+
+	for (quint32 i = 0; i < MaxCascades; ++i)
+	{
+		mProjections[i] = Matrix::Identity;
+		mMatrices	[i] = Matrix::Identity;
+		mNears		[i] = 0;
+		mFars		[i] = 1;
+		mSplits		[i] = 0;
+	}
+
+	Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -63,90 +89,235 @@ ShadowMap::~ShadowMap (void)
 // Methods                                                         BlurFilter //
 //----------------------------------------------------------------------------//
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Splits the view frustum and fits a stable orthographic light
+/// 		  projection around every slice. </summary>
+/// Splits blend logarithmic and uniform partitions by Lambda, depth always
+/// spans the whole scene so casters outside the view still cast shadows
+
+void ShadowMap::Fit (const Camera& light, const BoundingBox& scene,
+	const Matrix& view, const Matrix& projection)
+{
+	if (mCascadeCount == 0) return;
+	const Matrix& lightView = light.View;
+
+	// Cached layers were blurred with the previous kernel
+	if (mTapCount != 0 && mKernelRadius != BlurRadius)
+		Invalidate();
+
+	// Scene bounds in light space, every caster and receiver is inside
+	// them so the depth range follows the scene instead of the camera
+	BoundingBox bounds = BoundingBox::Transform (scene, lightView);
+	float sceneNear = -bounds.Max.Z - 1.0f;
+	float sceneFar  = -bounds.Min.Z + 1.0f;
+
+	// Half extents of the frustum at a depth of one
+	float tanX = 1.0f / projection.M11;
+	float tanY = 1.0f / projection.M22;
+
+	float nearClip = Engine::GetNearClip();
+	float farClip  = Math::Min (Distance, Engine::GetFarClip());
+
+	Matrix inverse = Matrix::Invert (view);
+	float start = nearClip;
+
+	for (quint32 c = 0; c < mCascadeCount; ++c)
+	{
+		// Practical split scheme
+		float f = (c + 1) / (float) mCascadeCount;
+		float logSplit = nearClip * Math::Pow (farClip / nearClip, f);
+		float uniSplit = nearClip + (farClip - nearClip) * f;
+		float end = Lambda * logSplit + (1 - Lambda) * uniSplit;
+
+		// Corners of the slice in world space
+		Vector3 corners[8];
+		Vector3 center (0, 0, 0);
+
+		for (quint32 i = 0; i < 8; ++i)
+		{
+			float d = (i & 4) ? end : start;
+			float x = ((i & 1) ? d : -d) * tanX;
+			float y = ((i & 2) ? d : -d) * tanY;
+			float z = -d;
+
+			const Matrix& m = inverse;
+			corners[i] = Vector3
+			(
+				m.M11 * x + m.M12 * y + m.M13 * z + m.M14,
+				m.M21 * x + m.M22 * y + m.M23 * z + m.M24,
+				m.M31 * x + m.M32 * y + m.M33 * z + m.M34
+			);
+
+			center += corners[i] * 0.125f;
+		}
+
+		// A bounding sphere keeps the size constant as the camera turns
+		float radius = 0;
+		for (quint32 i = 0; i < 8; ++i)
+			radius = Math::Max (radius, Vector3::DistanceSquared (center, corners[i]));
+		radius = Math::Ceiling (Math::Sqrt (radius));
+
+		// Snap the center to whole texels so shadows do not shimmer
+		float texel = 2 * radius / mBlurSize;
+		const Matrix& m = lightView;
+
+		float cx = m.M11 * center.X + m.M12 * center.Y + m.M13 * center.Z + m.M14;
+		float cy = m.M21 * center.X + m.M22 * center.Y + m.M23 * center.Z + m.M24;
+
+		cx = Math::Floor (cx / texel) * texel;
+		cy = Math::Floor (cy / texel) * texel;
+
+		// The light looks down its negative z axis
+		mNears[c] = sceneNear;
+		mFars [c] = sceneFar;
+
+		mProjections[c] = Matrix::CreateOrthographicOffCenter (cx - radius,
+			cx + radius, cy - radius, cy + radius, mNears[c], mFars[c]);
+
+		mMatrices[c] = mProjections[c] * lightView;
+		mSplits  [c] = end;
+		start = end;
+	}
+
+	// Publish the cascades to the lights block
+	UniformBlocks::SetCascades (mMatrices, mSplits, mCascadeCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether a cascade layer still holds the shadows of its
+/// 		  current light matrix and the given version of its casters. </summary>
+/// Cached layers can skip rendering and blurring entirely
+
+bool ShadowMap::IsCached (quint32 cascade, quint32 casters) const
+{
+	return mCachedValid	   [cascade] &&
+		   mCachedCasters  [cascade] == casters &&
+		   mCachedMatrices [cascade] == mMatrices[cascade];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Forces every cascade to be rendered again. </summary>
+
+void ShadowMap::Invalidate (void)
+{
+	for (quint32 i = 0; i < MaxCascades; ++i)
+		mCachedValid[i] = false;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-void ShadowMap::Begin (const Camera& camera) const
+void ShadowMap::Begin (const Camera& light, quint32 cascade) const
 {
 	if (mDepth == nullptr ||
 		mBlurH == nullptr ||
 		mBlurV == nullptr) return;
 
-	quint32 width  = Engine::GetWindowWidth ();
-	quint32 height = Engine::GetWindowHeight();
-
 	// Render a depth map using the position of the light
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, mShadowBufferID));
-	GL_CALL (glViewport (0, 0, width, height));
+	RenderState::BindFramebuffer (mShadowBufferID);
+	RenderState::SetViewport (0, 0, mSize, mSize);
 	GL_CALL (glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
-	mDepth->SetValue ("Near", 10.0f);
-	mDepth->SetValue ("Far", 1000.0f);
-	mDepth->SetValue ("ModelView", camera.View);
-	mDepth->SetValue ("Projection", Engine::GetPerspective());
+	// Publish the cascade camera to the lights block
+	UniformBlocks::SetShadow (light.View,
+		mProjections[cascade], mNears[cascade], mFars[cascade]);
+	UniformBlocks::Update();
+
+	mDepth->Use();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// <summary> </summary>
+/// <summary> Draws a mesh into the depth map at the given world transform. </summary>
+/// Only the given subset is drawn unless it's negative
 
-void ShadowMap::End (void) const
+void ShadowMap::Draw (const Mesh* mesh, const Matrix& world,
+	const quint32* ranges, quint32 count) const
+{
+	if (mDepth == nullptr) return;
+
+	mDepth->SetValue (mWorld, world);
+	if (count == 0) { mesh->Draw(); return; }
+
+	// Ranges are first and count pairs of indices
+	for (quint32 i = 0; i < count; ++i)
+		mesh->DrawRange (ranges[2 * i], ranges[2 * i + 1]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Blurs the depth map into its cascade layer and remembers
+/// 		  what it was rendered with. </summary>
+
+void ShadowMap::End (quint32 cascade, quint32 casters)
 {
 	if (mDepth == nullptr ||
 		mBlurH == nullptr ||
 		mBlurV == nullptr) return;
 
+	mCachedMatrices[cascade] = mMatrices[cascade];
+	mCachedCasters [cascade] = casters;
+	mCachedValid   [cascade] = true;
+
 	quint32 width  = Engine::GetWindowWidth ();
 	quint32 height = Engine::GetWindowHeight();
 
-	// Create a new mesh quad
-	Mesh mesh;
-	Mesh::CreateQuad (mesh, -1, -1, 1, 1);
-	mesh.Load();
-
-	mBlurH->SetValue ("Scene", 1);
-	mBlurV->SetValue ("Scene", 1);
-	mBlurH->SetValue ("BlurSize", 0.001953125f);
-	mBlurV->SetValue ("BlurSize", 0.001953125f);
-
-	// Blur horizontally
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, mBlurBufferID));
-	GL_CALL (glViewport (0, 0, width, height));
-
-	GL_CALL (glActiveTexture (GL_TEXTURE1));
-	GL_CALL (glBindTexture   (GL_TEXTURE_2D, mColorTexID));
+	// Rebuild the kernels when the radius changes, the horizontal
+	// one reads the full resolution map and spans more texels
+	if (mTapCount == 0 || mKernelRadius != BlurRadius)
+	{
+		UpdateKernel (mBlurH, mBlurHUniforms, BlurRadius * (mSize / mBlurSize));
+		UpdateKernel (mBlurV, mBlurVUniforms, BlurRadius);
+		mKernelRadius = BlurRadius;
+	}
 
-	mBlurH->Use();
-	mesh.Draw();
+	// Blur horizontally, downsampling the depth map
+	RenderState::BindFramebuffer (mBlurBufferID);
+	RenderState::SetViewport (0, 0, mBlurSize, mBlurSize);
+	RenderState::BindTexture (1, GL_TEXTURE_2D, mColorTexID);
 
-	// Blur vertically
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, mShadowBufferID));
-	GL_CALL (glViewport (0, 0, width, height));
+	mBlurH->SetValue (mBlurHUniforms.BlurSize, 1.0f / mSize);
+	mTriangle.Draw();
 
-	GL_CALL (glActiveTexture (GL_TEXTURE1));
-	GL_CALL (glBindTexture   (GL_TEXTURE_2D, mBlurTexID));
+	// Blur vertically into the cascade layer
+	RenderState::BindFramebuffer (mCascadeBufferID);
+	GL_CALL (glFramebufferTextureLayer (GL_FRAMEBUFFER,
+		GL_COLOR_ATTACHMENT0, mCascadeTexID, 0, cascade));
+	RenderState::BindTexture (1, GL_TEXTURE_2D, mBlurTexID);
 
-	mBlurV->Use();
-	mesh.Draw();
+	mBlurV->SetValue (mBlurVUniforms.BlurSize, 1.0f / mBlurSize);
+	mTriangle.Draw();
 
 	// Restore the window's default framebuffer
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, 0));
-	GL_CALL (glViewport (0, 0, width, height));
+	RenderState::BindFramebuffer (0);
+	RenderState::SetViewport (0, 0, width, height);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
+/// The cascades are square and independent of the window
 
-bool ShadowMap::Create (void)
+bool ShadowMap::Create (quint32 size, quint32 cascades, quint32 downsample)
 {
 	// Destroy previous depth buffers
 	if (mShadowBufferID != 0) Destroy();
 
-	quint32 width  = Engine::GetWindowWidth ();
-	quint32 height = Engine::GetWindowHeight();
+	// Check parameters
+	if (size == 0 || cascades == 0 || cascades > MaxCascades ||
+		downsample == 0 || size % downsample != 0)
+	{
+		Console::Error ("Invalid shadow map size, cascade count or downsample");
+		return false;
+	}
+
+	quint32 width  = size;
+	quint32 height = size;
+
+	mSize = size;
+	mBlurSize = size / downsample;
+	mCascadeCount = cascades;
 
 	// Create a texture depth component
 	GL_CALL (glGenTextures (1, &mDepthTexID));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, mDepthTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, mDepthTexID);
 
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
@@ -156,11 +327,11 @@ bool ShadowMap::Create (void)
 	
 	GL_CALL (glTexImage2D (GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT,
 		width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, 0));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, 0));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, 0);
 
 	// Create a texture color component
 	GL_CALL (glGenTextures (1, &mColorTexID));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, mColorTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, mColorTexID);
 
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
@@ -169,11 +340,11 @@ bool ShadowMap::Create (void)
 	GL_CALL (glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP));
 
 	GL_CALL (glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, 0));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, 0));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, 0);
 
 	// Create a shadow framebuffer
 	GL_CALL (glGenFramebuffers (1, &mShadowBufferID));
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, mShadowBufferID));
+	RenderState::BindFramebuffer (mShadowBufferID);
 	
 	GL_CALL (glFramebufferTexture2D (GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT , GL_TEXTURE_2D, mDepthTexID, 0));
 	GL_CALL (glFramebufferTexture2D (GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexID, 0));
@@ -181,11 +352,11 @@ bool ShadowMap::Create (void)
 	// Check for any framebuffer errors
 	if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		{ Destroy(); return false; }
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, 0));
+	RenderState::BindFramebuffer (0);
 
 	// Create the blur framebuffer
 	GL_CALL (glGenTextures (1, &mBlurTexID));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, mBlurTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, mBlurTexID);
 
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
 	GL_CALL (glTexParameteri (GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
@@ -193,10 +364,11 @@ bool ShadowMap::Create (void)
 	GL_CALL (glTexParameterf ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP));
 	GL_CALL (glTexParameterf ( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP));
 
-	GL_CALL (glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, 0));
+	GL_CALL (glTexImage2D (GL_TEXTURE_2D, 0, GL_RGB16F,
+		mBlurSize, mBlurSize, 0, GL_RGB, GL_FLOAT, 0));
 
 	GL_CALL (glGenFramebuffers (1, &mBlurBufferID));
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, mBlurBufferID));
+	RenderState::BindFramebuffer (mBlurBufferID);
 
 	GL_CALL (glFramebufferTexture2D (GL_FRAMEBUFFER,
 		GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mBlurTexID, 0));
@@ -204,7 +376,32 @@ bool ShadowMap::Create (void)
 	// Check for any framebuffer errors
 	if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 		{ Destroy(); return false; }
-	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, 0));
+	RenderState::BindFramebuffer (0);
+
+	// Create the cascade texture array
+	GL_CALL (glGenTextures (1, &mCascadeTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D_ARRAY, mCascadeTexID);
+
+	GL_CALL (glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GL_CALL (glTexParameteri (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+	GL_CALL (glTexImage3D (GL_TEXTURE_2D_ARRAY, 0, GL_RGB16F,
+		mBlurSize, mBlurSize, cascades, 0, GL_RGB, GL_FLOAT, 0));
+	RenderState::BindTexture (0, GL_TEXTURE_2D_ARRAY, 0);
+
+	GL_CALL (glGenFramebuffers (1, &mCascadeBufferID));
+	RenderState::BindFramebuffer (mCascadeBufferID);
+
+	GL_CALL (glFramebufferTextureLayer (GL_FRAMEBUFFER,
+		GL_COLOR_ATTACHMENT0, mCascadeTexID, 0, 0));
+
+	// Check for any framebuffer errors
+	if (glCheckFramebufferStatus (GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{ Destroy(); return false; }
+	RenderState::BindFramebuffer (0);
 
 	return true;
 }
@@ -214,8 +411,14 @@ bool ShadowMap::Create (void)
 
 void ShadowMap::Destroy (void)
 {
-	GL_CALL (glBindTexture      (GL_TEXTURE_2D ,  0));
-	GL_CALL (glBindFramebuffer  (GL_FRAMEBUFFER,  0));
+	RenderState::ForgetTexture (mColorTexID);
+	RenderState::ForgetTexture (mDepthTexID);
+	RenderState::ForgetTexture (mBlurTexID);
+	RenderState::ForgetTexture (mCascadeTexID);
+
+	RenderState::ForgetFramebuffer (mShadowBufferID);
+	RenderState::ForgetFramebuffer (mBlurBufferID);
+	RenderState::ForgetFramebuffer (mCascadeBufferID);
 
 	GL_CALL (glDeleteTextures      (1, &mColorTexID));
 	GL_CALL (glDeleteTextures      (1, &mDepthTexID));
@@ -224,12 +427,24 @@ void ShadowMap::Destroy (void)
 	GL_CALL (glDeleteTextures      (1, &mBlurTexID));
 	GL_CALL (glDeleteFramebuffers  (1, &mBlurBufferID));
 
+	GL_CALL (glDeleteTextures      (1, &mCascadeTexID));
+	GL_CALL (glDeleteFramebuffers  (1, &mCascadeBufferID));
+
 	mColorTexID		= 0;
 	mDepthTexID		= 0;
 	mShadowBufferID	= 0;
 
 	mBlurTexID		= 0;
 	mBlurBufferID	= 0;
+
+	mCascadeTexID	= 0;
+	mCascadeBufferID= 0;
+
+	mSize			= 0;
+	mBlurSize		= 0;
+	mCascadeCount	= 0;
+
+	Invalidate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -237,9 +452,9 @@ void ShadowMap::Destroy (void)
 
 bool ShadowMap::Load (void)
 {
-	mDepth = (Shader*) Content::Load ("Shaders/Shadow/Depth.ast");
-	mBlurH = (Shader*) Content::Load ("Shaders/Shadow/BlurH.ast");
-	mBlurV = (Shader*) Content::Load ("Shaders/Shadow/BlurV.ast");
+	mDepth = Content::Load<Shader> ("Shaders/Shadow/Depth.ast");
+	mBlurH = Content::Load<Shader> ("Shaders/Shadow/BlurH.ast");
+	mBlurV = Content::Load<Shader> ("Shaders/Shadow/BlurV.ast");
 
 	if (mDepth == nullptr ||
 		mBlurH == nullptr ||
@@ -256,6 +471,28 @@ bool ShadowMap::Load (void)
 	mBlurH->Purge();
 	mBlurV->Purge();
 
+	mWorld = mDepth->Handle ("World");
+
+	BlurUniforms* uniforms[] = { &mBlurHUniforms, &mBlurVUniforms };
+	Shader* shaders[] = { mBlurH, mBlurV };
+
+	for (quint32 i = 0; i < 2; ++i)
+	{
+		uniforms[i]->Scene		= shaders[i]->Handle ("Scene");
+		uniforms[i]->BlurSize	= shaders[i]->Handle ("BlurSize");
+		uniforms[i]->Offsets	= shaders[i]->Handle ("Offsets");
+		uniforms[i]->Weights	= shaders[i]->Handle ("Weights");
+		uniforms[i]->TapCount	= shaders[i]->Handle ("TapCount");
+
+		// Both passes read texture unit one
+		shaders[i]->SetValue (uniforms[i]->Scene, 1);
+	}
+
+	// Drawn by every blur pass
+	Mesh::CreateTriangle (mTriangle);
+	mTriangle.Load();
+
+	mTapCount = 0;
 	return true;
 }
 
@@ -264,7 +501,67 @@ bool ShadowMap::Load (void)
 
 void ShadowMap::Unload (void)
 {
-	if (mDepth != nullptr) mDepth->Release();
-	if (mBlurH != nullptr) mBlurH->Release();
-	if (mBlurV != nullptr) mBlurV->Release();
+	mDepth.Release();
+	mBlurH.Release();
+	mBlurV.Release();
+	mWorld = UniformHandle();
+
+	mBlurHUniforms = BlurUniforms();
+	mBlurVUniforms = BlurUniforms();
+	mTriangle.Unload();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                         ShadowMap //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds a Gaussian kernel spanning radius texels of the
+/// 		  pass' input and uploads it to that pass. </summary>
+/// Neighbouring texels are merged into single taps placed between them,
+/// bilinear filtering then returns their weighted sum
+
+void ShadowMap::UpdateKernel (Shader* shader,
+	const BlurUniforms& uniforms, quint32 radius)
+{
+	radius = qMin (radius, MaxBlurRadius);
+	float sigma = Math::Max ((radius + 1) / 3.0f, 0.5f);
+
+	// Discrete weights of every texel from the center outwards
+	float weights[MaxBlurRadius + 1];
+	float total = 0;
+
+	for (quint32 i = 0; i <= radius; ++i)
+	{
+		weights[i] = Math::Exp (-(float) (i * i) / (2 * sigma * sigma));
+		total += i == 0 ? weights[i] : 2 * weights[i];
+	}
+
+	for (quint32 i = 0; i <= radius; ++i) weights[i] /= total;
+
+	// Center tap samples a single texel
+	float offsets[MaxBlurTaps];
+	float taps   [MaxBlurTaps];
+
+	offsets[0] = 0;
+	taps   [0] = weights[0];
+	quint32 count = 1;
+
+	for (quint32 i = 1; i <= radius; i += 2)
+	{
+		float w1 = weights[i];
+		float w2 = i + 1 <= radius ? weights[i + 1] : 0;
+
+		taps   [count] = w1 + w2;
+		offsets[count] = (i * w1 + (i + 1) * w2) / (w1 + w2);
+		++count;
+	}
+
+	mTapCount = count;
+
+	shader->SetValue (uniforms.Offsets, offsets, count);
+	shader->SetValue (uniforms.Weights, taps, count);
+	shader->SetValue (uniforms.TapCount, (qint32) count);
 }
@@ -15,9 +15,14 @@
 #define SHADOW_MAP_H
 
 class Camera;
-class Shader;
+class BoundingBox;
 
 #include <QGlobal.h>
+#include "Math/Matrix.h"
+#include "Content/Content.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Shader.h"
+#include "Graphics/UniformBlocks.h"
 
 
 
@@ -27,9 +32,33 @@ class Shader;
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
+/// Cascades split the camera frustum and are stored as layers of one
+/// texture array, each one blurred for variance shadow mapping
 
 class ShadowMap
 {
+public:
+	// Static
+	static const quint32 MaxCascades = UniformBlocks::MaxCascades;
+	static const quint32 MaxBlurTaps = 8;
+	static const quint32 MaxBlurRadius = 2 * (MaxBlurTaps - 1);
+
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class BlurUniforms
+	{
+	public:
+		// Properties
+		UniformHandle	Scene;
+		UniformHandle	BlurSize;
+		UniformHandle	Offsets;
+		UniformHandle	Weights;
+		UniformHandle	TapCount;
+	};
+
 public:
 	// Constructors
 	 ShadowMap		(void);
@@ -37,22 +66,52 @@ public:
 
 public:
 	// Methods
-	void Begin		(const Camera& camera) const;
-	void End		(void) const;
+	void Fit		(const Camera& light, const BoundingBox& scene,
+					 const Matrix& view, const Matrix& projection);
 
-	bool Create		(void);
+	bool IsCached	(quint32 cascade, quint32 casters) const;
+	void Invalidate	(void);
+
+	void Begin		(const Camera& light, quint32 cascade) const;
+	void Draw		(const Mesh* mesh, const Matrix& world,
+					 const quint32* ranges = nullptr, quint32 count = 0) const;
+	void End		(quint32 cascade, quint32 casters);
+
+	bool Create		(quint32 size, quint32 cascades, quint32 downsample = 1);
 	void Destroy	(void);
 
 	bool Load		(void);
 	void Unload		(void);
 
-	quint32 GetID	(void) const { return mColorTexID; }
+	quint32 GetID	(void) const { return mCascadeTexID; }
+	quint32 GetSize	(void) const { return mSize; }
+	quint32 GetBlurSize (void) const { return mBlurSize; }
+
+	quint32 GetCascadeCount (void) const { return mCascadeCount; }
+	const Matrix& GetMatrix (quint32 cascade) const { return mMatrices[cascade]; }
+
+public:
+	// Properties
+	float			Distance;			// View depth covered by the cascades
+	float			Lambda;				// Blend of logarithmic and uniform splits
+	quint32			BlurRadius;			// Gaussian radius in blurred texels
+
+private:
+	// Internal
+	void UpdateKernel	(Shader* shader, const BlurUniforms& uniforms, quint32 radius);
 
 private:
 	// Fields
-	Shader*			mDepth;
-	Shader*			mBlurH;
-	Shader*			mBlurV;
+	AssetHandle<Shader> mDepth;
+	AssetHandle<Shader> mBlurH;
+	AssetHandle<Shader> mBlurV;
+	UniformHandle		mWorld;
+	BlurUniforms		mBlurHUniforms;
+	BlurUniforms		mBlurVUniforms;
+
+	Mesh			mTriangle;			// Persistent full screen triangle
+	quint32			mTapCount;			// Vertical taps, zero until built
+	quint32			mKernelRadius;		// Radius the kernel was built for
 
 	quint32			mColorTexID;
 	quint32			mDepthTexID;
@@ -60,6 +119,23 @@ private:
 
 	quint32			mBlurTexID;
 	quint32			mBlurBufferID;
+
+	quint32			mCascadeTexID;		// Blurred cascades as array layers
+	quint32			mCascadeBufferID;	// Targets one layer at a time
+
+	quint32			mSize;				// Width and height of the depth pass
+	quint32			mBlurSize;			// Width and height of every cascade
+	quint32			mCascadeCount;		// Number of cascades created
+
+	Matrix			mProjections[MaxCascades];	// Light projection of each cascade
+	Matrix			mMatrices	[MaxCascades];	// World to light clip of each cascade
+	float			mNears		[MaxCascades];	// Nearest light space depth
+	float			mFars		[MaxCascades];	// Farthest light space depth
+	float			mSplits		[MaxCascades];	// Farthest view depth covered
+
+	Matrix			mCachedMatrices[MaxCascades];	// Light matrix each layer was rendered with
+	quint32			mCachedCasters [MaxCascades];	// Caster version each layer was rendered with
+	bool			mCachedValid   [MaxCascades];	// Whether each layer holds a rendering
 };
 
 #endif // SHADOW_MAP_H
@@ -18,6 +18,9 @@
 
 #include "Demo/Demo.h"
 #include "Content/Content.h"
+#include "Graphics/OcclusionBuffer.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/UniformBlocks.h"
 
 #include <SDL.h>
 #include "Version.h"
@@ -40,6 +43,7 @@ qint32 Engine::mHeight		= 0;
 bool   Engine::mSizeChanged	= false;
 
 Matrix Engine::mPerspective	= Matrix::Identity;
+quint32 Engine::mTotalTime	= 0;
 
 Engine::ExitStatus Engine::mExitStatus = Engine::ExitNone;
 
@@ -92,7 +96,7 @@ void Engine::Tick (void)
 			mWidth  = event.resize.w;
 			mHeight = event.resize.h;
 
-			GL_CALL (glViewport (0, 0, mWidth, mHeight));
+			RenderState::SetViewport (0, 0, mWidth, mHeight);
 			mPerspective = Matrix::CreatePerspectiveFieldOfView
 				(0.785398f, mWidth / (float) mHeight, 0.1f, 10000);
 
@@ -107,9 +111,21 @@ void Engine::Tick (void)
 	if (keyboard.Keys[SDLK_ESCAPE])
 		mExitStatus = ExitDesktop;
 
+	// Restart the state counters
+	RenderState::BeginFrame();
+
+	// Update the frame block
+	quint32 totalTime = SDL_GetTicks();
+	UniformBlocks::SetFrame (totalTime / 1000.0f,
+		(totalTime - mTotalTime) / 1000.0f, mWidth, mHeight);
+	mTotalTime = totalTime;
+
 	// Update the demo
 	mDemo->Update (1, SDL_GetTicks());
 
+	// Upload shared uniforms once
+	UniformBlocks::Update();
+
 	// Draw the demo
 	GL_CALL (glClear (GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 	mDemo->Render (1, SDL_GetTicks());
@@ -120,6 +136,9 @@ void Engine::Tick (void)
 	// Swap back buffer
 	SDL_GL_SwapBuffers();
 	mSizeChanged = false;
+
+	// Delete released assets
+	Content::Collect();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -171,15 +190,23 @@ void Engine::Initialize (void)
 	GL_CALL (glClearColor	(0.0f, 0.0f, 0.0f, 1.0f));
 	GL_CALL (glPointSize	(2.0f));
 
-	GL_CALL (glEnable		(GL_DEPTH_TEST));
-	GL_CALL (glDepthFunc	(GL_LESS));
+	RenderState::Reset();
+	RenderState::SetViewport (0, 0, mWidth, mHeight);
 
-	GL_CALL (glEnable		(GL_CULL_FACE));
+	RenderState::SetDepthTest	(true);
+	RenderState::SetDepthFunc	(GL_LESS);
+
+	RenderState::SetCullFace	(true);
 	GL_CALL (glCullFace		(GL_BACK));
 	GL_CALL (glFrontFace	(GL_CCW));
 
-	GL_CALL (glEnable		(GL_BLEND));
-	GL_CALL (glBlendFunc	(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+	RenderState::SetBlend		(true);
+	RenderState::SetBlendFunc	(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	// Create the shared uniform blocks
+	if (!UniformBlocks::Load())
+		Console::Fatal ("Unable to create shared uniform blocks");
+	mTotalTime = SDL_GetTicks();
 
 	// Get OpenGL version
 	Console::Message ("OpenGL version: %s", glGetString (GL_VERSION));
@@ -200,6 +227,9 @@ void Engine::Shutdown (void)
 	// Delete the demo object
 	delete mDemo;
 
+	// Release the shared uniform blocks
+	UniformBlocks::Unload();
+
 	// Unload all content
 	Content::UnloadAll();
 
@@ -355,8 +385,19 @@ int main (int argc, char **argv)
 	Console::Message ("-------------------\n" );
 #endif
 
+	qint32 result = 0;
+
+	// Run the occlusion checks without a window
+	if (argc == 2 && qstrcmp (argv[1], "-occlusion") == 0)
+	{
+		Console::Create();
+
+		if (!OcclusionBuffer::Test()) result = 1;
+		OcclusionBuffer::Benchmark();
+	}
+
 	// Invoke content processor
-	if (argc > 1)
+	else if (argc > 1)
 	{
 		// Create a debug console
 		Console::Create();
@@ -373,6 +414,9 @@ int main (int argc, char **argv)
 			Console::Message();
 			Content::Process (argv[i]);
 		}
+
+		// Unload referenced content
+		Content::UnloadAll();
 	}
 
 	// Start game engine
@@ -389,5 +433,5 @@ int main (int argc, char **argv)
 	Console::Wait();
 #endif
 
-	return 0;
+	return result;
 }
@@ -81,6 +81,7 @@ private:
 	static bool			mSizeChanged;	// Window size changed
 
 	static Matrix		mPerspective;	// Projection matrix
+	static quint32		mTotalTime;		// Ticks of the last frame
 };
 
 #endif // ENGINE_H
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/Animation.h"
+#include "Graphics/Skeleton.h"
+
+#include "Math/Math.h"
+#include "Math/Matrix.h"
+
+#include <cmath>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Returns the last keyframe at or before the specified time
+
+static qint32 FindKeyframe (const QVector<Animation::Keyframe>& keyframes, float time)
+{
+	qint32 low  = 0;
+	qint32 high = keyframes.size() - 1;
+
+	// Binary search through the sorted keyframes
+	while (low < high)
+	{
+		qint32 middle = (low + high + 1) / 2;
+
+		if (keyframes[middle].Time <= time)
+			 low  = middle;
+		else high = middle - 1;
+	}
+
+	return low;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                     Animation //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Animation::Animation (void)
+{
+	Duration = 0;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                          Animation //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Writes the local transform of every skeleton bone into locals
+
+void Animation::Sample (float time, bool loop,
+	const Skeleton& skeleton, Matrix* locals) const
+{
+	// Unanimated bones keep their bind pose
+	for (qint32 i = 0; i < skeleton.Bones.length(); ++i)
+		locals[i] = skeleton.Bones[i].Transform;
+
+	// Wrap or clamp the sample time
+	if (Duration > 0)
+	{
+		if (loop)
+		{
+			time = fmod (time, Duration);
+			if (time < 0) time += Duration;
+		}
+
+		else time = Math::Clamp (time, 0.0f, Duration);
+	}
+
+	foreach (const Track& track, Tracks)
+	{
+		if (track.Bone < 0 || track.Bone >= skeleton.Bones.length() ||
+			track.Keyframes.isEmpty()) continue;
+
+		// Find the surrounding keyframes
+		qint32 index = FindKeyframe (track.Keyframes, time);
+		const Keyframe& source = track.Keyframes[index];
+		const Keyframe& target = track.Keyframes[qMin (index + 1, track.Keyframes.size() - 1)];
+
+		// Compute the interpolation amount
+		float amount = 0;
+		if (target.Time > source.Time)
+			amount = Math::Clamp ((time - source.Time) / (target.Time - source.Time), 0.0f, 1.0f);
+
+		// Interpolate the keyframes
+		Vector3    translation = Vector3   ::Lerp  (source.Translation, target.Translation, amount);
+		Quaternion rotation    = Quaternion::Slerp (source.Rotation,    target.Rotation,    amount);
+		Vector3    scale       = Vector3   ::Lerp  (source.Scale,       target.Scale,       amount);
+
+		// Matrices use column vectors, the quaternion matrix uses row vectors
+		locals[track.Bone] = Matrix::CreateTranslation (translation) *
+			Matrix::Transpose (Matrix::CreateFromQuaternion (rotation)) *
+			Matrix::CreateScale (scale);
+	}
+}
@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_ANIMATION_H
+#define GRAPHICS_ANIMATION_H
+
+class Matrix;
+class Skeleton;
+
+#include "Math/Vector3.h"
+#include "Math/Quaternion.h"
+
+#include <QList.h>
+#include <QVector.h>
+#include <QString.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+class Animation
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	#pragma pack (push, 1)
+	class Keyframe
+	{
+	public:
+		// Properties
+		float		Time;			// Keyframe time in seconds
+		Vector3		Translation;	// Local bone translation
+		Quaternion	Rotation;		// Local bone rotation
+		Vector3		Scale;			// Local bone scale
+	};
+	#pragma pack (pop)
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Track
+	{
+	public:
+		// Properties
+		qint32				Bone;		// Animated bone index
+		QVector<Keyframe>	Keyframes;	// Keyframes sorted by time
+	};
+
+public:
+	// Constructors
+	Animation (void);
+
+public:
+	// Methods
+	void			Sample		(float time, bool loop,
+								 const Skeleton& skeleton, Matrix* locals) const;
+
+public:
+	// Properties
+	QString			Name;		// Animation clip name
+	float			Duration;	// Clip length in seconds
+
+	QList<Track>	Tracks;		// One track per animated bone
+};
+
+#endif // GRAPHICS_ANIMATION_H
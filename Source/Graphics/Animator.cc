@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/Animator.h"
+#include "Graphics/Animation.h"
+#include "Graphics/SkinBuffer.h"
+#include "Graphics/Skeleton.h"
+#include "Graphics/Model.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Vertex.h"
+
+#include "Engine/Console.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                      Animator //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Animator::Animator (void)
+{
+	mModel     = nullptr;
+	mAnimation = nullptr;
+
+	mLoop = true;
+	mTime = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Animator::~Animator (void)
+{
+	Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                           Animator //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// The geometry must not be purged yet so the influences can be checked
+
+bool Animator::Create (Model* model)
+{
+	Destroy();
+
+	// Model must have a skeleton
+	Skeleton* skeleton = model->GetSkeleton();
+	if (skeleton == nullptr || skeleton->Bones.isEmpty())
+	{
+		Console::Error ("Model has no skeleton");
+		return false;
+	}
+
+	if ((quint32) skeleton->Bones.length() > Skeleton::MaxBones)
+	{
+		Console::Error ("Skeleton has more than %d bones", Skeleton::MaxBones);
+		return false;
+	}
+
+	// Both skinning paths index the palette without checks
+	for (quint32 i = 0; i < model->Meshes.Length(); ++i)
+		if (!SkinBuffer::Validate (model->Meshes[i], skeleton->Bones.length()))
+			return false;
+
+	mModel = model;
+	mModel->Retain();
+
+	// Start in the bind pose
+	mLocals .resize (skeleton->Bones.length());
+	mPalette.resize (skeleton->Bones.length());
+
+	for (qint32 i = 0; i < skeleton->Bones.length(); ++i)
+		mLocals[i] = skeleton->Bones[i].Transform;
+
+	skeleton->ComputePalette (mLocals.constData(), mPalette.data());
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Animator::Destroy (void)
+{
+	foreach (SkinBuffer* skin, mSkins)
+		delete skin;
+
+	mSkins.clear();
+	mBones.Unload();
+
+	mLocals .clear();
+	mPalette.clear();
+
+	if (mModel != nullptr)
+		mModel->Release();
+
+	mModel     = nullptr;
+	mAnimation = nullptr;
+	mTime      = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool Animator::Play (const QString& name, bool loop)
+{
+	if (mModel == nullptr) return false;
+
+	// Find the animation clip
+	const Animation* animation = mModel->FindAnimation (name);
+	if (animation == nullptr)
+	{
+		Console::Error ("Unable to find animation: %s", name.toAscii().data());
+		return false;
+	}
+
+	mAnimation = animation;
+	mLoop = loop;
+	mTime = 0;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Elapsed time in milliseconds
+
+void Animator::Update (quint32 elapsedTime)
+{
+	if (mModel == nullptr || mAnimation == nullptr) return;
+
+	mTime += elapsedTime / 1000.0f;
+
+	// Sample the clip and compute the skinning matrices
+	const Skeleton* skeleton = mModel->GetSkeleton();
+	mAnimation->Sample (mTime, mLoop, *skeleton, mLocals.data());
+	skeleton->ComputePalette (mLocals.constData(), mPalette.data());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Target should be a copy of the animated model
+
+void Animator::Skin (Model* target)
+{
+	if (mModel == nullptr) return;
+
+	// Extract the bind pose streams on first use
+	if (mSkins.isEmpty())
+	{
+		for (quint32 i = 0; i < mModel->Meshes.Length(); ++i)
+		{
+			SkinBuffer* skin = new SkinBuffer();
+			if (!skin->Create (mModel->Meshes[i], mPalette.size()))
+				{ delete skin; skin = nullptr; }
+
+			mSkins.append (skin);
+		}
+	}
+
+	quint32 length = qMin ((quint32) mSkins.length(), target->Meshes.Length());
+	for (quint32 i = 0; i < length; ++i)
+	{
+		if (mSkins[i] == nullptr) continue;
+
+		// Skin the mesh and upload the result
+		mSkins[i]->Skin  (mPalette.constData());
+		mSkins[i]->Write (target->Meshes[i]);
+		target->Meshes[i]->GetVertices()->Update();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Animator::Apply (void)
+{
+	if (mModel == nullptr) return;
+
+	// Allocate the palette for the largest skeleton
+	if (!mBones.IsLoaded() && !mBones.Load
+		(Skeleton::MaxBones * sizeof (Matrix))) return;
+
+	// Upload the bone palette
+	mBones.Update (mPalette.constData(), mPalette.size() * sizeof (Matrix));
+	mBones.Bind (UniformBuffer::BoneBinding);
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_ANIMATOR_H
+#define GRAPHICS_ANIMATOR_H
+
+class Model;
+class Animation;
+class SkinBuffer;
+
+#include "Math/Matrix.h"
+#include "Graphics/UniformBuffer.h"
+
+#include <QList.h>
+#include <QVector.h>
+#include <QString.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Plays animation clips of a skinned model and skins it either on the
+/// CPU, by writing into a copy of the model, or on the GPU, through the
+/// bone palette uniform block
+
+class Animator
+{
+public:
+	// Constructors
+	 Animator (void);
+	~Animator (void);
+
+public:
+	// Methods
+	bool			Create			(Model* model);
+	void			Destroy			(void);
+
+	bool			Play			(const QString& name, bool loop = true);
+	void			Update			(quint32 elapsedTime);
+
+	void			Skin			(Model* target);
+	void			Apply			(void);
+
+	const Matrix*	GetPalette		(void) const { return mPalette.constData();	}
+	quint32			GetBoneCount	(void) const { return mPalette.size();		}
+
+	float			GetTime			(void) const { return mTime;				}
+	void			SetTime			(float time) { mTime = time;				}
+
+private:
+	// Fields
+	Model*				mModel;			// Animated model
+	const Animation*	mAnimation;		// Current animation clip
+
+	bool				mLoop;			// Whether the clip loops
+	float				mTime;			// Clip time in seconds
+
+	QVector<Matrix>		mLocals;		// Local bone transforms
+	QVector<Matrix>		mPalette;		// Skinning matrices
+
+	QList<SkinBuffer*>	mSkins;			// CPU skinning streams
+	UniformBuffer		mBones;			// GPU bone palette
+};
+
+#endif // GRAPHICS_ANIMATOR_H
@@ -0,0 +1,339 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/CommandBuffer.h"
+
+#include "Math/Matrix.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Color.h"
+#include "Graphics/Texture.h"
+#include "Graphics/RenderState.h"
+
+#define GLEW_STATIC
+#include <glew.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                 CommandBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+CommandBuffer::CommandBuffer (void)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+CommandBuffer::~CommandBuffer (void)
+{
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                      CommandBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Keeps the allocated storage for the next recording
+
+void CommandBuffer::Reset (void)
+{
+	mCommands.resize (0);
+	mPayload .resize (0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Replays every command in recording order. </summary>
+/// Must be called from the thread owning the GL context
+
+void CommandBuffer::Execute (void) const
+{
+	const char* payload = mPayload.constData();
+
+	for (qint32 i = 0; i < mCommands.size(); ++i)
+	{
+		const Command& c = mCommands[i];
+		Shader* shader = (Shader*) c.Target;
+		UniformHandle handle (c.Value);
+
+		switch (c.Type)
+		{
+			case UseProgramCommand:
+				shader->Use();
+				break;
+
+			case BindTextureCommand:
+				RenderState::BindTexture (c.Value, c.Integers[1] == Texture2DArray ?
+					GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, c.Integers[0]);
+				break;
+
+			case BindFramebufferCommand:
+				RenderState::BindFramebuffer (c.Value);
+				break;
+
+			case SetViewportCommand:
+				RenderState::SetViewport (c.Integers[0],
+					c.Integers[1], c.Integers[2], c.Integers[3]);
+				break;
+
+			case ClearCommand:
+			{
+				GLbitfield mask = 0;
+				if (c.Value & ClearColor) mask |= GL_COLOR_BUFFER_BIT;
+				if (c.Value & ClearDepth) mask |= GL_DEPTH_BUFFER_BIT;
+
+				GL_CALL (glClearColor (c.Floats[0], c.Floats[1], c.Floats[2], c.Floats[3]));
+				GL_CALL (glClear (mask));
+				break;
+			}
+
+			case SetIntegerCommand:
+				shader->SetValue (handle, c.Integers[0]);
+				break;
+
+			case SetFloatCommand:
+				shader->SetValue (handle, c.Floats[0]);
+				break;
+
+			case SetColorCommand:
+				shader->SetValue (handle, Color (c.Floats[0],
+					c.Floats[1], c.Floats[2], c.Floats[3]));
+				break;
+
+			case SetMatrixCommand:
+			{
+				Matrix matrix;
+				memcpy (&matrix, payload + c.Offset, sizeof (Matrix));
+				shader->SetValue (handle, matrix);
+				break;
+			}
+
+			case SetTextureCommand:
+				shader->SetValue (handle, (const Texture*) c.Object, c.Integers[0]);
+				break;
+
+			case UpdateBlockCommand:
+				((UniformBuffer*) c.Target)->Update (payload + c.Offset, c.Size);
+				break;
+
+			case BindBlockCommand:
+			{
+				const UniformBuffer* buffer = (const UniformBuffer*) c.Target;
+				UniformBuffer::BindingPoint binding = (UniformBuffer::BindingPoint) c.Value;
+
+				if (c.Integers[1] > 0)
+					 buffer->Bind (binding, c.Integers[0], c.Integers[1]);
+				else buffer->Bind (binding);
+				break;
+			}
+
+			case DrawCommand:
+				if (c.Integers[1] < 0)
+					 ((const Mesh*) c.Target)->Draw();
+				else ((const Mesh*) c.Target)->DrawRange (c.Integers[0], c.Integers[1]);
+				break;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::UseProgram (Shader* shader)
+{
+	Append (UseProgramCommand, shader);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::BindTexture (quint8 unit, quint32 texture, TextureTarget target)
+{
+	Command& c = Append (BindTextureCommand, nullptr, unit);
+	c.Integers[0] = texture;
+	c.Integers[1] = target;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::BindFramebuffer (quint32 framebuffer)
+{
+	Append (BindFramebufferCommand, nullptr, framebuffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetViewport (qint32 x, qint32 y, qint32 width, qint32 height)
+{
+	Command& c = Append (SetViewportCommand);
+	c.Integers[0] = x;
+	c.Integers[1] = y;
+	c.Integers[2] = width;
+	c.Integers[3] = height;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Clears the current framebuffer using ClearFlags. </summary>
+
+void CommandBuffer::Clear (quint32 flags, const Color& color)
+{
+	Command& c = Append (ClearCommand, nullptr, flags);
+	c.Floats[0] = color.R;
+	c.Floats[1] = color.G;
+	c.Floats[2] = color.B;
+	c.Floats[3] = color.A;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetValue (Shader* shader, UniformHandle handle, qint32 value)
+{
+	Append (SetIntegerCommand, shader, handle.Location).Integers[0] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetValue (Shader* shader, UniformHandle handle, float value)
+{
+	Append (SetFloatCommand, shader, handle.Location).Floats[0] = value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetValue (Shader* shader, UniformHandle handle, const Color& value)
+{
+	Command& c = Append (SetColorCommand, shader, handle.Location);
+	c.Floats[0] = value.R;
+	c.Floats[1] = value.G;
+	c.Floats[2] = value.B;
+	c.Floats[3] = value.A;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetValue (Shader* shader, UniformHandle handle, const Matrix& value)
+{
+	Store (Append (SetMatrixCommand, shader, handle.Location), &value, sizeof (Matrix));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void CommandBuffer::SetValue (Shader* shader,
+	UniformHandle handle, const Texture* value, quint8 index)
+{
+	Command& c = Append (SetTextureCommand, shader, handle.Location);
+	c.Object = value;
+	c.Integers[0] = index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the data so the caller may reuse it. </summary>
+
+void CommandBuffer::UpdateBlock (UniformBuffer* buffer, const void* data, quint32 length)
+{
+	Store (Append (UpdateBlockCommand, buffer), data, length);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Binds a range of the buffer, or all of it when length is zero. </summary>
+
+void CommandBuffer::BindBlock (const UniformBuffer* buffer,
+	UniformBuffer::BindingPoint binding, quint32 offset, quint32 length)
+{
+	Command& c = Append (BindBlockCommand, (void*) buffer, binding);
+	c.Integers[0] = offset;
+	c.Integers[1] = length;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws a single subset, or the whole mesh when negative. </summary>
+
+void CommandBuffer::Draw (const Mesh* mesh, qint32 subset)
+{
+	if (subset >= 0)
+	{
+		const Mesh::Subset& s = mesh->Subsets[subset];
+		DrawRange (mesh, s.IndexOffset, s.IndexCount);
+		return;
+	}
+
+	Command& c = Append (DrawCommand, (void*) mesh);
+	c.Integers[0] =  0;
+	c.Integers[1] = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws a contiguous range of the mesh's indices. </summary>
+
+void CommandBuffer::DrawRange (const Mesh* mesh, quint32 first, quint32 count)
+{
+	Command& c = Append (DrawCommand, (void*) mesh);
+	c.Integers[0] = first;
+	c.Integers[1] = count;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                     CommandBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+CommandBuffer::Command& CommandBuffer::Append
+	(CommandType type, void* target, quint32 value)
+{
+	Command command;
+	command.Type	= type;
+	command.Target	= target;
+	command.Object	= nullptr;
+	command.Value	= value;
+	command.Offset	= 0;
+	command.Size	= 0;
+
+	command.Integers[0] = 0;
+	command.Integers[1] = 0;
+	command.Integers[2] = 0;
+	command.Integers[3] = 0;
+
+	mCommands.append (command);
+	return mCommands.last();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Payloads are padded to keep every entry four byte aligned
+
+void CommandBuffer::Store (Command& command, const void* data, quint32 length)
+{
+	command.Offset = mPayload.size();
+	command.Size   = length;
+
+	mPayload.append ((const char*) data, length);
+	mPayload.resize ((mPayload.size() + 3) & ~3);
+}
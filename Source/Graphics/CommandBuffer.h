@@ -0,0 +1,148 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_COMMAND_BUFFER_H
+#define GRAPHICS_COMMAND_BUFFER_H
+
+class Mesh;
+class Color;
+class Matrix;
+class Shader;
+class Texture;
+
+#include "Graphics/Shader.h"
+#include "Graphics/UniformBuffer.h"
+
+#include <QVector.h>
+#include <QByteArray.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Records rendering commands for later replay on the GL thread. </summary>
+/// Recording makes no GL calls, so each buffer may be filled by its own thread
+
+class CommandBuffer
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	enum CommandType
+	{
+		UseProgramCommand		=  0,
+		BindTextureCommand		=  1,
+		BindFramebufferCommand	=  2,
+		SetViewportCommand		=  3,
+		ClearCommand			=  4,
+		SetIntegerCommand		=  5,
+		SetFloatCommand			=  6,
+		SetColorCommand			=  7,
+		SetMatrixCommand		=  8,
+		SetTextureCommand		=  9,
+		UpdateBlockCommand		= 10,
+		BindBlockCommand		= 11,
+		DrawCommand				= 12,
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	enum ClearFlags
+	{
+		ClearColor				= 1,
+		ClearDepth				= 2,
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	enum TextureTarget
+	{
+		Texture2D				= 0,
+		Texture2DArray			= 1,
+	};
+
+public:
+	// Constructors
+	 CommandBuffer (void);
+	~CommandBuffer (void);
+
+public:
+	// Methods
+	void		Reset			(void);
+	void		Execute			(void) const;
+
+	void		UseProgram		(Shader* shader);
+	void		BindTexture		(quint8 unit, quint32 texture, TextureTarget target = Texture2D);
+	void		BindFramebuffer	(quint32 framebuffer);
+	void		SetViewport		(qint32 x, qint32 y, qint32 width, qint32 height);
+	void		Clear			(quint32 flags, const Color& color);
+
+	void		SetValue		(Shader* shader, UniformHandle handle, qint32			value);
+	void		SetValue		(Shader* shader, UniformHandle handle, float			value);
+	void		SetValue		(Shader* shader, UniformHandle handle, const Color&		value);
+	void		SetValue		(Shader* shader, UniformHandle handle, const Matrix&	value);
+	void		SetValue		(Shader* shader, UniformHandle handle, const Texture*	value, quint8 index);
+
+	void		UpdateBlock		(UniformBuffer* buffer, const void* data, quint32 length);
+	void		BindBlock		(const UniformBuffer* buffer, UniformBuffer::BindingPoint binding,
+								 quint32 offset = 0, quint32 length = 0);
+
+	void		Draw			(const Mesh* mesh, qint32 subset = -1);
+	void		DrawRange		(const Mesh* mesh, quint32 first, quint32 count);
+
+	quint32		Length			(void) const { return mCommands.size();		}
+	bool		IsEmpty			(void) const { return mCommands.isEmpty();	}
+
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Command
+	{
+	public:
+		// Properties
+		CommandType		Type;			// Command type
+		void*			Target;			// Shader, mesh or uniform buffer
+		const void*		Object;			// Texture for texture uniforms
+		quint32			Value;			// Location, unit, binding or flags
+
+		union
+		{
+			qint32		Integers[4];	// Integer arguments
+			float		Floats	[4];	// Float arguments
+		};
+
+		quint32			Offset;			// Payload offset
+		quint32			Size;			// Payload length
+	};
+
+private:
+	// Internal
+	Command&	Append			(CommandType type, void* target = nullptr, quint32 value = 0);
+	void		Store			(Command& command, const void* data, quint32 length);
+
+private:
+	// Fields
+	QVector<Command>	mCommands;		// Recorded commands
+	QByteArray			mPayload;		// Matrix and block data
+};
+
+#endif // GRAPHICS_COMMAND_BUFFER_H
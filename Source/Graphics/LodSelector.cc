@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/LodSelector.h"
+#include "Math/BoundingSphere.h"
+#include "Math/Matrix.h"
+#include "Math/Math.h"
+#include "Engine/Engine.h"
+
+#include <xmmintrin.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                   LodSelector //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+LodSelector::LodSelector (void)
+{
+	Quality		= 1.0f;
+	Hysteresis	= 0.1f;
+	FadeTime	= 0.0f;
+
+	mCount		= 0;
+	mCapacity	= 0;
+	mData		= nullptr;
+	mLevels		= nullptr;
+	mPrevious	= nullptr;
+
+	mThresholdCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+LodSelector::~LodSelector (void)
+{
+	Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                        LodSelector //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool LodSelector::Create (quint32 capacity)
+{
+	Destroy();
+
+	// Check parameters
+	if (capacity == 0) return false;
+	mCapacity = (capacity + 3) & ~3;
+
+	// Allocate every stream in one block, 16 byte aligned
+	const quint32 streams = 3 + 3;
+	mData = (float*) qMallocAligned (streams * mCapacity * sizeof (float) +
+									 2 * mCapacity * sizeof (quint8), 16);
+	memset (mData, 0, streams * mCapacity * sizeof (float));
+
+	float* stream = mData;
+	for (quint32 i = 0; i < 3; ++i, stream += mCapacity) mCenters[i] = stream;
+
+	mRadii = stream; stream += mCapacity;
+	mSizes = stream; stream += mCapacity;
+	mFades = stream; stream += mCapacity;
+
+	mLevels   = (quint8*) stream;
+	mPrevious = mLevels + mCapacity;
+
+	// Start at the finest level with no fade
+	for (quint32 i = 0; i < mCapacity; ++i) mFades[i] = 1.0f;
+	memset (mLevels, 0, 2 * mCapacity);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void LodSelector::Destroy (void)
+{
+	if (mData != nullptr)
+		qFreeAligned (mData);
+
+	mData		= nullptr;
+	mLevels		= nullptr;
+	mPrevious	= nullptr;
+	mCount		= 0;
+	mCapacity	= 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Places the world space bounding sphere of an instance. </summary>
+
+void LodSelector::SetSphere (quint32 index, const BoundingSphere& sphere)
+{
+	mCenters[0][index] = sphere.Center.X;
+	mCenters[1][index] = sphere.Center.Y;
+	mCenters[2][index] = sphere.Center.Z;
+	mRadii	   [index] = sphere.Radius;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Changes the number of instances being selected. </summary>
+/// New instances start at the finest level
+
+void LodSelector::SetCount (quint32 count)
+{
+	count = qMin (count, mCapacity);
+
+	for (quint32 i = mCount; i < count; ++i)
+	{
+		mLevels  [i] = 0;
+		mPrevious[i] = 0;
+		mFades   [i] = 1.0f;
+	}
+
+	mCount = count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets the screen height fraction below which each level is
+/// 		  left for the next coarser one. </summary>
+/// Thresholds must be decreasing, the level count is one more than them
+
+bool LodSelector::SetThresholds (quint8 count, const float* thresholds)
+{
+	if (count >= MaxLevels) return false;
+
+	for (quint8 i = 1; i < count; ++i)
+		if (thresholds[i] > thresholds[i - 1]) return false;
+
+	memcpy (mThresholds, thresholds, count * sizeof (float));
+	mThresholdCount = count;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Measures every instance and updates its level. </summary>
+/// A level changes only once the size passes its threshold by the
+/// hysteresis fraction, optionally fading from the previous level
+
+void LodSelector::Select (const Matrix& view,
+	const Matrix& projection, quint32 elapsedTime)
+{
+	if (mCount == 0) return;
+
+	// The sphere covers radius * M22 / depth of the screen height
+	const __m128 scale = _mm_set1_ps (projection.M22 * Quality);
+	const __m128 near  = _mm_set1_ps (Engine::GetNearClip());
+
+	const __m128 m31 = _mm_set1_ps (-view.M31);
+	const __m128 m32 = _mm_set1_ps (-view.M32);
+	const __m128 m33 = _mm_set1_ps (-view.M33);
+	const __m128 m34 = _mm_set1_ps (-view.M34);
+
+	for (quint32 i = 0; i < mCount; i += 4)
+	{
+		// Distance along the view direction
+		__m128 depth = _mm_add_ps (
+			_mm_add_ps (_mm_mul_ps (m31, _mm_load_ps (mCenters[0] + i)),
+						_mm_mul_ps (m32, _mm_load_ps (mCenters[1] + i))),
+			_mm_add_ps (_mm_mul_ps (m33, _mm_load_ps (mCenters[2] + i)), m34));
+
+		// Spheres reaching the eye use the near plane
+		__m128 radius = _mm_load_ps (mRadii + i);
+		depth = _mm_max_ps (_mm_sub_ps (depth, radius), near);
+
+		_mm_store_ps (mSizes + i, _mm_div_ps
+			(_mm_mul_ps (radius, scale), depth));
+	}
+
+	float fade = FadeTime > 0 ? elapsedTime * 0.001f / FadeTime : 1.0f;
+
+	float lower[MaxLevels - 1];
+	float upper[MaxLevels - 1];
+
+	for (quint8 t = 0; t < mThresholdCount; ++t)
+	{
+		lower[t] = mThresholds[t] * (1 - Hysteresis);
+		upper[t] = mThresholds[t] * (1 + Hysteresis);
+	}
+
+	for (quint32 i = 0; i < mCount; ++i)
+	{
+		quint8 current = mLevels[i];
+		quint8 level = 0;
+
+		// Thresholds at or past the current level must be undershot
+		// by the hysteresis, the ones before it overshot
+		for (quint8 t = 0; t < mThresholdCount; ++t)
+			level += mSizes[i] < (t >= current ? lower[t] : upper[t]);
+
+		mFades[i] = Math::Min (mFades[i] + fade, 1.0f);
+
+		if (level != current)
+		{
+			mPrevious[i] = current;
+			mLevels  [i] = level;
+			mFades   [i] = FadeTime > 0 ? 0.0f : 1.0f;
+		}
+	}
+}
@@ -0,0 +1,93 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_LOD_SELECTOR_H
+#define GRAPHICS_LOD_SELECTOR_H
+
+class Matrix;
+class BoundingSphere;
+
+#include <QGlobal.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Chooses a level of detail for many instances at once from the
+/// 		  screen height covered by their bounding spheres. </summary>
+/// Instances are stored as structure of arrays and measured four at a time
+
+class LodSelector
+{
+public:
+	// Types
+	enum
+	{
+		MaxLevels = 8,				// Most levels an instance can have
+	};
+
+public:
+	// Constructors
+	 LodSelector (void);
+	~LodSelector (void);
+
+public:
+	// Methods
+	bool		Create			(quint32 capacity);
+	void		Destroy			(void);
+
+	void		SetSphere		(quint32 index, const BoundingSphere& sphere);
+	void		SetCount		(quint32 count);
+
+	bool		SetThresholds	(quint8 count, const float* thresholds);
+
+	void		Select			(const Matrix& view, const Matrix& projection,
+								 quint32 elapsedTime);
+
+	quint8		GetLevel		(quint32 index) const { return mLevels  [index]; }
+	quint8		GetPrevious		(quint32 index) const { return mPrevious[index]; }
+	float		GetFade			(quint32 index) const { return mFades   [index]; }
+	float		GetSize			(quint32 index) const { return mSizes   [index]; }
+
+	quint32		GetCount		(void) const { return mCount;		}
+	quint32		GetCapacity		(void) const { return mCapacity;	}
+	quint8		GetLevelCount	(void) const { return mThresholdCount + 1; }
+
+public:
+	// Properties
+	float		Quality;		// Scales every projected size
+	float		Hysteresis;		// Fraction a size must pass a threshold by
+	float		FadeTime;		// Seconds to cross-fade, zero to pop
+
+private:
+	// Fields
+	quint32		mCount;			// Number of instances
+	quint32		mCapacity;		// Instance slots, multiple of four
+
+	float*		mData;			// Single aligned allocation
+	float*		mCenters[3];	// World space sphere centers
+	float*		mRadii;			// Sphere radii
+	float*		mSizes;			// Fraction of the screen height covered
+	float*		mFades;			// Cross-fade progress, one when done
+
+	quint8*		mLevels;		// Selected level of every instance
+	quint8*		mPrevious;		// Level faded out of every instance
+
+	float		mThresholds[MaxLevels - 1];	// Sizes leaving each level
+	quint8		mThresholdCount;			// One less than the level count
+};
+
+#endif // GRAPHICS_LOD_SELECTOR_H
@@ -72,3 +72,49 @@ Material::Material (void)
 	Shininess			= 12.0f;
 	Normal				= -1;
 }
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                           Material //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Writes the constant values of this material in GPU layout. </summary>
+
+void Material::Compile (Block& block) const
+{
+	block.Ambient		= Ambient .Color;
+	block.Diffuse		= Diffuse .Color;
+	block.Specular		= Specular.Color;
+	block.Emissive		= Emissive.Color;
+
+	block.Alpha			= Alpha;
+	block.Shininess		= Shininess;
+	block.Padding[0]	= 0.0f;
+	block.Padding[1]	= 0.0f;
+
+	// Layers are assigned when textures are packed
+	for (quint32 i = 0; i < SlotCount; ++i)
+		block.Layers[i] = -1;
+
+	block.Reserved[0]	= 0;
+	block.Reserved[1]	= 0;
+	block.Reserved[2]	= 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns the model texture index of a slot or -1. </summary>
+
+qint32 Material::GetTexture (TextureSlot slot) const
+{
+	switch (slot)
+	{
+		case AmbientSlot : return Ambient .Texture;
+		case DiffuseSlot : return Diffuse .Texture;
+		case SpecularSlot: return Specular.Texture;
+		case EmissiveSlot: return Emissive.Texture;
+		case NormalSlot  : return Normal;
+		default          : return -1;
+	}
+}
@@ -47,10 +47,48 @@ public:
 		qint32 Texture;
 	};
 
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> GPU layout matching the std140 Material uniform block. </summary>
+
+	class Block
+	{
+	public:
+		// Properties
+		Color	Ambient;
+		Color	Diffuse;
+		Color	Specular;
+		Color	Emissive;
+
+		float	Alpha;
+		float	Shininess;
+		float	Padding[2];
+
+		qint32	Layers[5];		// Texture array layer per slot
+		qint32	Reserved[3];
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Texture slots, bound to units one through five. </summary>
+
+	enum TextureSlot
+	{
+		AmbientSlot				= 0,
+		DiffuseSlot				= 1,
+		SpecularSlot			= 2,
+		EmissiveSlot			= 3,
+		NormalSlot				= 4,
+		SlotCount				= 5,
+	};
+
 public:
 	// Constructors
 	Material (void);
 
+public:
+	// Methods
+	void	Compile		(Block& block) const;
+	qint32	GetTexture	(TextureSlot slot) const;
+
 public:
 	// Properties
 	Channel	Ambient;
@@ -17,6 +17,9 @@
 #include "Graphics/Shader.h"
 #include "Graphics/Material.h"
 #include "Graphics/Vertex.h"
+#include "Graphics/RenderState.h"
+
+#include "Math/Math.h"
 
 #define GLEW_STATIC
 #include <glew.h>
@@ -37,6 +40,9 @@ Mesh::Mesh (void)
 
 	mVertices = new VertexBuffer();
 	mIndices  = new  IndexBuffer();
+
+	Bounds = BoundingBox (Vector3::Zero, Vector3::Zero);
+	Sphere = BoundingSphere (Vector3::Zero, 0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -62,7 +68,11 @@ Mesh::Mesh (const Mesh& mesh)
 	mVertices = new VertexBuffer (*mesh.mVertices);
 	mIndices  = new  IndexBuffer (*mesh.mIndices );
 
-	Name   = mesh.Name;
+	Name    = mesh.Name;
+	Subsets = mesh.Subsets;
+
+	Bounds  = mesh.Bounds;
+	Sphere  = mesh.Sphere;
 }
 
 
@@ -81,7 +91,7 @@ bool Mesh::Load (void)
 
 	// Create a vertex array
 	GL_CALL (glGenVertexArrays (1, &mArrayID));
-	GL_CALL (glBindVertexArray (    mArrayID));
+	RenderState::BindVertexArray (mArrayID);
 
 	// Load vertex and index buffers
 	bool status = true;
@@ -90,7 +100,7 @@ bool Mesh::Load (void)
 
 	// Check if data was loaded
 	if (!status) Unload();
-	else GL_CALL (glBindVertexArray (0));
+	else RenderState::BindVertexArray (0);
 
 	// All done
 	return status;
@@ -113,14 +123,14 @@ void Mesh::Unload (void)
 	if (!IsLoaded()) return;
 
 	// Bind the vertex array
-	GL_CALL (glBindVertexArray (mArrayID));
+	RenderState::BindVertexArray (mArrayID);
 
 	// Unload vertex and index buffers
 	mVertices->Unload();
 	mIndices ->Unload();
 
 	// Delete the vertex array
-	GL_CALL (glBindVertexArray (0));
+	RenderState::BindVertexArray (0);
 	GL_CALL (glDeleteVertexArrays (1, &mArrayID));
 	mArrayID = 0;
 }
@@ -150,7 +160,7 @@ bool Mesh::IsPurged (void) const { return mVertices->IsPurged();	}
 void Mesh::Draw (void) const
 {
 	// Bind the mesh vertex array
-	GL_CALL (glBindVertexArray (mArrayID));
+	RenderState::BindVertexArray (mArrayID);
 	switch (mIndices->GetIndexSize())
 	{
 		// Select appropriate index type depending on the index size
@@ -160,6 +170,62 @@ void Mesh::Draw (void) const
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Mesh::DrawSubset (quint32 index) const
+{
+	// Check subset bounds
+	if (index >= (quint32) Subsets.length()) return;
+
+	const Subset& subset = Subsets[index];
+	DrawRange (subset.IndexOffset, subset.IndexCount);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws a contiguous range of indices. </summary>
+
+void Mesh::DrawRange (quint32 first, quint32 count) const
+{
+	// Compute the byte offset of the range
+	quint8  indexSize = mIndices->GetIndexSize();
+	quint8* offset    = (quint8*) nullptr + first * indexSize;
+
+	// Bind the mesh vertex array
+	RenderState::BindVertexArray (mArrayID);
+	switch (indexSize)
+	{
+		// Select appropriate index type depending on the index size
+		case 1: GL_CALL (glDrawElements (GL_TRIANGLES, count, GL_UNSIGNED_BYTE,  offset)); break;
+		case 2: GL_CALL (glDrawElements (GL_TRIANGLES, count, GL_UNSIGNED_SHORT, offset)); break;
+		case 4: GL_CALL (glDrawElements (GL_TRIANGLES, count, GL_UNSIGNED_INT,   offset)); break;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws the mesh count times, optionally reading per-instance
+/// 		  attributes from an instance stream. </summary>
+/// The stream is attached for this draw only
+
+void Mesh::DrawInstanced (quint32 count, const VertexBuffer* instances) const
+{
+	if (count == 0) return;
+
+	// Bind the mesh vertex array and the instances
+	RenderState::BindVertexArray (mArrayID);
+	if (instances != nullptr) instances->Attach();
+
+	switch (mIndices->GetIndexSize())
+	{
+		// Select appropriate index type depending on the index size
+		case 1: GL_CALL (glDrawElementsInstanced (GL_TRIANGLES, mIndices->GetIndexCount(), GL_UNSIGNED_BYTE,  nullptr, count)); break;
+		case 2: GL_CALL (glDrawElementsInstanced (GL_TRIANGLES, mIndices->GetIndexCount(), GL_UNSIGNED_SHORT, nullptr, count)); break;
+		case 4: GL_CALL (glDrawElementsInstanced (GL_TRIANGLES, mIndices->GetIndexCount(), GL_UNSIGNED_INT,   nullptr, count)); break;
+	}
+
+	if (instances != nullptr) instances->Detach();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 /// indexSize in bytes (1, 2 or 4)
@@ -177,6 +243,115 @@ bool Mesh::Create (quint32 vertexCount, quint8 elementCount,
 	return status;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Computes the bounding box and sphere from the vertex
+/// 		  positions, the vertex data must not be purged. </summary>
+/// Subset boxes only cover the vertices their indices reference
+
+bool Mesh::ComputeBounds (void)
+{
+	if (mVertices->IsPurged() || mVertices->GetVertexCount() == 0) return false;
+
+	// Find the vertex position element
+	const VertexDeclaration* declaration = mVertices->GetVertexDeclaration();
+	const VertexElement* elements = declaration->GetElements();
+	const VertexElement* position = nullptr;
+
+	for (quint8 i = 0; i < declaration->GetElementCount(); ++i)
+		if (elements[i].ElementType == VertexElement::PositionType)
+			{ position = &elements[i]; break; }
+
+	if (position == nullptr) return false;
+
+	const quint8* data = mVertices->GetData() + position->Offset;
+	const quint16 size = declaration->GetVertexSize();
+	const quint32 count = mVertices->GetVertexCount();
+
+	// Fit the box around every position
+	const float* p = (const float*) data;
+	Vector3 min (p[0], p[1], p[2]);
+	Vector3 max (p[0], p[1], p[2]);
+
+	for (quint32 i = 1; i < count; ++i)
+	{
+		p = (const float*) (data + i * size);
+		min = Vector3::Min (min, Vector3 (p[0], p[1], p[2]));
+		max = Vector3::Max (max, Vector3 (p[0], p[1], p[2]));
+	}
+
+	Bounds = BoundingBox (min, max);
+
+	// Center the sphere on the box, it is usually tighter than the box corners
+	Vector3 center = Bounds.GetCenter();
+	float radius = 0;
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		p = (const float*) (data + i * size);
+		radius = Math::Max (radius, Vector3::DistanceSquared
+			(center, Vector3 (p[0], p[1], p[2])));
+	}
+
+	Sphere = BoundingSphere (center, Math::Sqrt (radius));
+
+	// Fit every subset around the vertices it references
+	if (!Subsets.isEmpty() && mIndices->IsPurged()) return false;
+
+	for (qint32 s = 0; s < Subsets.size(); ++s)
+	{
+		Subset& subset = Subsets[s];
+		if (subset.IndexCount == 0) { subset.Bounds = BoundingBox (center, center); continue; }
+
+		for (quint32 i = 0; i < subset.IndexCount; ++i)
+		{
+			quint32 index = mIndices->GetIndex (subset.IndexOffset + i);
+
+			p = (const float*) (data + index * size);
+			if (i == 0) { min = max = Vector3 (p[0], p[1], p[2]); continue; }
+
+			min = Vector3::Min (min, Vector3 (p[0], p[1], p[2]));
+			max = Vector3::Max (max, Vector3 (p[0], p[1], p[2]));
+		}
+
+		subset.Bounds = BoundingBox (min, max);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Merges flagged subsets which follow each other in index order
+/// 		  into as few ranges as possible. </summary>
+/// Writes first and count pairs and returns the number of ranges, returns
+/// zero when every subset is flagged and the whole mesh should be drawn
+
+quint32 Mesh::MergeSubsets (const quint8* flags, quint32* ranges) const
+{
+	quint32 count = 0;
+	quint32 flagged = 0;
+
+	for (qint32 i = 0; i < Subsets.size(); ++i)
+	{
+		if (flags[i] == 0) continue;
+		const Subset& subset = Subsets[i];
+		++flagged;
+
+		// Extend the previous range when the subsets touch
+		if (count > 0 && ranges[2 * count - 2] +
+			ranges[2 * count - 1] == subset.IndexOffset)
+		{
+			ranges[2 * count - 1] += subset.IndexCount;
+			continue;
+		}
+
+		ranges[2 * count + 0] = subset.IndexOffset;
+		ranges[2 * count + 1] = subset.IndexCount;
+		++count;
+	}
+
+	return flagged == (quint32) Subsets.size() ? 0 : count;
+}
+
 
 
 //----------------------------------------------------------------------------//
@@ -241,3 +416,29 @@ void Mesh::CreateQuad (Mesh& mesh, float x1,
 	indices[1] = 2; indices[4] = 3;
 	indices[2] = 1; indices[5] = 1;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates one triangle covering the whole viewport. </summary>
+/// Cheaper than a quad for full screen passes, nothing is shaded twice
+/// along the diagonal
+
+void Mesh::CreateTriangle (Mesh& mesh)
+{
+	mesh.Create (3, VertexPositionTexture::ElementCount,
+		VertexPositionTexture::VertexElements, 3, 1);
+
+	VertexPositionTexture* vertices =
+		(VertexPositionTexture*) mesh.GetVertices()->GetData();
+
+	// Overshoot the viewport so it is covered after clipping
+	vertices[0].Position = Vector4 (-1, -1, 0, 1);
+	vertices[1].Position = Vector4 ( 3, -1, 0, 1);
+	vertices[2].Position = Vector4 (-1,  3, 0, 1);
+
+	vertices[0].Texture  = Vector2 (0, 0);
+	vertices[1].Texture  = Vector2 (2, 0);
+	vertices[2].Texture  = Vector2 (0, 2);
+
+	quint8* indices = mesh.GetIndices()->GetData();
+	indices[0] = 0; indices[1] = 1; indices[2] = 2;
+}
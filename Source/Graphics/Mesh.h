@@ -21,7 +21,9 @@ class VertexBuffer;
 class IndexBuffer;
 class VertexElement;
 
+#include <QList.h>
 #include <QString.h>
+#include "Math/BoundingSphere.h"
 
 
 
@@ -34,6 +36,21 @@ class VertexElement;
 
 class Mesh
 {
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Subset
+	{
+	public:
+		// Properties
+		quint32		IndexOffset;	// First index of the subset
+		quint32		IndexCount;		// Number of subset indices
+		QString		Name;			// Name of the source mesh
+		BoundingBox	Bounds;			// Object space subset bounds
+	};
+
 public:
 	// Constructors
 	 Mesh (void);
@@ -52,6 +69,9 @@ public:
 	bool			IsPurged	(void) const;
 
 	void			Draw		(void) const;
+	void			DrawSubset	(quint32 index) const;
+	void			DrawRange	(quint32 first, quint32 count) const;
+	void			DrawInstanced (quint32 count, const VertexBuffer* instances = nullptr) const;
 
 	quint32			GetArrayID	(void) const		{ return mArrayID;		}
 	VertexBuffer*	GetVertices	(void) const		{ return mVertices;		}
@@ -60,6 +80,9 @@ public:
 	bool Create (quint32 vertexCount, quint8 elementCount,
 		const VertexElement* elements, quint32 indexCount, quint8 indexSize);
 
+	bool			ComputeBounds (void);
+	quint32			MergeSubsets (const quint8* flags, quint32* ranges) const;
+
 public:
 	// Static
 	static void CreateQuad (Mesh& mesh, float x1, float y1,
@@ -69,11 +92,18 @@ public:
 		float x2, float y2, float mx1, float my1, float mx2,
 		float my2, bool xFlip = false, bool yFlip = false);
 
+	static void CreateTriangle (Mesh& mesh);
+
 public:
 	// Properties
 	qint32			Material;	// Mesh Material reference
 	QString			Name;		// Mesh name
 
+	QList<Subset>	Subsets;	// Merged source meshes
+
+	BoundingBox		Bounds;		// Object space bounding box
+	BoundingSphere	Sphere;		// Object space bounding sphere
+
 protected:
 	// Fields
 	quint32			mArrayID;	// OpenGL array ID
@@ -16,10 +16,15 @@
 #include "Graphics/Material.h"
 #include "Graphics/Vertex.h"
 #include "Graphics/Texture.h"
+#include "Graphics/TextureArray.h"
+#include "Graphics/Skeleton.h"
+#include "Graphics/Animation.h"
 
 #include "Content/Content.h"
 ASSET_DEFINITION (Model);
 
+#include <QByteArray.h>
+
 #define GLEW_STATIC
 #include <glew.h>
 
@@ -34,7 +39,10 @@ ASSET_DEFINITION (Model);
 
 Model::Model (void) : Asset (AssetID)
 {
-	mPhysics = nullptr;
+	mPhysics  = nullptr;
+	mSkeleton = nullptr;
+
+	mMaterialStride = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,10 +50,19 @@ Model::Model (void) : Asset (AssetID)
 
 Model::Model (const Model& model) : Asset (model)
 {
+	mMaterialStride = 0;
+
 	if (model.mPhysics != nullptr)
 		 mPhysics = new Mesh (*model.mPhysics);
 	else mPhysics = nullptr;
 
+	if (model.mSkeleton != nullptr)
+		 mSkeleton = new Skeleton (*model.mSkeleton);
+	else mSkeleton = nullptr;
+
+	for (quint32 i = 0; i < model.Animations.Length(); ++i)
+		Animations.Add (new Animation (*model.Animations[i]));
+
 	Meshes    = model.Meshes;
 	Materials = model.Materials;
 	Textures  = model.Textures;
@@ -58,9 +75,22 @@ Model::~Model (void)
 {
 	UnloadTextures (false);
 	UnloadGeometry ( true);
+	UnloadMaterials();
 
 	if (mPhysics != nullptr)
 		delete mPhysics;
+
+	if (mSkeleton != nullptr)
+		delete mSkeleton;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the textures so they can be deleted before the model. </summary>
+
+void Model::ReleaseDependencies (void)
+{
+	UnloadMaterials();
+	Textures.Clear();
 }
 
 
@@ -80,9 +110,18 @@ void Model::Create (void)
 		mPhysics = nullptr;
 	}
 
+	if (mSkeleton != nullptr)
+	{
+		delete mSkeleton;
+		mSkeleton = nullptr;
+	}
+
+	UnloadMaterials();
+
 	Meshes.Clear();
 	Materials.Clear();
 	Textures.Clear();
+	Animations.Clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -221,6 +260,125 @@ void Model::PurgeGeometry (bool force)
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Compiles every material into one uniform buffer and packs
+/// 		  the model textures into texture arrays. </summary>
+/// Textures must not be purged yet, when grouping is enabled textures
+/// of the same size and depth share an array, otherwise every texture
+/// receives its own
+
+bool Model::LoadMaterials (bool groupTextures)
+{
+	// Check if already loaded
+	if (AreMaterialsLoaded()) return true;
+
+	// Assign every texture an array and a layer
+	QVector<qint32> arrays (Textures.Length(), -1);
+	QVector<qint32> layers (Textures.Length(), -1);
+	QVector<QVector<const Texture*> > groups;
+
+	for (quint32 i = 0; i < Textures.Length(); ++i)
+	{
+		const Texture* texture = Textures[i];
+		if (texture->IsPurged()) continue;
+
+		qint32 group = groups.size();
+		if (groupTextures)
+		{
+			for (qint32 g = 0; g < groups.size(); ++g)
+			{
+				const Texture* first = groups[g][0];
+				if (first->GetWidth () == texture->GetWidth () &&
+					first->GetHeight() == texture->GetHeight() &&
+					first->GetDepth () == texture->GetDepth ())
+					{ group = g; break; }
+			}
+		}
+
+		if (group == groups.size()) groups.resize (group + 1);
+
+		arrays[i] = group;
+		layers[i] = groups[group].size();
+		groups[group].append (texture);
+	}
+
+	// Upload every group
+	for (qint32 g = 0; g < groups.size(); ++g)
+	{
+		TextureArray* array = new TextureArray();
+		if (!array->Load (groups[g]))
+			{ delete array; UnloadMaterials(); return false; }
+
+		mTextureArrays.append (array);
+	}
+
+	// Round every block up to the range alignment
+	quint32 alignment = UniformBuffer::GetOffsetAlignment();
+	mMaterialStride = (sizeof (Material::Block) + alignment - 1) / alignment * alignment;
+
+	QByteArray data (Materials.Length() * mMaterialStride, 0);
+	mMaterialTextures.resize (Materials.Length() * Material::SlotCount);
+
+	for (quint32 i = 0; i < Materials.Length(); ++i)
+	{
+		const Material* material = Materials[i];
+		Material::Block* block = (Material::Block*) (data.data() + i * mMaterialStride);
+		material->Compile (*block);
+
+		// Resolve the array and layer of every slot
+		for (quint32 s = 0; s < Material::SlotCount; ++s)
+		{
+			const TextureArray* array = nullptr;
+			qint32 index = material->GetTexture ((Material::TextureSlot) s);
+
+			if (index >= 0 && (quint32) index < Textures.Length() && arrays[index] >= 0)
+			{
+				array = mTextureArrays[arrays[index]];
+				block->Layers[s] = layers[index];
+			}
+
+			mMaterialTextures[i * Material::SlotCount + s] = array;
+		}
+	}
+
+	// Upload every block at once
+	if (!mMaterialBuffer.Load (data.size()))
+		{ UnloadMaterials(); return false; }
+
+	mMaterialBuffer.Update (data.constData(), data.size());
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Model::UnloadMaterials (void)
+{
+	qDeleteAll (mTextureArrays);
+	mTextureArrays.clear();
+
+	mMaterialBuffer.Unload();
+	mMaterialTextures.clear();
+	mMaterialStride = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool Model::AreMaterialsLoaded (void) const
+{
+	return Materials.Length() > 0 ? mMaterialBuffer.IsLoaded() : true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns the texture array of a material slot or null. </summary>
+
+const TextureArray* Model::GetMaterialTexture (qint32 material, Material::TextureSlot slot) const
+{
+	qint32 index = material * Material::SlotCount + slot;
+	return index >= 0 && index < mMaterialTextures.size() ? mMaterialTextures[index] : nullptr;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
@@ -239,3 +397,33 @@ void Model::SetPhysicsMesh (Mesh* mesh)
 
 	mPhysics = mesh;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Skeleton* Model::GetSkeleton (void) const
+{
+	return mSkeleton;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Model::SetSkeleton (Skeleton* skeleton)
+{
+	if (mSkeleton != nullptr)
+		delete mSkeleton;
+
+	mSkeleton = skeleton;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+Animation* Model::FindAnimation (const QString& name) const
+{
+	for (quint32 i = 0; i < Animations.Length(); ++i)
+		if (Animations[i]->Name == name) return Animations[i];
+
+	return nullptr;
+}
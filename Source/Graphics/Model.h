@@ -15,13 +15,20 @@
 #define GRAPHICS_MODEL_H
 
 class Mesh;
-class Material;
 class Texture;
+class Skeleton;
+class TextureArray;
+class Animation;
 class VertexElement;
 
 #include "Content/Asset.h"
 #include "Collections.h"
 
+#include "Graphics/Material.h"
+#include "Graphics/UniformBuffer.h"
+#include <QList.h>
+#include <QVector.h>
+
 
 
 //----------------------------------------------------------------------------//
@@ -42,6 +49,7 @@ public:
 
 protected:
 	virtual ~Model (void);
+	virtual void ReleaseDependencies (void);
 
 public:
 	// Methods
@@ -63,18 +71,39 @@ public:
 	bool IsGeometryPurged	(void) const;
 	void PurgeGeometry		(bool force = false);
 
+	bool LoadMaterials		(bool groupTextures = true);
+	void UnloadMaterials	(void);
+	bool AreMaterialsLoaded	(void) const;
+
+	const UniformBuffer* GetMaterialBuffer	(void) const { return &mMaterialBuffer; }
+	quint32 GetMaterialOffset	(qint32 material) const { return material * mMaterialStride; }
+	const TextureArray* GetMaterialTexture	(qint32 material, Material::TextureSlot slot) const;
+
 	Mesh* GetPhysicsMesh	(void) const;
 	void  SetPhysicsMesh	(Mesh* mesh);
 
+	Skeleton* GetSkeleton	(void) const;
+	void      SetSkeleton	(Skeleton* skeleton);
+
+	Animation* FindAnimation (const QString& name) const;
+
 public:
 	// Properties
 	ElementCollection<Mesh>		Meshes;		// List of meshes
 	ElementCollection<Material>	Materials;	// List of materials
 	AssetCollection<Texture>	Textures;	// List of textures
 
+	ElementCollection<Animation> Animations;// List of animation clips
+
 protected:
 	// Fields
 	Mesh* mPhysics;							// Physics mesh
+	Skeleton* mSkeleton;					// Animation skeleton
+
+	UniformBuffer mMaterialBuffer;			// Compiled material blocks
+	quint32 mMaterialStride;				// Aligned size of one block
+	QList<TextureArray*> mTextureArrays;	// Packed model textures
+	QVector<const TextureArray*> mMaterialTextures;// Texture set per material
 };
 
 #endif // GRAPHICS_MODEL_H
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/ModelInstanceBatch.h"
+
+#include "Graphics/Mesh.h"
+#include "Graphics/Model.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                            ModelInstanceBatch //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ModelInstanceBatch::ModelInstanceBatch (const Model* model)
+{
+	mModel    = model;
+	mUploaded = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ModelInstanceBatch::~ModelInstanceBatch (void)
+{
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                 ModelInstanceBatch //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Keeps the uploaded stream until the next upload
+
+void ModelInstanceBatch::Clear (void)
+{
+	mWorlds.resize (0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ModelInstanceBatch::Add (const Matrix& world)
+{
+	mWorlds.append (world);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the collected matrices into the instance stream. </summary>
+/// The stream grows by doubling, later uploads only send the new count
+
+bool ModelInstanceBatch::Upload (void)
+{
+	mUploaded = 0;
+	if (mWorlds.isEmpty()) return true;
+
+	quint32 count = mWorlds.size();
+	if (count > mInstances.GetVertexCount())
+	{
+		quint32 capacity = qMax<quint32> (64, mInstances.GetVertexCount());
+		while (capacity < count) capacity *= 2;
+
+		// Recreate the stream with room for every instance
+		mInstances.Unload();
+		if (!mInstances.Create (capacity, VertexInstance::ElementCount,
+			VertexInstance::VertexElements, 1, InstanceLocation)) return false;
+
+		memcpy (mInstances.GetData(), mWorlds.constData(), count * sizeof (Matrix));
+		if (!mInstances.Load()) return false;
+	}
+
+	else
+	{
+		memcpy (mInstances.GetData(), mWorlds.constData(), count * sizeof (Matrix));
+		if (!mInstances.Update (count)) return false;
+	}
+
+	mUploaded = count;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws every mesh, materials are left to the caller. </summary>
+
+void ModelInstanceBatch::Draw (void) const
+{
+	if (mModel == nullptr) return;
+
+	for (quint32 i = 0; i < mModel->Meshes.Length(); ++i)
+		mModel->Meshes[i]->DrawInstanced (mUploaded, &mInstances);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ModelInstanceBatch::Draw (quint32 mesh) const
+{
+	if (mModel == nullptr || mesh >= mModel->Meshes.Length()) return;
+	mModel->Meshes[mesh]->DrawInstanced (mUploaded, &mInstances);
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_MODEL_INSTANCE_BATCH_H
+#define GRAPHICS_MODEL_INSTANCE_BATCH_H
+
+class Model;
+
+#include "Math/Matrix.h"
+#include "Graphics/Vertex.h"
+#include <QVector.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Collects world matrices of one model and draws every mesh
+/// 		  of the model once for all of them. </summary>
+
+class ModelInstanceBatch
+{
+public:
+	// Constructors
+	 ModelInstanceBatch (const Model* model = nullptr);
+	~ModelInstanceBatch (void);
+
+public:
+	// Methods
+	void			Clear			(void);
+	void			Add				(const Matrix& world);
+	bool			Upload			(void);
+
+	void			Draw			(void) const;
+	void			Draw			(quint32 mesh) const;
+
+	quint32			Length			(void) const { return mWorlds.size();		}
+	bool			IsEmpty			(void) const { return mWorlds.isEmpty();	}
+
+	const Model*	GetModel		(void) const { return mModel;		}
+	void			SetModel		(const Model* model) { mModel = model; }
+
+	const VertexBuffer* GetInstances (void) const { return &mInstances; }
+
+public:
+	// Constants
+	static const quint8 InstanceLocation = 8;	// Attribute location of the world matrix
+
+private:
+	// Fields
+	const Model*	mModel;			// Model to draw
+	QVector<Matrix>	mWorlds;		// World matrix per instance
+
+	VertexBuffer	mInstances;		// Uploaded instance stream
+	quint32			mUploaded;		// Instances in the stream
+};
+
+#endif // GRAPHICS_MODEL_INSTANCE_BATCH_H
@@ -0,0 +1,591 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/OcclusionBuffer.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Vertex.h"
+
+#include "Math/Math.h"
+#include "Math/Random.h"
+#include "Engine/Console.h"
+
+#include <QHash.h>
+#include <QElapsedTimer.h>
+#include <xmmintrin.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+// Vertices closer than this to the eye are not projected
+static const float MinW = 1e-4f;
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                               OcclusionBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+OcclusionBuffer::OcclusionBuffer (void)
+{
+	mWidth  = 0;
+	mHeight = 0;
+	mData   = nullptr;
+	mMatrix = Matrix::Identity;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+OcclusionBuffer::~OcclusionBuffer (void)
+{
+	Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                    OcclusionBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Allocates every level of the buffer. </summary>
+/// Width and height must be powers of two, width at least four
+
+bool OcclusionBuffer::Create (quint32 width, quint32 height)
+{
+	Destroy();
+
+	// Check parameters
+	if (width < 4 || height == 0 ||
+		(width  & (width  - 1)) != 0 ||
+		(height & (height - 1)) != 0)
+	{
+		Console::Error ("Occlusion buffer size must be a power of two");
+		return false;
+	}
+
+	// Count the texels of every level
+	quint32 total = 0;
+	for (quint32 w = width, h = height; ; w = qMax (w / 2, 1u), h = qMax (h / 2, 1u))
+	{
+		Level level;
+		level.Width  = w;
+		level.Height = h;
+		level.Depths = nullptr;
+		mLevels.append (level);
+
+		// Keep every level 16 byte aligned
+		total += (w * h + 3) & ~3;
+		if (w == 1 && h == 1) break;
+	}
+
+	mData = (float*) qMallocAligned (total * sizeof (float), 16);
+
+	float* depths = mData;
+	for (qint32 i = 0; i < mLevels.size(); ++i)
+	{
+		mLevels[i].Depths = depths;
+		depths += (mLevels[i].Width * mLevels[i].Height + 3) & ~3;
+	}
+
+	mWidth  = width;
+	mHeight = height;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void OcclusionBuffer::Destroy (void)
+{
+	if (mData != nullptr)
+		qFreeAligned (mData);
+
+	mData = nullptr;
+	mLevels.clear();
+
+	mWidth  = 0;
+	mHeight = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Copies the triangles of a mesh into the occluder set. </summary>
+/// The mesh data must not be purged, occluders must be closed opaque
+/// render geometry since anything they cover is treated as hidden.
+/// Only the vertices of the given subset are copied unless it's negative
+
+bool OcclusionBuffer::AddOccluder (const Mesh* mesh, const Matrix& world, qint32 subset)
+{
+	const VertexBuffer* vertices = mesh->GetVertices();
+	const IndexBuffer*  indices  = mesh->GetIndices ();
+
+	if (vertices->IsPurged() || indices->IsPurged()) return false;
+
+	// Find the vertex position element
+	const VertexDeclaration* declaration = vertices->GetVertexDeclaration();
+	const VertexElement* elements = declaration->GetElements();
+	const VertexElement* position = nullptr;
+
+	for (quint8 i = 0; i < declaration->GetElementCount(); ++i)
+		if (elements[i].ElementType == VertexElement::PositionType)
+			{ position = &elements[i]; break; }
+
+	if (position == nullptr) return false;
+
+	if (subset >= mesh->Subsets.size()) return false;
+
+	const quint8* data = vertices->GetData() + position->Offset;
+	const quint16 size = declaration->GetVertexSize();
+
+	quint32 first = subset < 0 ? 0 : mesh->Subsets[subset].IndexOffset;
+	quint32 count = subset < 0 ? indices->GetIndexCount() :
+		mesh->Subsets[subset].IndexCount;
+
+	// Copy each referenced vertex once
+	QHash<quint32, quint32> remap;
+	const Matrix& m = world;
+
+	for (quint32 i = first; i < first + count; ++i)
+	{
+		quint32 index = indices->GetIndex (i);
+		QHash<quint32, quint32>::const_iterator found = remap.constFind (index);
+
+		if (found != remap.constEnd())
+			{ mIndices.append (found.value()); continue; }
+
+		// Transform the position into world space
+		const float* p = (const float*) (data + index * size);
+		mPositions.append (Vector4
+		(
+			m.M11 * p[0] + m.M12 * p[1] + m.M13 * p[2] + m.M14,
+			m.M21 * p[0] + m.M22 * p[1] + m.M23 * p[2] + m.M24,
+			m.M31 * p[0] + m.M32 * p[1] + m.M33 * p[2] + m.M34, 1.0f
+		));
+
+		remap.insert (index, mPositions.size() - 1);
+		mIndices.append (mPositions.size() - 1);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Adds the twelve triangles of a solid box. </summary>
+
+void OcclusionBuffer::AddOccluder (const BoundingBox& box)
+{
+	const quint32 base = mPositions.size();
+
+	for (quint32 i = 0; i < 8; ++i)
+	{
+		mPositions.append (Vector4
+		(
+			(i & 1) ? box.Max.X : box.Min.X,
+			(i & 2) ? box.Max.Y : box.Min.Y,
+			(i & 4) ? box.Max.Z : box.Min.Z, 1.0f
+		));
+	}
+
+	// Two triangles for each face, corners are indexed by their bits
+	static const quint8 Faces[36] =
+	{
+		0, 2, 1,  1, 2, 3,		// -Z
+		4, 5, 6,  5, 7, 6,		// +Z
+		0, 1, 4,  1, 5, 4,		// -Y
+		2, 6, 3,  3, 6, 7,		// +Y
+		0, 4, 2,  2, 4, 6,		// -X
+		1, 3, 5,  3, 7, 5,		// +X
+	};
+
+	for (quint32 i = 0; i < 36; ++i)
+		mIndices.append (base + Faces[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void OcclusionBuffer::ClearOccluders (void)
+{
+	mPositions.clear();
+	mIndices  .clear();
+	mScreen   .clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Rasterizes every occluder and rebuilds the levels. </summary>
+
+void OcclusionBuffer::Render (const Matrix& viewProjection)
+{
+	if (mData == nullptr) return;
+	mMatrix = viewProjection;
+
+	// Clear the finest level to the far plane
+	Level& finest = mLevels[0];
+	const __m128 far = _mm_set1_ps (1.0f);
+
+	for (quint32 i = 0; i < finest.Width * finest.Height; i += 4)
+		_mm_store_ps (finest.Depths + i, far);
+
+	// Project the occluders into pixel coordinates
+	const Matrix& m = viewProjection;
+	mScreen.resize (mPositions.size());
+
+	float halfW = mWidth  * 0.5f;
+	float halfH = mHeight * 0.5f;
+
+	for (qint32 i = 0; i < mPositions.size(); ++i)
+	{
+		const Vector4& p = mPositions[i];
+		float x = m.M11 * p.X + m.M12 * p.Y + m.M13 * p.Z + m.M14;
+		float y = m.M21 * p.X + m.M22 * p.Y + m.M23 * p.Z + m.M24;
+		float z = m.M31 * p.X + m.M32 * p.Y + m.M33 * p.Z + m.M34;
+		float w = m.M41 * p.X + m.M42 * p.Y + m.M43 * p.Z + m.M44;
+
+		// W stays in place to flag vertices behind the eye
+		if (w < MinW) { mScreen[i] = Vector4 (0, 0, 0, w); continue; }
+
+		float invW = 1.0f / w;
+		mScreen[i] = Vector4 ((x * invW + 1) * halfW,
+			(1 - y * invW) * halfH, z * invW, w);
+	}
+
+	// Triangles crossing the near plane are skipped, occluders stay conservative
+	for (qint32 i = 0; i + 2 < mIndices.size(); i += 3)
+	{
+		const Vector4& v0 = mScreen[mIndices[i + 0]];
+		const Vector4& v1 = mScreen[mIndices[i + 1]];
+		const Vector4& v2 = mScreen[mIndices[i + 2]];
+
+		if (v0.W < MinW || v1.W < MinW || v2.W < MinW) continue;
+		DrawTriangle (v0, v1, v2);
+	}
+
+	BuildLevels();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether any part of a box could be in front of
+/// 		  the occluders rendered last. </summary>
+
+bool OcclusionBuffer::IsVisible (const BoundingBox& box) const
+{
+	if (mData == nullptr) return true;
+	const Matrix& m = mMatrix;
+
+	float minX = mWidth, maxX = 0;
+	float minY = mHeight, maxY = 0;
+	float minZ = 1;
+
+	// Project all eight corners
+	for (quint32 i = 0; i < 8; ++i)
+	{
+		float cx = (i & 1) ? box.Max.X : box.Min.X;
+		float cy = (i & 2) ? box.Max.Y : box.Min.Y;
+		float cz = (i & 4) ? box.Max.Z : box.Min.Z;
+
+		float x = m.M11 * cx + m.M12 * cy + m.M13 * cz + m.M14;
+		float y = m.M21 * cx + m.M22 * cy + m.M23 * cz + m.M24;
+		float z = m.M31 * cx + m.M32 * cy + m.M33 * cz + m.M34;
+		float w = m.M41 * cx + m.M42 * cy + m.M43 * cz + m.M44;
+
+		// Boxes reaching behind the eye are always visible
+		if (w < MinW) return true;
+
+		float invW = 1.0f / w;
+		float sx = (x * invW + 1) * mWidth  * 0.5f;
+		float sy = (1 - y * invW) * mHeight * 0.5f;
+
+		minX = Math::Min (minX, sx); maxX = Math::Max (maxX, sx);
+		minY = Math::Min (minY, sy); maxY = Math::Max (maxY, sy);
+		minZ = Math::Min (minZ, z * invW);
+	}
+
+	// Clip the rectangle to the buffer
+	qint32 x0 = qMax ((qint32) Math::Floor (minX), 0);
+	qint32 y0 = qMax ((qint32) Math::Floor (minY), 0);
+	qint32 x1 = qMin ((qint32) Math::Floor (maxX), (qint32) mWidth  - 1);
+	qint32 y1 = qMin ((qint32) Math::Floor (maxY), (qint32) mHeight - 1);
+
+	// Outside of the buffer, leave it to frustum culling
+	if (x0 > x1 || y0 > y1) return true;
+
+	// Pick the level where the rectangle spans at most two texels
+	qint32 index = 0;
+	while (index + 1 < mLevels.size() &&
+		  ((x1 >> index) - (x0 >> index) > 1 ||
+		   (y1 >> index) - (y0 >> index) > 1)) ++index;
+
+	const Level& level = mLevels[index];
+	for (qint32 y = y0 >> index; y <= (y1 >> index); ++y)
+		for (qint32 x = x0 >> index; x <= (x1 >> index); ++x)
+		{
+			// Some occluder in this texel is farther than the box
+			if (minZ <= level.Depths[y * level.Width + x])
+				return true;
+		}
+
+	return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Clears the visibility of boxes hidden by the occluders. </summary>
+/// Boxes already flagged as hidden are not tested
+
+void OcclusionBuffer::Cull (quint32 length, const BoundingBox* boxes, quint8* visible) const
+{
+	if (mData == nullptr || !HasOccluders()) return;
+
+	for (quint32 i = 0; i < length; ++i)
+		if (visible[i]) visible[i] = IsVisible (boxes[i]);
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                     OcclusionBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks boxes behind, in front of and through a single wall,
+/// 		  no GL context is required. </summary>
+/// <returns> True when every box is classified as expected. </returns>
+
+bool OcclusionBuffer::Test (void)
+{
+	Console::Message ("\nOcclusion buffer test");
+	Console::Message ("---------------------");
+
+	// Look straight at a wall from ten units away
+	Matrix view = Matrix::CreateLookAt (Vector3 (0, 5, 10),
+		Vector3 (0, 5, 0), Vector3 (0, 1, 0));
+	Matrix viewProjection = Matrix::CreatePerspectiveFieldOfView
+		(Math::PiOver4, 2.0f, 1.0f, 100.0f) * view;
+
+	OcclusionBuffer buffer;
+	if (!buffer.Create (256, 128))
+		return false;
+
+	buffer.AddOccluder (BoundingBox (Vector3 (-40, -20, -1), Vector3 (40, 30, 1)));
+	buffer.Render (viewProjection);
+
+	const char* names[] = { "behind", "in front", "straddling" };
+	const BoundingBox boxes[] =
+	{
+		BoundingBox (Vector3 (-2, 3, -12), Vector3 (2, 7, -8)),
+		BoundingBox (Vector3 (-2, 3,   2), Vector3 (2, 7,  6)),
+		BoundingBox (Vector3 (-2, 3,  -3), Vector3 (2, 7,  3)),
+	};
+	const quint8 expected[] = { 0, 1, 1 };
+
+	quint8 visible[3] = { 1, 1, 1 };
+	buffer.Cull (3, boxes, visible);
+
+	bool passed = true;
+	for (quint32 i = 0; i < 3; ++i)
+	{
+		if (visible[i] == expected[i])
+			Console::Message ("Box %-10s %-7s passed", names[i], visible[i] ? "kept" : "hidden");
+
+		else
+		{
+			Console::Error ("Box %-10s %-7s expected %s", names[i],
+				visible[i] ? "kept" : "hidden", expected[i] ? "kept" : "hidden");
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Times rendering and culling a field of walls at several
+/// 		  resolutions, no GL context is required. </summary>
+
+void OcclusionBuffer::Benchmark (void)
+{
+	Random random;
+	QElapsedTimer timer;
+
+	Console::Message ("\nOcclusion buffer benchmark");
+	Console::Message ("--------------------------");
+
+	// Look across a grid of walls from just above the ground
+	Matrix view = Matrix::CreateLookAt (Vector3 (0, 15, 520),
+		Vector3 (0, 10, 0), Vector3 (0, 1, 0));
+	Matrix viewProjection = Matrix::CreatePerspectiveFieldOfView
+		(Math::PiOver4, 16.0f / 9.0f, 1.0f, 2000.0f) * view;
+
+	// Scatter small objects in between the walls
+	const quint32 count = 8192;
+	QVector<BoundingBox> boxes (count);
+	QVector<quint8> visible (count);
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		Vector3 center (random.NextReal() * 960 - 480,
+			random.NextReal() * 20, random.NextReal() * 960 - 480);
+		Vector3 extent (1 + random.NextReal() * 4);
+		boxes[i] = BoundingBox (center - extent, center + extent);
+	}
+
+	for (quint32 width = 128; width <= 1024; width *= 2)
+	{
+		OcclusionBuffer buffer;
+		buffer.Create (width, width / 2);
+
+		for (qint32 z = -480; z <= 480; z += 60)
+			for (qint32 x = -480; x <= 480; x += 60)
+			{
+				buffer.AddOccluder (BoundingBox (Vector3 (x - 20.0f, 0, z - 2.0f),
+					Vector3 (x + 20.0f, 30, z + 2.0f)));
+			}
+
+		// Take the best of several runs
+		qint64 render = -1, cull = -1;
+		quint32 hidden = 0;
+
+		for (quint32 run = 0; run < 5; ++run)
+		{
+			timer.start();
+			buffer.Render (viewProjection);
+			qint64 elapsed = timer.nsecsElapsed();
+
+			if (render < 0 || elapsed < render)
+				render = elapsed;
+
+			visible.fill (1);
+			timer.start();
+			buffer.Cull (count, boxes.constData(), visible.data());
+			elapsed = timer.nsecsElapsed();
+
+			if (cull < 0 || elapsed < cull)
+				cull = elapsed;
+		}
+
+		for (quint32 i = 0; i < count; ++i)
+			if (!visible[i]) ++hidden;
+
+		Console::Message ("%4ux%-4u %5u triangles: render %7.3f ms, cull %7.3f ms, %u of %u hidden",
+			buffer.GetWidth(), buffer.GetHeight(), (quint32) buffer.mIndices.size() / 3,
+			render / 1000000.0, cull / 1000000.0, hidden, count);
+	}
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                   OcclusionBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Rasterizes a triangle four pixels at a time. </summary>
+/// Vertices are in pixel coordinates, depth is interpolated linearly
+/// and the nearest depth is kept
+
+void OcclusionBuffer::DrawTriangle (const Vector4& v0, const Vector4& v1, const Vector4& v2)
+{
+	// Twice the signed area, both windings are drawn
+	float area = (v1.X - v0.X) * (v2.Y - v0.Y) - (v2.X - v0.X) * (v1.Y - v0.Y);
+	if (Math::Abs (area) < 1e-6f) return;
+
+	const Vector4& a = v0;
+	const Vector4& b = area > 0 ? v1 : v2;
+	const Vector4& c = area > 0 ? v2 : v1;
+	area = Math::Abs (area);
+
+	// Bounding rectangle clipped to the buffer, aligned to four pixels
+	qint32 x0 = qMax ((qint32) Math::Floor (Math::Min (a.X, Math::Min (b.X, c.X))), 0) & ~3;
+	qint32 y0 = qMax ((qint32) Math::Floor (Math::Min (a.Y, Math::Min (b.Y, c.Y))), 0);
+	qint32 x1 = qMin ((qint32) Math::Ceiling (Math::Max (a.X, Math::Max (b.X, c.X))), (qint32) mWidth  - 1);
+	qint32 y1 = qMin ((qint32) Math::Ceiling (Math::Max (a.Y, Math::Max (b.Y, c.Y))), (qint32) mHeight - 1);
+
+	if (x0 > x1 || y0 > y1) return;
+
+	// Edge functions of the form A * x + B * y + C
+	float a0 = b.Y - c.Y, b0 = c.X - b.X, c0 = b.X * c.Y - c.X * b.Y;
+	float a1 = c.Y - a.Y, b1 = a.X - c.X, c1 = c.X * a.Y - a.X * c.Y;
+	float a2 = a.Y - b.Y, b2 = b.X - a.X, c2 = a.X * b.Y - b.X * a.Y;
+
+	// Depth plane from the barycentric weights
+	float invArea = 1.0f / area;
+	float az = (a0 * a.Z + a1 * b.Z + a2 * c.Z) * invArea;
+	float bz = (b0 * a.Z + b1 * b.Z + b2 * c.Z) * invArea;
+	float cz = (c0 * a.Z + c1 * b.Z + c2 * c.Z) * invArea;
+
+	const __m128 offsets = _mm_set_ps (3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	float* row = mLevels[0].Depths + y0 * mWidth;
+	for (qint32 y = y0; y <= y1; ++y, row += mWidth)
+	{
+		float py = y + 0.5f;
+		for (qint32 x = x0; x <= x1; x += 4)
+		{
+			// Sample at the centers of four pixels
+			__m128 px = _mm_add_ps (_mm_set1_ps ((float) x), offsets);
+
+			__m128 e0 = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (a0), px), _mm_set1_ps (b0 * py + c0));
+			__m128 e1 = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (a1), px), _mm_set1_ps (b1 * py + c1));
+			__m128 e2 = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (a2), px), _mm_set1_ps (b2 * py + c2));
+
+			__m128 inside = _mm_and_ps (_mm_cmpge_ps (e0, zero),
+				_mm_and_ps (_mm_cmpge_ps (e1, zero), _mm_cmpge_ps (e2, zero)));
+
+			if (_mm_movemask_ps (inside) == 0) continue;
+
+			__m128 depth = _mm_add_ps (_mm_mul_ps (_mm_set1_ps (az), px), _mm_set1_ps (bz * py + cz));
+			__m128 old = _mm_load_ps (row + x);
+
+			// Keep the nearest depth inside the triangle
+			__m128 result = _mm_min_ps (old, depth);
+			result = _mm_or_ps (_mm_and_ps (inside, result), _mm_andnot_ps (inside, old));
+			_mm_store_ps (row + x, result);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds every coarser level from the farthest depth
+/// 		  of each two by two block. </summary>
+
+void OcclusionBuffer::BuildLevels (void)
+{
+	for (qint32 i = 1; i < mLevels.size(); ++i)
+	{
+		const Level& source = mLevels[i - 1];
+		Level& target = mLevels[i];
+
+		for (quint32 y = 0; y < target.Height; ++y)
+		{
+			// Levels can be a single texel tall or wide
+			quint32 sy0 = qMin (y * 2 + 0, source.Height - 1);
+			quint32 sy1 = qMin (y * 2 + 1, source.Height - 1);
+
+			for (quint32 x = 0; x < target.Width; ++x)
+			{
+				quint32 sx0 = qMin (x * 2 + 0, source.Width - 1);
+				quint32 sx1 = qMin (x * 2 + 1, source.Width - 1);
+
+				target.Depths[y * target.Width + x] = Math::Max (
+					Math::Max (source.Depths[sy0 * source.Width + sx0], source.Depths[sy0 * source.Width + sx1]),
+					Math::Max (source.Depths[sy1 * source.Width + sx0], source.Depths[sy1 * source.Width + sx1]));
+			}
+		}
+	}
+}
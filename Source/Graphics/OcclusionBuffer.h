@@ -0,0 +1,100 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_OCCLUSION_BUFFER_H
+#define GRAPHICS_OCCLUSION_BUFFER_H
+
+class Mesh;
+
+#include <QVector.h>
+#include "Math/Matrix.h"
+#include "Math/Vector4.h"
+#include "Math/BoundingBox.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Low resolution depth buffer rasterized on the CPU from
+/// 		  occluder meshes, used to reject hidden bounding boxes. </summary>
+/// Depths are stored in normalized device coordinates, a hierarchy of
+/// levels keeps the farthest depth of every two by two block
+
+class OcclusionBuffer
+{
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Level
+	{
+	public:
+		// Properties
+		quint32		Width;			// Width in texels
+		quint32		Height;			// Height in texels
+		float*		Depths;			// Row major depths
+	};
+
+public:
+	// Constructors
+	 OcclusionBuffer (void);
+	~OcclusionBuffer (void);
+
+public:
+	// Methods
+	bool		Create			(quint32 width, quint32 height);
+	void		Destroy			(void);
+
+	bool		AddOccluder		(const Mesh* mesh, const Matrix& world, qint32 subset = -1);
+	void		AddOccluder		(const BoundingBox& box);
+	void		ClearOccluders	(void);
+	bool		HasOccluders	(void) const { return !mIndices.isEmpty(); }
+
+	void		Render			(const Matrix& viewProjection);
+
+	bool		IsVisible		(const BoundingBox& box) const;
+	void		Cull			(quint32 length, const BoundingBox* boxes, quint8* visible) const;
+
+	quint32		GetWidth		(void) const { return mWidth;  }
+	quint32		GetHeight		(void) const { return mHeight; }
+
+public:
+	// Static
+	static bool	Test			(void);
+	static void	Benchmark		(void);
+
+private:
+	// Internal
+	void		DrawTriangle	(const Vector4& v0, const Vector4& v1, const Vector4& v2);
+	void		BuildLevels		(void);
+
+private:
+	// Fields
+	quint32				mWidth;			// Width of the finest level
+	quint32				mHeight;		// Height of the finest level
+
+	float*				mData;			// Single aligned allocation
+	QVector<Level>		mLevels;		// Finest level first
+
+	Matrix				mMatrix;		// View projection of the last render
+
+	QVector<Vector4>	mPositions;		// World space occluder positions
+	QVector<quint32>	mIndices;		// Occluder triangle indices
+	QVector<Vector4>	mScreen;		// Projected occluder positions
+};
+
+#endif // GRAPHICS_OCCLUSION_BUFFER_H
@@ -0,0 +1,396 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/ParticleBuffer.h"
+#include "Graphics/Vertex.h"
+#include "Math/Matrix.h"
+#include "Engine/Console.h"
+
+#include <QVector.h>
+#include <QElapsedTimer.h>
+
+#include <xmmintrin.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                ParticleBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ParticleBuffer::ParticleBuffer (void)
+{
+	mCount		= 0;
+	mCapacity	= 0;
+	mSeed		= 1;
+	mData		= nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ParticleBuffer::~ParticleBuffer (void)
+{
+	Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                     ParticleBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool ParticleBuffer::Create (quint32 capacity)
+{
+	Destroy();
+
+	// Check parameters
+	if (capacity == 0) return false;
+	mCapacity = (capacity + 3) & ~3;
+
+	// Allocate every stream in one block, 16 byte aligned
+	const quint32 streams = 3 + 3 + 2;
+	mData = (float*) qMallocAligned (streams * mCapacity * sizeof (float), 16);
+	memset (mData, 0, streams * mCapacity * sizeof (float));
+
+	float* stream = mData;
+	for (quint32 i = 0; i < 3; ++i, stream += mCapacity) mPositions [i] = stream;
+	for (quint32 i = 0; i < 3; ++i, stream += mCapacity) mVelocities[i] = stream;
+
+	mAges  = stream; stream += mCapacity;
+	mLives = stream; stream += mCapacity;
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ParticleBuffer::Destroy (void)
+{
+	if (mData != nullptr)
+		qFreeAligned (mData);
+
+	mData = nullptr;
+	mCount = 0;
+	mCapacity = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Appends new particles after the living ones. </summary>
+/// Returns the number of particles that fit
+
+quint32 ParticleBuffer::Spawn (quint32 count,
+	const Vector3& position, const Vector3& velocity,
+	float spread, float minLife, float maxLife)
+{
+	count = qMin (count, mCapacity - mCount);
+
+	for (quint32 i = mCount; i < mCount + count; ++i)
+	{
+		mPositions [0][i] = position.X;
+		mPositions [1][i] = position.Y;
+		mPositions [2][i] = position.Z;
+
+		// Spawn inside a cone around the emitter velocity
+		mVelocities[0][i] = velocity.X + (Random() * 2 - 1) * spread;
+		mVelocities[1][i] = velocity.Y + (Random() * 2 - 1) * spread;
+		mVelocities[2][i] = velocity.Z + (Random() * 2 - 1) * spread;
+
+		mAges [i] = 0;
+		mLives[i] = minLife + (maxLife - minLife) * Random();
+	}
+
+	mCount += count;
+	return count;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Advances a range of particles by one step. </summary>
+/// Begin must be a multiple of four, ranges may be simulated in parallel
+
+void ParticleBuffer::Simulate (quint32 begin, quint32 end, const Forces& forces)
+{
+	if (begin >= end) return;
+	end = qMin ((end + 3) & ~3, mCapacity);
+
+	const __m128 step	= _mm_set1_ps (forces.TimeStep);
+	const __m128 drag	= _mm_set1_ps (qMin (forces.Drag * forces.TimeStep, 1.0f));
+	const __m128 ground	= _mm_set1_ps (forces.Ground);
+	const __m128 bounce	= _mm_set1_ps (-forces.Bounce);
+
+	const __m128 gravity[3] =
+	{
+		_mm_set1_ps (forces.Gravity.X * forces.TimeStep),
+		_mm_set1_ps (forces.Gravity.Y * forces.TimeStep),
+		_mm_set1_ps (forces.Gravity.Z * forces.TimeStep)
+	};
+
+	const __m128 wind[3] =
+	{
+		_mm_set1_ps (forces.Wind.X),
+		_mm_set1_ps (forces.Wind.Y),
+		_mm_set1_ps (forces.Wind.Z)
+	};
+
+	for (quint32 i = begin; i < end; i += 4)
+	{
+		__m128 p[3], v[3];
+
+		// Integrate forces, wind pulls the velocity along
+		for (quint32 a = 0; a < 3; ++a)
+		{
+			v[a] = _mm_add_ps (_mm_load_ps (mVelocities[a] + i), gravity[a]);
+			v[a] = _mm_add_ps (v[a], _mm_mul_ps (_mm_sub_ps (wind[a], v[a]), drag));
+			p[a] = _mm_add_ps (_mm_load_ps (mPositions [a] + i), _mm_mul_ps (v[a], step));
+		}
+
+		// Collide with the ground plane
+		__m128 below = _mm_cmplt_ps (p[1], ground);
+
+		p[1] = _mm_or_ps (_mm_and_ps (below, ground),
+			_mm_andnot_ps (below, p[1]));
+
+		v[1] = _mm_or_ps (_mm_and_ps (below, _mm_mul_ps (v[1], bounce)),
+			_mm_andnot_ps (below, v[1]));
+
+		for (quint32 a = 0; a < 3; ++a)
+		{
+			_mm_store_ps (mPositions [a] + i, p[a]);
+			_mm_store_ps (mVelocities[a] + i, v[a]);
+		}
+
+		_mm_store_ps (mAges + i, _mm_add_ps (_mm_load_ps (mAges + i), step));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Removes dead particles by moving the last living
+/// 		  particle into their place. </summary>
+
+quint32 ParticleBuffer::Compact (void)
+{
+	quint32 i = 0;
+	while (i < mCount)
+	{
+		if (mAges[i] < mLives[i]) { ++i; continue; }
+
+		quint32 last = --mCount;
+		for (quint32 a = 0; a < 3; ++a)
+		{
+			mPositions [a][i] = mPositions [a][last];
+			mVelocities[a][i] = mVelocities[a][last];
+		}
+
+		mAges [i] = mAges [last];
+		mLives[i] = mLives[last];
+	}
+
+	return mCount;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Computes the view space depth of a range of particles. </summary>
+/// More distant particles have smaller depths
+
+void ParticleBuffer::Depths (const Matrix& view,
+	float* depths, quint32 begin, quint32 end) const
+{
+	if (begin >= end) return;
+
+	// Handle the unaligned tail separately
+	quint32 last = end & ~3;
+
+	const __m128 m31 = _mm_set1_ps (view.M31);
+	const __m128 m32 = _mm_set1_ps (view.M32);
+	const __m128 m33 = _mm_set1_ps (view.M33);
+	const __m128 m34 = _mm_set1_ps (view.M34);
+
+	quint32 i = begin;
+	for (; i < last; i += 4)
+	{
+		__m128 depth = _mm_add_ps (
+			_mm_add_ps (_mm_mul_ps (m31, _mm_load_ps (mPositions[0] + i)),
+						_mm_mul_ps (m32, _mm_load_ps (mPositions[1] + i))),
+			_mm_add_ps (_mm_mul_ps (m33, _mm_load_ps (mPositions[2] + i)), m34));
+
+		_mm_storeu_ps (depths + i, depth);
+	}
+
+	for (; i < end; ++i)
+	{
+		depths[i] = view.M31 * mPositions[0][i] + view.M32 *
+			mPositions[1][i] + view.M33 * mPositions[2][i] + view.M34;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Interleaves a range of particles into vertices. </summary>
+/// Begin must be a multiple of four and vertices must hold the capacity
+
+void ParticleBuffer::Write (VertexParticle* vertices, quint32 begin, quint32 end) const
+{
+	if (begin >= end) return;
+	end = qMin ((end + 3) & ~3, mCapacity);
+	float* output = (float*) vertices;
+
+	for (quint32 i = begin; i < end; i += 4)
+	{
+		__m128 p0 = _mm_load_ps (mPositions [0] + i);
+		__m128 p1 = _mm_load_ps (mPositions [1] + i);
+		__m128 p2 = _mm_load_ps (mPositions [2] + i);
+		__m128 p3 = _mm_load_ps (mAges		  + i);
+
+		__m128 v0 = _mm_load_ps (mVelocities[0] + i);
+		__m128 v1 = _mm_load_ps (mVelocities[1] + i);
+		__m128 v2 = _mm_load_ps (mVelocities[2] + i);
+		__m128 v3 = _mm_load_ps (mLives		  + i);
+
+		// Each row now holds a single particle
+		_MM_TRANSPOSE4_PS (p0, p1, p2, p3);
+		_MM_TRANSPOSE4_PS (v0, v1, v2, v3);
+
+		float* o = output + i * 8;
+		_mm_storeu_ps (o +  0, p0); _mm_storeu_ps (o +  4, v0);
+		_mm_storeu_ps (o +  8, p1); _mm_storeu_ps (o + 12, v1);
+		_mm_storeu_ps (o + 16, p2); _mm_storeu_ps (o + 20, v2);
+		_mm_storeu_ps (o + 24, p3); _mm_storeu_ps (o + 28, v3);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Interleaves a range of particles into vertices,
+/// 		  reading the particles in the given order. </summary>
+
+void ParticleBuffer::Write (VertexParticle* vertices,
+	const quint32* order, quint32 begin, quint32 end) const
+{
+	float* output = (float*) vertices + begin * 8;
+
+	for (quint32 i = begin; i < end; ++i, output += 8)
+	{
+		quint32 p = order[i];
+		output[0] = mPositions [0][p];
+		output[1] = mPositions [1][p];
+		output[2] = mPositions [2][p];
+		output[3] = mAges		  [p];
+		output[4] = mVelocities[0][p];
+		output[5] = mVelocities[1][p];
+		output[6] = mVelocities[2][p];
+		output[7] = mLives		  [p];
+	}
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                      ParticleBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Prints how long each stage takes for a range of
+/// 		  particle counts without needing a GL context. </summary>
+
+void ParticleBuffer::Benchmark (void)
+{
+	ParticleBuffer buffer;
+	QElapsedTimer timer;
+
+	Forces forces;
+	forces.TimeStep	= 1.0f / 60.0f;
+	forces.Gravity	= Vector3 (0.0f, -9.8f, 0.0f);
+	forces.Wind		= Vector3 (2.0f,  0.0f, 1.0f);
+	forces.Drag		= 0.5f;
+	forces.Ground	= 0.0f;
+	forces.Bounce	= 0.4f;
+
+	Matrix view = Matrix::CreateLookAt (Vector3 (0.0f, 50.0f, 200.0f),
+										Vector3 (0.0f,  0.0f,   0.0f),
+										Vector3 (0.0f,  1.0f,   0.0f));
+
+	Console::Message ("\nParticle benchmark");
+	Console::Message ("------------------");
+	Console::Message ("%9s  %8s  %8s  %8s  %8s",
+		"particles", "simulate", "depths", "write", "compact");
+
+	for (quint32 count = 4096; count <= 1024 * 1024; count *= 4)
+	{
+		if (!buffer.Create (count)) return;
+
+		QVector<float> depths (count);
+		QVector<VertexParticle> vertices (count);
+
+		// Take the best of several runs
+		qint64 best[4] = { -1, -1, -1, -1 };
+		for (quint32 run = 0; run < 5; ++run)
+		{
+			// Refill the buffer with long living particles
+			buffer.mCount = 0;
+			buffer.Spawn (count, Vector3 (0.0f, 100.0f, 0.0f),
+				Vector3 (0.0f, 10.0f, 0.0f), 20.0f, 10.0f, 20.0f);
+
+			qint64 elapsed[4];
+			timer.start();
+			buffer.Simulate (0, count, forces);
+			elapsed[0] = timer.nsecsElapsed();
+
+			timer.start();
+			buffer.Depths (view, depths.data(), 0, count);
+			elapsed[1] = timer.nsecsElapsed();
+
+			timer.start();
+			buffer.Write (vertices.data(), 0, count);
+			elapsed[2] = timer.nsecsElapsed();
+
+			// Kill half of the particles to give compact work
+			for (quint32 i = 0; i < count; i += 2)
+				buffer.mAges[i] = buffer.mLives[i];
+
+			timer.start();
+			buffer.Compact();
+			elapsed[3] = timer.nsecsElapsed();
+
+			for (quint32 i = 0; i < 4; ++i)
+				if (best[i] < 0 || elapsed[i] < best[i])
+					best[i] = elapsed[i];
+		}
+
+		Console::Message ("%9u  %8.3f  %8.3f  %8.3f  %8.3f ms", count,
+			best[0] / 1000000.0, best[1] / 1000000.0,
+			best[2] / 1000000.0, best[3] / 1000000.0);
+	}
+
+	buffer.Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                    ParticleBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns a pseudo random number between zero and one. </summary>
+
+float ParticleBuffer::Random (void)
+{
+	mSeed = mSeed * 1664525 + 1013904223;
+	return (mSeed >> 8) * (1.0f / 16777216.0f);
+}
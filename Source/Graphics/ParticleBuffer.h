@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_PARTICLE_BUFFER_H
+#define GRAPHICS_PARTICLE_BUFFER_H
+
+class Matrix;
+class VertexParticle;
+
+#include <QGlobal.h>
+#include "Math/Vector3.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Structure of arrays particle states, simulated four particles at a time
+
+class ParticleBuffer
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Forces applied during a single simulation step. </summary>
+
+	class Forces
+	{
+	public:
+		// Properties
+		float		TimeStep;		// Seconds to advance
+		Vector3		Gravity;		// Constant acceleration
+		Vector3		Wind;			// Velocity particles drift towards
+		float		Drag;			// Rate of drifting towards the wind
+		float		Ground;			// Height of the collision plane
+		float		Bounce;			// Velocity kept after a collision
+	};
+
+public:
+	// Constructors
+	 ParticleBuffer (void);
+	~ParticleBuffer (void);
+
+private:
+	// Constructors
+	ParticleBuffer (const ParticleBuffer& buffer);
+	ParticleBuffer& operator = (const ParticleBuffer& buffer);
+
+public:
+	// Methods
+	bool		Create			(quint32 capacity);
+	void		Destroy			(void);
+
+	quint32		Spawn			(quint32 count,
+								 const Vector3& position,
+								 const Vector3& velocity,
+								 float spread, float minLife, float maxLife);
+
+	void		Simulate		(quint32 begin, quint32 end, const Forces& forces);
+	quint32		Compact			(void);
+
+	void		Depths			(const Matrix& view, float* depths, quint32 begin, quint32 end) const;
+
+	void		Write			(VertexParticle* vertices, quint32 begin, quint32 end) const;
+	void		Write			(VertexParticle* vertices, const quint32* order,
+								 quint32 begin, quint32 end) const;
+
+	quint32		GetCount		(void) const { return mCount;		}
+	quint32		GetCapacity		(void) const { return mCapacity;	}
+
+public:
+	// Static
+	static void	Benchmark		(void);
+
+private:
+	// Internal
+	float		Random			(void);
+
+private:
+	// Fields
+	quint32		mCount;			// Number of living particles
+	quint32		mCapacity;		// Particles rounded up to four
+	quint32		mSeed;			// Spawn random number state
+
+	float*		mData;			// Single aligned allocation
+
+	float*		mPositions	[3];	// Particle positions
+	float*		mVelocities	[3];	// Particle velocities
+	float*		mAges;				// Seconds since spawning
+	float*		mLives;				// Seconds until death
+};
+
+#endif // GRAPHICS_PARTICLE_BUFFER_H
@@ -0,0 +1,471 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/ParticleSimulator.h"
+
+#include "Graphics/Mesh.h"
+#include "Graphics/Texture.h"
+#include "Graphics/RenderState.h"
+#include "Engine/Console.h"
+
+#include <QThread.h>
+#include <QtConcurrentMap.h>
+
+#define GLEW_STATIC
+#include <glew.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+// Fewest software particles worth handing to a worker
+static const quint32 MinParticlesPerJob = 16384;
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                             ParticleSimulator //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ParticleSimulator::ParticleSimulator (void)
+{
+	Position		= Vector3::Zero;
+	Velocity		= Vector3::Zero;
+	Spread			= 1.0f;
+	Rate			= 100.0f;
+	MinLife			= 1.0f;
+	MaxLife			= 2.0f;
+
+	Gravity			= Vector3 (0.0f, -9.8f, 0.0f);
+	Wind			= Vector3::Zero;
+	Drag			= 0.0f;
+	Ground			= 0.0f;
+	Bounce			= 0.5f;
+
+	Diffuse			= Color::White;
+	Alpha			= 1.0f;
+	Shape			= 1.0f;
+	Size			= 1.0f;
+	FadeInTime		= 0.0f;
+	FadeOutTime		= 1.0f;
+
+	DepthSort		= false;
+	View			= Matrix::Identity;
+
+	mCapacity		= 0;
+	mCurrent		= 0;
+	mCursor			= 0;
+	mPending		= 0.0f;
+	mStep			= 0;
+	mSoftware		= false;
+
+	mArrays[0]		= 0;
+	mArrays[1]		= 0;
+
+	mQuad			= nullptr;
+	mTexture		= nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+ParticleSimulator::~ParticleSimulator (void)
+{
+	Unload();
+
+	if (mTexture != nullptr)
+		mTexture->Release();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                  ParticleSimulator //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Allocates the particle states and loads the shaders. </summary>
+/// Every slot starts out dead
+
+bool ParticleSimulator::Load (quint32 capacity, bool software)
+{
+	// Check if already loaded
+	if (IsLoaded()) return true;
+	if (capacity == 0) return false;
+
+	// Load the drawing shader
+	mDraw = Content::Load<Shader> ("Shaders/Particles/Draw.ast");
+	if (mDraw == nullptr || !mDraw->Load())
+		{ Unload(); return false; }
+
+	mDraw->Purge();
+
+	DrawUniforms& d = mDrawUniforms;
+	Shader* draw = mDraw;
+
+	d.Size			= draw->Handle ("Size");
+	d.FadeInTime	= draw->Handle ("FadeInTime");
+	d.FadeOutTime	= draw->Handle ("FadeOutTime");
+
+	d.Diffuse		= draw->Handle ("Diffuse");
+	d.Alpha			= draw->Handle ("Alpha");
+	d.Shape			= draw->Handle ("Shape");
+	d.Texture		= draw->Handle ("Texture");
+
+	// Create the quad every particle is drawn with
+	mQuad = new Mesh();
+	Mesh::CreateQuad (*mQuad, -1, -1, 1, 1);
+	mQuad->Load();
+
+	mCapacity	= capacity;
+	mCurrent	= 0;
+	mCursor		= 0;
+	mPending	= 0.0f;
+	mStep		= 0;
+	mSoftware	= software;
+
+	if (software)
+	{
+		// Living particles are streamed into a single buffer
+		mBuffer.Create (capacity);
+		mStates[0].Create (mBuffer.GetCapacity(), VertexParticle::ElementCount,
+			VertexParticle::VertexElements, 1, 8);
+
+		memset (mStates[0].GetData(), 0, mStates[0].GetDataLength());
+		if (!mStates[0].Load()) { Unload(); return false; }
+		mStates[0].Purge();
+
+		return true;
+	}
+
+	// Load the simulation shader
+	mSimulate = Content::Load<Shader> ("Shaders/Particles/Simulate.ast");
+	if (mSimulate == nullptr) { Unload(); return false; }
+
+	// Captured outputs come with the asset
+	if (mSimulate->Varyings.size() != 2)
+	{
+		Console::Error ("Simulation shader must capture two varyings");
+		Unload(); return false;
+	}
+
+	if (!mSimulate->Load()) { Unload(); return false; }
+	mSimulate->Purge();
+
+	// Look up uniform locations
+	SimulateUniforms& s = mSimulateUniforms;
+	Shader* simulate = mSimulate;
+
+	s.TimeStep		= simulate->Handle ("TimeStep");
+	s.Seed			= simulate->Handle ("Seed");
+
+	s.Gravity		= simulate->Handle ("Gravity");
+	s.Wind			= simulate->Handle ("Wind");
+	s.Drag			= simulate->Handle ("Drag");
+	s.Ground		= simulate->Handle ("Ground");
+	s.Bounce		= simulate->Handle ("Bounce");
+
+	s.Position		= simulate->Handle ("Position");
+	s.Velocity		= simulate->Handle ("Velocity");
+	s.Spread		= simulate->Handle ("Spread");
+	s.MinLife		= simulate->Handle ("MinLife");
+	s.MaxLife		= simulate->Handle ("MaxLife");
+
+	s.Capacity		= simulate->Handle ("Capacity");
+	s.SpawnStart	= simulate->Handle ("SpawnStart");
+	s.SpawnCount	= simulate->Handle ("SpawnCount");
+
+	// Create both particle states, they are read as instances when drawn
+	for (quint32 i = 0; i < 2; ++i)
+	{
+		mStates[i].Create (capacity, VertexParticle::ElementCount,
+			VertexParticle::VertexElements, 1, 8);
+
+		memset (mStates[i].GetData(), 0, mStates[i].GetDataLength());
+		if (!mStates[i].Load()) { Unload(); return false; }
+		mStates[i].Purge();
+	}
+
+	// Create vertex arrays reading each state as vertices
+	const VertexElement* elements = VertexParticle::VertexElements;
+
+	for (quint32 i = 0; i < 2; ++i)
+	{
+		GL_CALL (glGenVertexArrays (1, &mArrays[i]));
+		RenderState::BindVertexArray (mArrays[i]);
+
+		GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mStates[i].GetVertexID()));
+
+		for (quint32 e = 0; e < VertexParticle::ElementCount; ++e)
+		{
+			GL_CALL (glEnableVertexAttribArray (e));
+			GL_CALL (glVertexAttribPointer (e, elements[e].GetComponentCount(),
+				elements[e].GetFormatType(), GL_FALSE, sizeof (VertexParticle),
+				(void*) (e * sizeof (Vector4))));
+		}
+	}
+
+	RenderState::BindVertexArray (0);
+
+	// Check for any OpenGL errors
+	GL_CHECK (Unload(); return false);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ParticleSimulator::Unload (void)
+{
+	for (quint32 i = 0; i < 2; ++i)
+	{
+		if (mArrays[i] != 0)
+		{
+			RenderState::BindVertexArray (0);
+			GL_CALL (glDeleteVertexArrays (1, &mArrays[i]));
+			mArrays[i] = 0;
+		}
+
+		mStates[i].Unload();
+	}
+
+	mBuffer.Destroy();
+	mJobs.clear();
+
+	if (mQuad != nullptr)
+	{
+		delete mQuad;
+		mQuad = nullptr;
+	}
+
+	mSimulate.Release();
+	mDraw    .Release();
+
+	mCapacity = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ParticleSimulator::Update (quint32 elapsedTime)
+{
+	if (!IsLoaded() || elapsedTime == 0) return;
+	float step = elapsedTime / 1000.0f;
+
+	// Determine how many particles may spawn
+	mPending += Rate * step;
+	quint32 spawn = qMin ((quint32) mPending, mCapacity);
+	mPending -= spawn;
+
+	if (mSoftware)
+		UpdateSoftware (step, spawn);
+	else UpdateHardware (step, spawn);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Draws every slot as an instance, dead slots are culled
+/// 		  in the vertex shader. </summary>
+
+void ParticleSimulator::Draw (void) const
+{
+	if (!IsLoaded()) return;
+
+	// Make sure the texture is loaded
+	if (mTexture != nullptr && !mTexture->IsLoaded())
+		mTexture->Load();
+
+	const DrawUniforms& u = mDrawUniforms;
+	Shader* shader = mDraw;
+
+	shader->SetValue (u.Size,			Size);
+	shader->SetValue (u.FadeInTime,		FadeInTime);
+	shader->SetValue (u.FadeOutTime,	FadeOutTime);
+
+	shader->SetValue (u.Diffuse,		Diffuse);
+	shader->SetValue (u.Alpha,			Alpha);
+	shader->SetValue (u.Shape,			Shape);
+	shader->SetValue (u.Texture,		mTexture, 1);
+
+	// Software particles are compacted, only the living ones are drawn
+	quint32 count = mSoftware ? mBuffer.GetCount() : mCapacity;
+	if (count == 0) return;
+
+	RenderState::SetDepthMask (false);
+	mQuad->DrawInstanced (count, &mStates[mCurrent]);
+	RenderState::SetDepthMask (true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void ParticleSimulator::SetTexture (Texture* texture)
+{
+	if (mTexture != nullptr)
+		mTexture->Release();
+
+	mTexture = texture;
+
+	if (mTexture != nullptr)
+		mTexture->Retain();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                 ParticleSimulator //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Spawns and advances every particle in a single pass. </summary>
+/// Slots are handed out in a ring and only reused once their particle
+/// dies, so the capacity should cover Rate * MaxLife particles
+
+void ParticleSimulator::UpdateHardware (float step, quint32 spawn)
+{
+	const SimulateUniforms& u = mSimulateUniforms;
+	Shader* shader = mSimulate;
+
+	shader->SetValue (u.TimeStep,	step);
+	shader->SetValue (u.Seed,		(float) (mStep++ % 4096));
+
+	shader->SetValue (u.Gravity,	Gravity);
+	shader->SetValue (u.Wind,		Wind);
+	shader->SetValue (u.Drag,		Drag);
+	shader->SetValue (u.Ground,		Ground);
+	shader->SetValue (u.Bounce,		Bounce);
+
+	shader->SetValue (u.Position,	Position);
+	shader->SetValue (u.Velocity,	Velocity);
+	shader->SetValue (u.Spread,		Spread);
+	shader->SetValue (u.MinLife,	MinLife);
+	shader->SetValue (u.MaxLife,	MaxLife);
+
+	shader->SetValue (u.Capacity,	(qint32) mCapacity);
+	shader->SetValue (u.SpawnStart,	(qint32) mCursor);
+	shader->SetValue (u.SpawnCount,	(qint32) spawn);
+
+	mCursor = (mCursor + spawn) % mCapacity;
+
+	// Read the current state and capture the next one
+	quint32 next = 1 - mCurrent;
+	RenderState::BindVertexArray (mArrays[mCurrent]);
+
+	GL_CALL (glEnable (GL_RASTERIZER_DISCARD));
+	GL_CALL (glBindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 0, mStates[next].GetVertexID()));
+
+	GL_CALL (glBeginTransformFeedback (GL_POINTS));
+	GL_CALL (glDrawArrays (GL_POINTS, 0, mCapacity));
+	GL_CALL (glEndTransformFeedback());
+
+	GL_CALL (glBindBufferBase (GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0));
+	GL_CALL (glDisable (GL_RASTERIZER_DISCARD));
+
+	mCurrent = next;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Advances the particles on the CPU and streams the
+/// 		  living ones into the instance buffer. </summary>
+
+void ParticleSimulator::UpdateSoftware (float step, quint32 spawn)
+{
+	ParticleBuffer::Forces forces;
+	forces.TimeStep	= step;
+	forces.Gravity	= Gravity;
+	forces.Wind		= Wind;
+	forces.Drag		= Drag;
+	forces.Ground	= Ground;
+	forces.Bounce	= Bounce;
+
+	// Advance the living particles, then append new ones
+	quint32 threads = qMax (1, QThread::idealThreadCount());
+	quint32 length  = mBuffer.GetCount();
+	quint32 count   = qBound<quint32> (1, length / MinParticlesPerJob, threads);
+
+	// Keep every range starting on a multiple of four
+	quint32 range = ((length + count - 1) / count + 3) & ~3;
+
+	mJobs.resize (count);
+	for (quint32 i = 0; i < count; ++i)
+	{
+		mJobs[i].Buffer   = &mBuffer;
+		mJobs[i].Forces   = &forces;
+		mJobs[i].Vertices = nullptr;
+		mJobs[i].View     = &View;
+		mJobs[i].Keys     = nullptr;
+		mJobs[i].Order    = nullptr;
+		mJobs[i].Begin    = qMin (i * range, length);
+		mJobs[i].End      = qMin (i * range + range, length);
+	}
+
+	if (count > 1)
+		QtConcurrent::blockingMap (mJobs, &SoftwareJob::Simulate);
+	else mJobs[0].Simulate();
+
+	mBuffer.Compact();
+	mBuffer.Spawn (spawn, Position, Velocity, Spread, MinLife, MaxLife);
+
+	length = mBuffer.GetCount();
+	count  = qBound<quint32> (1, length / MinParticlesPerJob, threads);
+	range  = ((length + count - 1) / count + 3) & ~3;
+
+	mJobs.resize (count);
+	for (quint32 i = 0; i < count; ++i)
+	{
+		mJobs[i].Buffer   = &mBuffer;
+		mJobs[i].Forces   = &forces;
+		mJobs[i].View     = &View;
+		mJobs[i].Begin    = qMin (i * range, length);
+		mJobs[i].End      = qMin (i * range + range, length);
+	}
+
+	// Order the particles back to front
+	const quint32* order = nullptr;
+	if (DepthSort && length > 1)
+	{
+		mDepths.resize (length);
+		for (quint32 i = 0; i < count; ++i)
+			mJobs[i].Keys = mDepths.data();
+
+		if (count > 1)
+			QtConcurrent::blockingMap (mJobs, &SoftwareJob::Depths);
+		else mJobs[0].Depths();
+
+		mSort.Sort (mDepths.constData(), length);
+		order = mSort.GetIndices();
+	}
+
+	// Stream the living particles straight into the mapped buffer
+	VertexParticle* vertices = (VertexParticle*) mStates[0].Map();
+	if (vertices == nullptr) return;
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		mJobs[i].Vertices = vertices;
+		mJobs[i].Order    = order;
+	}
+
+	if (count > 1)
+		QtConcurrent::blockingMap (mJobs, &SoftwareJob::Write);
+	else mJobs[0].Write();
+
+	mStates[0].Unmap();
+}
@@ -0,0 +1,197 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_PARTICLE_SIMULATOR_H
+#define GRAPHICS_PARTICLE_SIMULATOR_H
+
+class Mesh;
+class Texture;
+
+#include <QVector.h>
+#include "Math/Vector3.h"
+#include "Graphics/Color.h"
+#include "Graphics/Vertex.h"
+#include "Graphics/ParticleBuffer.h"
+#include "Math/Matrix.h"
+#include "Math/RadixSort.h"
+#include "Graphics/Shader.h"
+#include "Content/Content.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Simulates stateful particles on the GPU using transform
+/// 		  feedback and draws them with one instanced draw. </summary>
+/// Software simulators advance the particles on the CPU instead
+
+class ParticleSimulator
+{
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class SimulateUniforms
+	{
+	public:
+		// Properties
+		UniformHandle	TimeStep;
+		UniformHandle	Seed;
+
+		UniformHandle	Gravity;
+		UniformHandle	Wind;
+		UniformHandle	Drag;
+		UniformHandle	Ground;
+		UniformHandle	Bounce;
+
+		UniformHandle	Position;
+		UniformHandle	Velocity;
+		UniformHandle	Spread;
+		UniformHandle	MinLife;
+		UniformHandle	MaxLife;
+
+		UniformHandle	Capacity;
+		UniformHandle	SpawnStart;
+		UniformHandle	SpawnCount;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class DrawUniforms
+	{
+	public:
+		// Properties
+		UniformHandle	Size;
+		UniformHandle	FadeInTime;
+		UniformHandle	FadeOutTime;
+
+		UniformHandle	Diffuse;
+		UniformHandle	Alpha;
+		UniformHandle	Shape;
+		UniformHandle	Texture;
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Advances a range of software particles on a worker thread. </summary>
+
+	class SoftwareJob
+	{
+	public:
+		// Methods
+		void Simulate	(void) { Buffer->Simulate (Begin, End, *Forces); }
+		void Depths		(void) { Buffer->Depths (*View, Keys, Begin, End); }
+
+		void Write		(void)
+		{
+			if (Order != nullptr)
+				Buffer->Write (Vertices, Order, Begin, End);
+			else Buffer->Write (Vertices, Begin, End);
+		}
+
+	public:
+		// Properties
+		ParticleBuffer*					Buffer;		// Particles to advance
+		const ParticleBuffer::Forces*	Forces;		// Forces of this step
+		VertexParticle*					Vertices;	// Mapped instance stream
+
+		const Matrix*					View;		// Camera when sorting
+		float*							Keys;		// Depths when sorting
+		const quint32*					Order;		// Sorted particles or null
+		quint32							Begin;		// First particle
+		quint32							End;		// One past the last particle
+	};
+
+public:
+	// Constructors
+	 ParticleSimulator (void);
+	~ParticleSimulator (void);
+
+public:
+	// Methods
+	bool		Load			(quint32 capacity, bool software = false);
+	void		Unload			(void);
+
+	bool		IsLoaded		(void) const { return mStates[0].IsLoaded(); }
+	bool		IsSoftware		(void) const { return mSoftware; }
+
+	void		Update			(quint32 elapsedTime);
+	void		Draw			(void) const;
+
+	Texture*	GetTexture		(void) const { return mTexture;	 }
+	void		SetTexture		(Texture* texture);
+	quint32		GetCapacity		(void) const { return mCapacity; }
+
+public:
+	// Properties
+	Vector3		Position;		// Emitter position
+	Vector3		Velocity;		// Initial particle velocity
+	float		Spread;			// Random velocity added on spawn
+	float		Rate;			// Particles emitted per second
+	float		MinLife;		// Shortest lifetime in seconds
+	float		MaxLife;		// Longest lifetime in seconds
+
+	Vector3		Gravity;		// Constant acceleration
+	Vector3		Wind;			// Velocity particles drift towards
+	float		Drag;			// Rate of drifting towards the wind
+	float		Ground;			// Height of the collision plane
+	float		Bounce;			// Velocity kept after a collision
+
+	Color		Diffuse;
+	float		Alpha;
+	float		Shape;
+	float		Size;
+	float		FadeInTime;		// Fraction of the lifetime
+	float		FadeOutTime;	// Fraction of the lifetime
+
+	bool		DepthSort;		// Sort software particles back to front
+	Matrix		View;			// Camera view used when sorting
+
+private:
+	// Internal
+	void		UpdateHardware	(float step, quint32 spawn);
+	void		UpdateSoftware	(float step, quint32 spawn);
+
+private:
+	// Fields
+	quint32		mCapacity;		// Number of particle slots
+	quint32		mCurrent;		// State buffer holding the latest step
+	quint32		mCursor;		// Next slot of the spawn ring
+	float		mPending;		// Fraction of a particle left to spawn
+	quint32		mStep;			// Simulation steps taken
+	bool		mSoftware;		// Whether simulated on the CPU
+
+	VertexBuffer mStates[2];	// Ping-ponged particle states
+	quint32		mArrays [2];	// Vertex arrays reading each state
+
+	ParticleBuffer			mBuffer;	// Software particle states
+	QVector<SoftwareJob>	mJobs;		// Software simulation ranges
+
+	QVector<float>			mDepths;	// View depth of every particle
+	RadixSort				mSort;		// Back to front particle order
+
+	Mesh*		mQuad;			// Quad drawn for every particle
+	Texture*	mTexture;		// Particle texture
+
+	AssetHandle<Shader>	mSimulate;
+	AssetHandle<Shader>	mDraw;
+
+	SimulateUniforms	mSimulateUniforms;
+	DrawUniforms		mDrawUniforms;
+};
+
+#endif // GRAPHICS_PARTICLE_SIMULATOR_H
@@ -20,10 +20,13 @@
 #include "Graphics/Vertex.h"
 #include "Graphics/Texture.h"
 #include "Graphics/Shader.h"
+#include "Graphics/RenderState.h"
 
 #include "Graphics/ParticleSystem.h"
 ASSET_DEFINITION (ParticleSystem);
 
+#include "Math/Math.h"
+
 #define GLEW_STATIC
 #include <glew.h>
 
@@ -53,8 +56,10 @@ ParticleSystem::ParticleSystem (void) : Asset (AssetID)
 	FadeInTime		= 0.0f;
 	FadeOutTime		= 1.0f;
 
+	DepthSort		= false;
+
 	mQuantity		= 0;
-	mParticles		= nullptr;
+	mQuad			= nullptr;
 
 	mTexture		= nullptr;
 	mParticleSystem	= nullptr;
@@ -80,12 +85,14 @@ ParticleSystem::ParticleSystem (const ParticleSystem& system) : Asset (system)
 	FadeInTime		= system.FadeInTime;
 	FadeOutTime		= system.FadeOutTime;
 
+	DepthSort		= system.DepthSort;
+
 	mParticleSystem	= nullptr;
 
-	if (system.mParticles == nullptr)
+	if (system.mQuad == nullptr)
 	{
 		mQuantity	= 0;
-		mParticles	= nullptr;
+		mQuad		= nullptr;
 	}
 
 	else Create (system.mQuantity);
@@ -104,11 +111,26 @@ ParticleSystem::~ParticleSystem (void)
 	if (mParticleSystem != nullptr)
 		mParticleSystem->Release();
 
-	if (mParticles != nullptr)
-		delete[] mParticles;
+	if (mQuad != nullptr)
+		delete mQuad;
+
+	if (mTexture != nullptr)
+		mTexture->Release();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Releases the shader and texture so they can be deleted first. </summary>
+
+void ParticleSystem::ReleaseDependencies (void)
+{
+	if (mParticleSystem != nullptr)
+		mParticleSystem->Release();
 
 	if (mTexture != nullptr)
 		mTexture->Release();
+
+	mParticleSystem = nullptr;
+	mTexture = nullptr;
 }
 
 
@@ -126,26 +148,47 @@ bool ParticleSystem::Load (void)
 	if (IsLoaded()) return true;
 
 	// Check if we can load
-	if (mParticles == nullptr)
+	if (mQuad == nullptr)
 		return false;
 
 	// Load shader
-	mParticleSystem = (Shader*) Content::Load ("Shaders/ParticleSystem.ast");
+	mParticleSystem = Content::Load<Shader> ("Shaders/ParticleSystem.ast");
 	if (mParticleSystem == nullptr) return false;
 
 	mParticleSystem->Load();
 	mParticleSystem->Purge();
 
-	// Load particles
-	bool status = true;
-
-	for (quint32 i = 0; i < mQuantity; ++i)
-		status &= mParticles[i].Load();
-
-	if (!status)
-		Unload (true);
+	// Look up uniform locations
+	Uniforms& u = mUniforms;
+	Shader* shader = mParticleSystem;
+
+	u.Position		= shader->Handle ("Position");
+	u.Diffuse		= shader->Handle ("Diffuse");
+	u.Alpha			= shader->Handle ("Alpha");
+	u.Speed			= shader->Handle ("Speed");
+	u.Spread		= shader->Handle ("Spread");
+	u.Shape			= shader->Handle ("Shape");
+	u.Size			= shader->Handle ("Size");
+	u.Gravity		= shader->Handle ("Gravity");
+
+	u.SystemHeight	= shader->Handle ("SystemHeight");
+	u.SystemShape	= shader->Handle ("SystemShape");
+	u.FadeInTime	= shader->Handle ("FadeInTime");
+	u.FadeOutTime	= shader->Handle ("FadeOutTime");
+	u.InstanceStep	= shader->Handle ("InstanceStep");
+
+	u.Texture		= shader->Handle ("Texture");
+
+	// Load the shared quad and the instance order
+	if (!mQuad->Load() || !mOrder.Load())
+	{
+		mQuad->Unload();
+		mParticleSystem->Release();
+		mParticleSystem = nullptr;
+		return false;
+	}
 
-	return status;
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -167,10 +210,11 @@ void ParticleSystem::Unload (bool force)
 	// Check for multiple references
 	if (force || mReferences == 1)
 	{
-		for (quint32 i = 0; i < mQuantity; ++i)
-			mParticles[i].Unload();
+		mQuad->Unload();
+		mOrder.Unload();
 
 		mParticleSystem->Release();
+		mParticleSystem = nullptr;
 	}
 }
 
@@ -179,7 +223,7 @@ void ParticleSystem::Unload (bool force)
 
 bool ParticleSystem::IsLoaded (void) const
 {
-	return mParticles == nullptr ? false : mParticles[0].IsLoaded();
+	return mQuad == nullptr ? false : mQuad->IsLoaded();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -190,32 +234,22 @@ bool ParticleSystem::Create (quint16 quantity)
 	// Make sure we have at least one particle
 	if (quantity == 0) return false;
 
-	// Remove previous instances
-	if (mParticles != nullptr)
-		delete[] mParticles;
+	// Remove the previous quad
+	if (mQuad != nullptr)
+		delete mQuad;
 
-	// Create particles
+	// Every particle is an instance of one
+	// quad, varied by its instance index
 	mQuantity = quantity;
-	mParticles = new Mesh[mQuantity];
-	VertexPositionTexture* vertices;
-
-	float z = 0.0f;
-	const float zValue = 1 / (float) mQuantity;
+	mQuad = new Mesh();
+	Mesh::CreateQuad (*mQuad, -1, -1, 1, 1);
 
-	for (quint32 i = 0; i < mQuantity; ++i, z += zValue)
-	{
-		// Create a single reference quad
-		Mesh::CreateQuad (mParticles[i], -1, -1, 1, 1);
+	// Instances draw the particles in order until sorted
+	mOrder.Create (quantity, VertexIndex::ElementCount,
+		VertexIndex::VertexElements, 1, 2);
 
-		vertices = (VertexPositionTexture*)
-			mParticles[i].GetVertices()->GetData();
-
-		// Vary each quad by their z value
-		vertices[0].Position.Z = z;
-		vertices[1].Position.Z = z;
-		vertices[2].Position.Z = z;
-		vertices[3].Position.Z = z;
-	}
+	VertexIndex* order = (VertexIndex*) mOrder.GetData();
+	for (quint16 i = 0; i < quantity; ++i) order[i].Index = i;
 
 	return true;
 }
@@ -243,42 +277,80 @@ void ParticleSystem::SetTexture (Texture* texture)
 	mTexture->Retain();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orders the instances back to front for the given view. </summary>
+/// Particles are placed the same way as the vertex shader places them,
+/// time is in seconds and must match the time of the frame block
+
+void ParticleSystem::Sort (const Matrix& view, float time)
+{
+	if (!DepthSort || !IsLoaded()) return;
+
+	// Compute the view depth of every particle center
+	mDepths.resize (mQuantity);
+	float step = 1.0f / mQuantity;
+
+	for (quint16 i = 0; i < mQuantity; ++i)
+	{
+		float seed = i * step;
+		float t = seed + Speed * time;
+		t -= Math::Floor (t);
+
+		float s = Math::Pow (t, SystemShape);
+		float x = Position.X + Spread * s * Math::Cosr ( 62.0f * seed);
+		float z = Position.Z + Spread * s * Math::Sinr (163.0f * seed);
+		float y = Position.Y + SystemHeight * t * (1 - Gravity);
+
+		mDepths[i] = view.M31 * x + view.M32 * y + view.M33 * z + view.M34;
+	}
+
+	// The camera looks down negative z, farthest first
+	mSort.Sort (mDepths.constData(), mQuantity);
+	const quint32* indices = mSort.GetIndices();
+
+	VertexIndex* order = (VertexIndex*) mOrder.Map();
+	if (order == nullptr) return;
+
+	for (quint16 i = 0; i < mQuantity; ++i)
+		order[i].Index = (float) indices[i];
+
+	mOrder.Unmap();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-void ParticleSystem::Draw (float totalTime, const Matrix& view) const
+void ParticleSystem::Draw (void) const
 {
 	// Check if particles loaded
 	if (!IsLoaded()) return;
 
-	// Update matrices
+	// Make sure the texture is loaded
 	if (mTexture != nullptr && !mTexture->IsLoaded())
 		mTexture->Load();
 
-	// Update shader
-	mParticleSystem->SetValue ("Time", totalTime  / 1000);
-	mParticleSystem->SetValue ("ModelViewProj", Engine::GetPerspective() * view);
-	mParticleSystem->SetValue ("ViewInverse", Matrix::Invert (view));
-
-	mParticleSystem->SetValue ("Position", Position);
-	mParticleSystem->SetValue ("Diffuse", Diffuse);
-	mParticleSystem->SetValue ("Alpha", Alpha);
-	mParticleSystem->SetValue ("Speed", Speed);
-	mParticleSystem->SetValue ("Spread", Spread);
-	mParticleSystem->SetValue ("Shape", Shape);
-	mParticleSystem->SetValue ("Size", Size);
-	mParticleSystem->SetValue ("Gravity", Gravity);
-
-	mParticleSystem->SetValue ("SystemHeight", SystemHeight);
-	mParticleSystem->SetValue ("SystemShape", SystemShape);
-	mParticleSystem->SetValue ("FadeInTime", FadeInTime);
-	mParticleSystem->SetValue ("FadeOutTime", FadeOutTime);
-
-	mParticleSystem->SetValue ("Texture", mTexture, 1);
-
-	// Draw particles
-	GL_CALL (glDepthMask (GL_FALSE));
-	for (quint32 i = 0; i < mQuantity; ++i)
-		mParticles[i].Draw();
-	GL_CALL (glDepthMask (GL_TRUE));
+	// Update shader, time and camera come from the shared blocks
+	const Uniforms& u = mUniforms;
+
+	mParticleSystem->SetValue (u.Position, Position);
+	mParticleSystem->SetValue (u.Diffuse, Diffuse);
+	mParticleSystem->SetValue (u.Alpha, Alpha);
+	mParticleSystem->SetValue (u.Speed, Speed);
+	mParticleSystem->SetValue (u.Spread, Spread);
+	mParticleSystem->SetValue (u.Shape, Shape);
+	mParticleSystem->SetValue (u.Size, Size);
+	mParticleSystem->SetValue (u.Gravity, Gravity);
+
+	mParticleSystem->SetValue (u.SystemHeight, SystemHeight);
+	mParticleSystem->SetValue (u.SystemShape, SystemShape);
+	mParticleSystem->SetValue (u.FadeInTime, FadeInTime);
+	mParticleSystem->SetValue (u.FadeOutTime, FadeOutTime);
+	mParticleSystem->SetValue (u.InstanceStep, 1.0f / mQuantity);
+
+	mParticleSystem->SetValue (u.Texture, mTexture, 1);
+
+	// Draw every particle at once
+	RenderState::SetDepthMask (false);
+	mQuad->DrawInstanced (mQuantity, &mOrder);
+	RenderState::SetDepthMask (true);
 }
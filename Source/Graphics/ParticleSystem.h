@@ -16,13 +16,15 @@
 
 class Mesh;
 class Texture;
-class Shader;
 class Camera;
 class Matrix;
 
 #include "Graphics/Color.h"
 #include "Math/Vector3.h"
+#include "Math/RadixSort.h"
 #include "Content/Asset.h"
+#include "Graphics/Shader.h"
+#include "Graphics/Vertex.h"
 
 
 
@@ -37,6 +39,33 @@ class ParticleSystem : public Asset
 {
 	ASSET_DECLARATION;
 
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Uniforms
+	{
+	public:
+		// Properties
+		UniformHandle	Position;
+		UniformHandle	Diffuse;
+		UniformHandle	Alpha;
+		UniformHandle	Speed;
+		UniformHandle	Spread;
+		UniformHandle	Shape;
+		UniformHandle	Size;
+		UniformHandle	Gravity;
+
+		UniformHandle	SystemHeight;
+		UniformHandle	SystemShape;
+		UniformHandle	FadeInTime;
+		UniformHandle	FadeOutTime;
+		UniformHandle	InstanceStep;
+
+		UniformHandle	Texture;
+	};
+
 public:
 	// Constructors
 	ParticleSystem (void);
@@ -44,6 +73,7 @@ public:
 
 protected:
 	virtual ~ParticleSystem		(void);
+	virtual void ReleaseDependencies (void);
 
 public:
 	// Methods
@@ -58,7 +88,8 @@ public:
 	void		SetTexture		(Texture* texture);
 	quint16		GetQuantity		(void) const { return mQuantity; }
 
-	void		Draw			(float totalTime, const Matrix& view) const;
+	void		Sort			(const Matrix& view, float time);
+	void		Draw			(void) const;
 
 public:
 	// Properties
@@ -77,13 +108,20 @@ public:
 	float		FadeInTime;
 	float		FadeOutTime;
 
+	bool		DepthSort;		// Draw the particles back to front
+
 private:
 	// Fields
 	quint16		mQuantity;
-	Mesh*		mParticles;
+	Mesh*		mQuad;
+
+	VertexBuffer	mOrder;		// Particle of every instance
+	QVector<float>	mDepths;	// View depth of every particle
+	RadixSort		mSort;		// Back to front particle order
 
 	Texture*	mTexture;
 	Shader*		mParticleSystem;
+	Uniforms	mUniforms;
 };
 
 #endif // GRAPHICS_PARTICLE_SYSTEM_H
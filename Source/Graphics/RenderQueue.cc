@@ -0,0 +1,214 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/RenderQueue.h"
+#include "Graphics/Shader.h"
+#include "Graphics/Mesh.h"
+#include "Math/BoundingFrustum.h"
+
+#include <QtAlgorithms.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+// Key layout, from the most significant bit
+//   Opaque      : layer (2) | shader (16) | material (16) | depth   (30)
+//   Transparent : layer (2) | depth  (30) | shader   (16) | material (16)
+//   Overlay     : layer (2) | submission order
+
+static const quint64 DepthMask = (1 << 30) - 1;
+
+// Fewest packets worth culling through the hierarchy, the
+// demo's jungle submits one packet per subset and reaches it
+static const qint32 MinPacketsPerTree = 16;
+
+// Rebuild rather than refit once this fraction of packets moved
+static const float MaxMovedFraction = 0.25f;
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Folds a pointer into a 16-bit state identifier. </summary>
+/// Collisions only merge sort groups, they never break ordering
+
+static inline quint64 StateID (const void* pointer)
+{
+	quintptr value = (quintptr) pointer >> 4;
+	return (value ^ (value >> 16)) & 0xFFFF;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                   RenderQueue //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+RenderQueue::RenderQueue (void)
+{
+	mTreeValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+RenderQueue::~RenderQueue (void)
+{
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                        RenderQueue //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Keeps the allocated storage for the next frame
+
+void RenderQueue::Clear (void)
+{
+	mPackets.resize (0);
+	mItems  .resize (0);
+	mBounds .resize (0);
+	mTreeValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Subsets of merged meshes are submitted as packets of their own
+/// so that they are culled against their own bounds
+
+void RenderQueue::Submit (Layer layer, Shader* shader, const Model* model,
+	const Mesh* mesh, const Material* material, const Matrix& transform, qint32 subset)
+{
+	Packet packet;
+	packet.Bucket		= layer;
+	packet.Program		= shader;
+	packet.Owner		= model;
+	packet.Geometry		= mesh;
+	packet.Part			= subset;
+	packet.Surface		= material;
+	packet.Transform	= transform;
+
+	// Bounds are kept apart so they can be culled in bulk
+	BoundingBox bounds = BoundingBox::Transform (subset < 0 ?
+		mesh->Bounds : mesh->Subsets[subset].Bounds, transform);
+	packet.Center = bounds.GetCenter();
+
+	mPackets.append (packet);
+	mBounds .append (bounds);
+	mTreeValid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Flags which submitted packets intersect the frustum. </summary>
+/// Flags are stored in submission order, large queues are culled through
+/// a hierarchy kept across frames and rebuilt when too many packets move
+
+void RenderQueue::Cull (const BoundingFrustum& frustum, QVector<quint8>& visible)
+{
+	visible.resize (mBounds.size());
+	if (mBounds.isEmpty()) return;
+
+	// Small queues are faster to test directly
+	if (mBounds.size() < MinPacketsPerTree)
+	{
+		frustum.Cull (mBounds.size(), mBounds.constData(), visible.data());
+		return;
+	}
+
+	if (!mTreeValid)
+	{
+		// Packets are resubmitted in the same order every frame, so the
+		// tree is kept and only the packets whose bounds moved are refit
+		bool rebuild = mTree.GetObjectCount() != (quint32) mBounds.size();
+		mMoved.resize (0);
+
+		for (qint32 i = 0; !rebuild && i < mBounds.size(); ++i)
+			if (mBounds[i] != mTreeBounds[i]) mMoved.append (i);
+
+		if (mMoved.size() > mBounds.size() * MaxMovedFraction)
+			rebuild = true;
+
+		if (rebuild)
+			mTree.Build (mBounds.size(), mBounds.constData());
+		else mTree.Refit (mBounds.constData(), mMoved.constData(), mMoved.size());
+
+		mTreeBounds = mBounds;
+		mTreeValid = true;
+	}
+
+	mTree.Query (frustum, mBounds.constData(), mTreeResults);
+
+	memset (visible.data(), 0, visible.size());
+	for (qint32 i = 0; i < mTreeResults.size(); ++i)
+		visible[mTreeResults[i]] = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderQueue::Sort (const Matrix& view, float farClip, const quint8* visible)
+{
+	mItems.resize (0);
+	float scale = DepthMask / farClip;
+
+	for (qint32 i = 0; i < mPackets.size(); ++i)
+	{
+		// Skip culled packets
+		if (visible != nullptr && !visible[i]) continue;
+		const Packet& packet = mPackets[i];
+
+		// Distance in front of the camera
+		const Vector3& c = packet.Center;
+		float distance = -(view.M31 * c.X + view.M32 * c.Y + view.M33 * c.Z + view.M34);
+
+		float scaled = distance * scale;
+		quint64 depth = scaled <= 0 ? 0 : scaled >= DepthMask ? DepthMask : (quint64) scaled;
+
+		quint64 program  = packet.Program == nullptr ? 0 :
+			packet.Program->GetProgramID() & 0xFFFF;
+		quint64 material = StateID (packet.Surface);
+
+		quint64 key = (quint64) packet.Bucket << 62;
+		switch (packet.Bucket)
+		{
+			case OpaqueLayer:
+			case BackgroundLayer:
+				// Minimize state changes, then draw front to back
+				key |= program << 46 | material << 30 | depth;
+				break;
+
+			case TransparentLayer:
+				// Draw back to front
+				key |= (DepthMask - depth) << 32 | program << 16 | material;
+				break;
+
+			case OverlayLayer:
+				key |= (quint64) i;
+				break;
+		}
+
+		Item item;
+		item.Key   = key;
+		item.Index = i;
+		mItems.append (item);
+	}
+
+	qSort (mItems.begin(), mItems.end());
+}
@@ -0,0 +1,127 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_RENDER_QUEUE_H
+#define GRAPHICS_RENDER_QUEUE_H
+
+class Mesh;
+class Model;
+class Shader;
+class Material;
+class BoundingFrustum;
+
+#include "Math/Matrix.h"
+#include "Math/Vector3.h"
+#include "Math/BoundingBox.h"
+#include "Math/BoundingHierarchy.h"
+#include <QVector.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Collects draw packets and orders them by 64-bit sort keys. </summary>
+
+class RenderQueue
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Layers are drawn in order. </summary>
+
+	enum Layer
+	{
+		OpaqueLayer				= 0,	// Front to back by state
+		BackgroundLayer			= 1,	// Drawn behind opaque geometry
+		TransparentLayer		= 2,	// Back to front
+		OverlayLayer			= 3,	// Drawn last in submission order
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Packet
+	{
+	public:
+		// Properties
+		Layer				Bucket;			// Draw layer
+		Shader*				Program;		// Shader program
+		const Model*		Owner;			// Model owning the textures
+		const Mesh*			Geometry;		// Mesh to draw
+		qint32				Part;			// Mesh subset, negative for all of it
+		const Material*		Surface;		// Material of the mesh
+		Matrix				Transform;		// World transformation
+		Vector3				Center;			// World center used for depth
+	};
+
+public:
+	// Constructors
+	 RenderQueue (void);
+	~RenderQueue (void);
+
+public:
+	// Methods
+	void			Clear			(void);
+
+	void			Submit			(Layer layer, Shader* shader, const Model* model,
+									 const Mesh* mesh, const Material* material,
+									 const Matrix& transform, qint32 subset = -1);
+
+	void			Cull			(const BoundingFrustum& frustum, QVector<quint8>& visible);
+	void			Sort			(const Matrix& view, float farClip, const quint8* visible = nullptr);
+
+	quint32			Length			(void) const { return mItems.size(); }
+	bool			IsEmpty			(void) const { return mItems.isEmpty(); }
+
+	quint32			GetPacketCount	(void) const { return mPackets.size(); }
+	const Packet&	GetPacket		(quint32 index) const { return mPackets[index]; }
+	const BoundingBox* GetBounds	(void) const { return mBounds.constData(); }
+
+public:
+	// Operators
+	const Packet&	operator []		(quint32 index) const { return mPackets[mItems[index].Index]; }
+
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Item
+	{
+	public:
+		// Properties
+		quint64		Key;			// Sort key
+		quint32		Index;			// Packet index
+
+		bool operator < (const Item& item) const
+			{ return Key != item.Key ? Key < item.Key : Index < item.Index; }
+	};
+
+private:
+	// Fields
+	QVector<Packet>	mPackets;		// Submitted packets
+	QVector<Item>	mItems;			// Sorted packet order
+
+	QVector<BoundingBox> mBounds;	// World bounds of every packet
+
+	BoundingHierarchy mTree;		// Hierarchy over the packet bounds
+	bool			mTreeValid;		// Whether the tree matches the bounds
+	QVector<BoundingBox> mTreeBounds;	// Bounds the tree was last fit to
+	QVector<quint32> mMoved;		// Packets refit this frame
+	QVector<quint32> mTreeResults;	// Packets found by the last query
+};
+
+#endif // GRAPHICS_RENDER_QUEUE_H
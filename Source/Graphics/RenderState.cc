@@ -0,0 +1,300 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/RenderState.h"
+#include "Engine/Console.h"
+
+#define GLEW_STATIC
+#include <glew.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                         RenderState //
+//----------------------------------------------------------------------------//
+
+quint32 RenderState::mProgram		= 0;
+quint32 RenderState::mVertexArray	= 0;
+quint32 RenderState::mFramebuffer	= 0;
+
+quint8  RenderState::mActiveUnit	= 0;
+quint32 RenderState::mTargets [MaxTextureUnits];
+quint32 RenderState::mTextures[MaxTextureUnits];
+
+qint32  RenderState::mViewport[4];
+
+bool    RenderState::mBlend				= false;
+quint32 RenderState::mBlendSource		= GL_ONE;
+quint32 RenderState::mBlendDestination	= GL_ZERO;
+
+bool    RenderState::mDepthTest		= false;
+bool    RenderState::mDepthMask		= true;
+quint32 RenderState::mDepthFunc		= GL_LESS;
+
+bool    RenderState::mCullFace		= false;
+
+RenderState::Counters RenderState::mCurrent;
+RenderState::Counters RenderState::mPrevious;
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                         RenderState //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Puts OpenGL into its default state so the shadow copy is known
+
+void RenderState::Reset (void)
+{
+	mProgram     = 0;
+	mVertexArray = 0;
+	mFramebuffer = 0;
+
+	GL_CALL (glUseProgram      (0));
+	GL_CALL (glBindVertexArray (0));
+	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, 0));
+
+	// Unbind every texture unit
+	for (quint8 i = 0; i < MaxTextureUnits; ++i)
+	{
+		if (mTextures[i] != 0)
+		{
+			GL_CALL (glActiveTexture (GL_TEXTURE0 + i));
+			GL_CALL (glBindTexture   (mTargets[i], 0));
+		}
+
+		mTargets [i] = GL_TEXTURE_2D;
+		mTextures[i] = 0;
+	}
+
+	mActiveUnit = 0;
+	GL_CALL (glActiveTexture (GL_TEXTURE0));
+
+	// The viewport is unknown until it is set
+	mViewport[0] = mViewport[1] = -1;
+	mViewport[2] = mViewport[3] = -1;
+
+	mBlend            = false;
+	mBlendSource      = GL_ONE;
+	mBlendDestination = GL_ZERO;
+
+	GL_CALL (glDisable   (GL_BLEND));
+	GL_CALL (glBlendFunc (GL_ONE, GL_ZERO));
+
+	mDepthTest = false;
+	mDepthMask = true;
+	mDepthFunc = GL_LESS;
+
+	GL_CALL (glDisable   (GL_DEPTH_TEST));
+	GL_CALL (glDepthMask (GL_TRUE));
+	GL_CALL (glDepthFunc (GL_LESS));
+
+	mCullFace = false;
+	GL_CALL (glDisable (GL_CULL_FACE));
+
+	mCurrent .Issued = mCurrent .Filtered = 0;
+	mPrevious.Issued = mPrevious.Filtered = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::BeginFrame (void)
+{
+	// Keep the counters of the completed frame
+	mPrevious = mCurrent;
+
+	mCurrent.Issued   = 0;
+	mCurrent.Filtered = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::UseProgram (quint32 program)
+{
+	if (Filter (mProgram == program)) return;
+
+	GL_CALL (glUseProgram (program));
+	mProgram = program;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::BindVertexArray (quint32 array)
+{
+	if (Filter (mVertexArray == array)) return;
+
+	GL_CALL (glBindVertexArray (array));
+	mVertexArray = array;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::BindTexture (quint8 unit, quint32 target, quint32 texture)
+{
+	if (Filter (mTextures[unit] == texture &&
+				 mTargets[unit] == target)) return;
+
+	// Select the texture unit
+	if (!Filter (mActiveUnit == unit))
+	{
+		GL_CALL (glActiveTexture (GL_TEXTURE0 + unit));
+		mActiveUnit = unit;
+	}
+
+	GL_CALL (glBindTexture (target, texture));
+	mTargets [unit] = target;
+	mTextures[unit] = texture;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::BindFramebuffer (quint32 framebuffer)
+{
+	if (Filter (mFramebuffer == framebuffer)) return;
+
+	GL_CALL (glBindFramebuffer (GL_FRAMEBUFFER, framebuffer));
+	mFramebuffer = framebuffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetViewport (qint32 x, qint32 y, qint32 width, qint32 height)
+{
+	if (Filter (mViewport[0] == x && mViewport[1] == y &&
+		mViewport[2] == width && mViewport[3] == height)) return;
+
+	GL_CALL (glViewport (x, y, width, height));
+	mViewport[0] = x;		mViewport[1] = y;
+	mViewport[2] = width;	mViewport[3] = height;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetBlend (bool enabled)
+{
+	if (Filter (mBlend == enabled)) return;
+
+	if (enabled)
+		 GL_CALL (glEnable  (GL_BLEND));
+	else GL_CALL (glDisable (GL_BLEND));
+	mBlend = enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetBlendFunc (quint32 source, quint32 destination)
+{
+	if (Filter (mBlendSource == source &&
+		mBlendDestination == destination)) return;
+
+	GL_CALL (glBlendFunc (source, destination));
+	mBlendSource      = source;
+	mBlendDestination = destination;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetDepthTest (bool enabled)
+{
+	if (Filter (mDepthTest == enabled)) return;
+
+	if (enabled)
+		 GL_CALL (glEnable  (GL_DEPTH_TEST));
+	else GL_CALL (glDisable (GL_DEPTH_TEST));
+	mDepthTest = enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetDepthMask (bool enabled)
+{
+	if (Filter (mDepthMask == enabled)) return;
+
+	GL_CALL (glDepthMask (enabled ? GL_TRUE : GL_FALSE));
+	mDepthMask = enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetDepthFunc (quint32 func)
+{
+	if (Filter (mDepthFunc == func)) return;
+
+	GL_CALL (glDepthFunc (func));
+	mDepthFunc = func;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RenderState::SetCullFace (bool enabled)
+{
+	if (Filter (mCullFace == enabled)) return;
+
+	if (enabled)
+		 GL_CALL (glEnable  (GL_CULL_FACE));
+	else GL_CALL (glDisable (GL_CULL_FACE));
+	mCullFace = enabled;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Must be called before deleting a texture, its name may be reused
+
+void RenderState::ForgetTexture (quint32 texture)
+{
+	// Deleted textures revert to zero on every unit
+	for (quint8 i = 0; i < MaxTextureUnits; ++i)
+		if (mTextures[i] == texture) mTextures[i] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Must be called before deleting a framebuffer, its name may be reused
+
+void RenderState::ForgetFramebuffer (quint32 framebuffer)
+{
+	// Deleting the bound framebuffer binds the default one
+	if (mFramebuffer == framebuffer) mFramebuffer = 0;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                       RenderState //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool RenderState::Filter (bool redundant)
+{
+	if (redundant)
+		 ++mCurrent.Filtered;
+	else ++mCurrent.Issued;
+
+	return redundant;
+}
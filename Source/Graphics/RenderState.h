@@ -0,0 +1,112 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_RENDER_STATE_H
+#define GRAPHICS_RENDER_STATE_H
+
+#include <QGlobal.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Shadow copy of the OpenGL state which filters redundant calls. </summary>
+
+class RenderState
+{
+private:
+	// Constructors
+	 RenderState (void) { }
+	 RenderState (const RenderState& state) { }
+	~RenderState (void) { }
+
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Counters
+	{
+	public:
+		// Properties
+		quint32		Issued;			// Calls passed to OpenGL
+		quint32		Filtered;		// Calls which were redundant
+	};
+
+public:
+	// Static
+	static void		Reset			(void);
+	static void		BeginFrame		(void);
+
+	static void		UseProgram		(quint32 program);
+	static void		BindVertexArray	(quint32 array);
+	static void		BindTexture		(quint8 unit, quint32 target, quint32 texture);
+	static void		BindFramebuffer	(quint32 framebuffer);
+
+	static void		SetViewport		(qint32 x, qint32 y, qint32 width, qint32 height);
+
+	static void		SetBlend		(bool enabled);
+	static void		SetBlendFunc	(quint32 source, quint32 destination);
+
+	static void		SetDepthTest	(bool enabled);
+	static void		SetDepthMask	(bool enabled);
+	static void		SetDepthFunc	(quint32 func);
+
+	static void		SetCullFace		(bool enabled);
+
+	static void		ForgetTexture	(quint32 texture);
+	static void		ForgetFramebuffer(quint32 framebuffer);
+
+	static quint32	GetProgram		(void) { return mProgram;		}
+	static quint32	GetFramebuffer	(void) { return mFramebuffer;	}
+
+	static const Counters& GetCounters (void) { return mPrevious; }
+
+public:
+	// Constants
+	static const quint8 MaxTextureUnits = 16;
+
+private:
+	// Internal
+	static bool		Filter			(bool redundant);
+
+private:
+	// Fields
+	static quint32	mProgram;						// Current program
+	static quint32	mVertexArray;					// Current vertex array
+	static quint32	mFramebuffer;					// Current framebuffer
+
+	static quint8	mActiveUnit;					// Active texture unit
+	static quint32	mTargets [MaxTextureUnits];		// Target bound per unit
+	static quint32	mTextures[MaxTextureUnits];		// Texture bound per unit
+
+	static qint32	mViewport[4];					// Viewport rectangle
+
+	static bool		mBlend;							// Blending enabled
+	static quint32	mBlendSource;					// Source blend factor
+	static quint32	mBlendDestination;				// Destination blend factor
+
+	static bool		mDepthTest;						// Depth testing enabled
+	static bool		mDepthMask;						// Depth writes enabled
+	static quint32	mDepthFunc;						// Depth comparison
+
+	static bool		mCullFace;						// Face culling enabled
+
+	static Counters	mCurrent;						// Counters of this frame
+	static Counters	mPrevious;						// Counters of the last frame
+};
+
+#endif // GRAPHICS_RENDER_STATE_H
@@ -17,6 +17,8 @@
 ASSET_DEFINITION (Shader);
 
 #include "Graphics/Color.h"
+#include "Graphics/RenderState.h"
+#include "Graphics/UniformBuffer.h"
 #include "Graphics/Texture.h"
 
 #include "Math/Matrix.h"
@@ -24,6 +26,7 @@ ASSET_DEFINITION (Shader);
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
 #include "Math/Quaternion.h"
+#include <QVector.h>
 
 #define GLEW_STATIC
 #include <glew.h>
@@ -55,6 +58,7 @@ Shader::Shader (const Shader& shader) : Asset (shader)
 
 	Vertex   = shader.Vertex;
 	Fragment = shader.Fragment;
+	Varyings = shader.Varyings;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -79,6 +83,7 @@ void Shader::Create (void)
 	// Purge shader data
 	Vertex  .clear();
 	Fragment.clear();
+	Varyings.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -128,6 +133,18 @@ bool Shader::Load (void)
 	// Link the shaders
 	GL_CALL (glAttachShader (mProgramID, mVertexID  ));
 	GL_CALL (glAttachShader (mProgramID, mFragmentID));
+
+	// Capture varyings into one interleaved buffer
+	if (!Varyings.isEmpty())
+	{
+		QVector<const char*> names (Varyings.size());
+		for (qint32 i = 0; i < Varyings.size(); ++i)
+			names[i] = Varyings[i].constData();
+
+		GL_CALL (glTransformFeedbackVaryings (mProgramID,
+			names.size(), names.constData(), GL_INTERLEAVED_ATTRIBS));
+	}
+
 	GL_CALL (glLinkProgram  (mProgramID));
 
 	// Check link status
@@ -139,6 +156,16 @@ bool Shader::Load (void)
 		Unload(); return false;
 	}
 
+	// Cache uniform locations
+	ReflectUniforms();
+
+	// Attach the shared uniform blocks
+	SetBlock ("Bones",    UniformBuffer::BoneBinding    );
+	SetBlock ("Frame",    UniformBuffer::FrameBinding   );
+	SetBlock ("Camera",   UniformBuffer::CameraBinding  );
+	SetBlock ("Lights",   UniformBuffer::LightBinding   );
+	SetBlock ("Material", UniformBuffer::MaterialBinding);
+
 	// Check for any additional errors
 	GL_CHECK (Unload (true); return false);
 
@@ -166,7 +193,7 @@ void Shader::Unload (bool force)
 	if (mProgramID == 0) return;
 
 	// Delete the shader objects
-	GL_CALL (glUseProgram   (0));
+	RenderState::UseProgram (0);
 	GL_CALL (glDetachShader (mProgramID, mVertexID  ));
 	GL_CALL (glDetachShader (mProgramID, mFragmentID));
 
@@ -177,6 +204,8 @@ void Shader::Unload (bool force)
 	mVertexID   = 0;
 	mFragmentID = 0;
 	mProgramID  = 0;
+
+	mUniforms.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -214,11 +243,16 @@ bool Shader::IsPurged (void) const
 
 void Shader::Use (void) const
 {
-	GLint current;
-	GL_CALL (glGetIntegerv (GL_CURRENT_PROGRAM, &current));
+	RenderState::UseProgram (mProgramID);
+}
 
-	if (current != mProgramID)
-		GL_CALL (glUseProgram (mProgramID));
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Handles should be looked up once and reused for every draw
+
+UniformHandle Shader::Handle (const QString& name) const
+{
+	return UniformHandle (mUniforms.value (name.toAscii(), -1));
 }
 
 
@@ -232,8 +266,7 @@ void Shader::Use (void) const
 
 void Shader::SetValue (const QString& name, bool value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform1i (glGetUniformLocation (mProgramID, name.toAscii().data()), value ? 1 : 0));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -241,8 +274,7 @@ void Shader::SetValue (const QString& name, bool value)
 
 void Shader::SetValue (const QString& name, float value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform1f (glGetUniformLocation (mProgramID, name.toAscii().data()), value));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -250,8 +282,7 @@ void Shader::SetValue (const QString& name, float value)
 
 void Shader::SetValue (const QString& name, qint32 value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform1i (glGetUniformLocation (mProgramID, name.toAscii().data()), value));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -259,8 +290,7 @@ void Shader::SetValue (const QString& name, qint32 value)
 
 void Shader::SetValue (const QString& name, quint32 value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform1ui (glGetUniformLocation (mProgramID, name.toAscii().data()), value));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -268,9 +298,7 @@ void Shader::SetValue (const QString& name, quint32 value)
 
 void Shader::SetValue (const QString& name, const Matrix& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniformMatrix4fv (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), 1, GL_TRUE, (GLfloat*) &value));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -278,9 +306,7 @@ void Shader::SetValue (const QString& name, const Matrix& value)
 
 void Shader::SetValue (const QString& name, const Vector2& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform2f (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), value.X, value.Y));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -288,9 +314,7 @@ void Shader::SetValue (const QString& name, const Vector2& value)
 
 void Shader::SetValue (const QString& name, const Vector3& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform3f (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), value.X, value.Y, value.Z));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -298,9 +322,7 @@ void Shader::SetValue (const QString& name, const Vector3& value)
 
 void Shader::SetValue (const QString& name, const Vector4& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform4f (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), value.X, value.Y, value.Z, value.W));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -308,9 +330,7 @@ void Shader::SetValue (const QString& name, const Vector4& value)
 
 void Shader::SetValue (const QString& name, const Quaternion& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform4f (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), value.X, value.Y, value.Z, value.W));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -318,28 +338,207 @@ void Shader::SetValue (const QString& name, const Quaternion& value)
 
 void Shader::SetValue (const QString& name, const Color& value)
 {
-	if (mProgramID == 0) return; Use();
-	GL_CALL (glUniform4f (glGetUniformLocation (mProgramID,
-		name.toAscii().data()), value.R, value.G, value.B, value.A));
+	SetValue (Handle (name), value);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
 void Shader::SetValue (const QString& name, const Texture* value, quint8 index)
+{
+	SetValue (Handle (name), value, index);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (const QString& name, const float* values, quint32 count)
+{
+	SetValue (Handle (name), values, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, bool value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform1i (handle.Location, value ? 1 : 0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, float value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform1f (handle.Location, value));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, qint32 value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform1i (handle.Location, value));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, quint32 value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform1ui (handle.Location, value));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Matrix& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniformMatrix4fv (handle.Location, 1, GL_TRUE, (GLfloat*) &value));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Vector2& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform2f (handle.Location, value.X, value.Y));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Vector3& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform3f (handle.Location, value.X, value.Y, value.Z));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Vector4& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform4f (handle.Location, value.X, value.Y, value.Z, value.W));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Quaternion& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform4f (handle.Location, value.X, value.Y, value.Z, value.W));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Color& value)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform4f (handle.Location, value.R, value.G, value.B, value.A));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::SetValue (UniformHandle handle, const Texture* value, quint8 index)
 {
 	if (mProgramID == 0) return; Use();
 
 	if (value == nullptr)
 	{
-		GL_CALL (glUniform1i (glGetUniformLocation (mProgramID, name.toAscii().data()), 0));
+		GL_CALL (glUniform1i (handle.Location, 0));
 	}
 
 	else
 	{
-		GL_CALL (glActiveTexture (GL_TEXTURE0 + index));
+		RenderState::BindTexture (index, GL_TEXTURE_2D, value->GetTexID());
+		GL_CALL (glUniform1i (handle.Location, index));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sets a float array uniform. </summary>
 
-		GL_CALL (glBindTexture (GL_TEXTURE_2D, value->GetTexID()));
-		GL_CALL (glUniform1i   (glGetUniformLocation (mProgramID, name.toAscii().data()), index));
+void Shader::SetValue (UniformHandle handle, const float* values, quint32 count)
+{
+	if (mProgramID == 0) return; Use();
+	GL_CALL (glUniform1fv (handle.Location, count, values));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Connects a uniform block to a uniform buffer binding point
+
+void Shader::SetBlock (const QString& name, quint32 binding)
+{
+	if (mProgramID == 0) return;
+
+	GLuint index;
+	GL_CALL (index = glGetUniformBlockIndex (mProgramID, name.toAscii().data()));
+
+	if (index != GL_INVALID_INDEX)
+		GL_CALL (glUniformBlockBinding (mProgramID, index, binding));
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                            Shader //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Shader::ReflectUniforms (void)
+{
+	mUniforms.clear();
+
+	// Get the number of active uniforms
+	GLint count, maxLength;
+	GL_CALL (glGetProgramiv (mProgramID, GL_ACTIVE_UNIFORMS, &count));
+	GL_CALL (glGetProgramiv (mProgramID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+
+	QByteArray buffer (maxLength + 1, 0);
+	for (GLint i = 0; i < count; ++i)
+	{
+		GLint size; GLenum type; GLsizei length;
+		GL_CALL (glGetActiveUniform (mProgramID, i,
+			buffer.size(), &length, &size, &type, buffer.data()));
+
+		QByteArray name (buffer.constData(), length);
+
+		// Uniforms inside blocks have no location
+		GLint location;
+		GL_CALL (location = glGetUniformLocation (mProgramID, name.constData()));
+		if (location < 0) continue;
+
+		// Arrays are reported by their first element
+		if (!name.endsWith ("[0]"))
+		{
+			mUniforms.insert (name, location);
+			continue;
+		}
+
+		name.chop (3);
+		mUniforms.insert (name, location);
+
+		// Elements are not guaranteed to be contiguous
+		for (GLint e = 0; e < size; ++e)
+		{
+			QByteArray element = name + "[" + QByteArray::number (e) + "]";
+
+			GL_CALL (location = glGetUniformLocation (mProgramID, element.constData()));
+			if (location >= 0) mUniforms.insert (element, location);
+		}
 	}
 }
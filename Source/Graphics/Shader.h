@@ -23,6 +23,8 @@ class Quaternion;
 class Texture;
 
 #include "Content/Asset.h"
+#include <QHash.h>
+#include <QList.h>
 
 
 
@@ -30,6 +32,24 @@ class Texture;
 // Classes                                                                    //
 //----------------------------------------------------------------------------//
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Location of a uniform, valid until the shader is reloaded. </summary>
+
+class UniformHandle
+{
+public:
+	// Constructors
+	explicit UniformHandle (qint32 location = -1) : Location (location) { }
+
+public:
+	// Methods
+	bool		IsValid			(void) const { return Location >= 0; }
+
+public:
+	// Properties
+	qint32		Location;		// OpenGL uniform location
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
@@ -64,6 +84,8 @@ public:
 	quint32		GetFragmentID	(void) const { return mFragmentID;	}
 	quint32		GetProgramID	(void) const { return mProgramID;	}
 
+	UniformHandle Handle		(const QString& name) const;
+
 public:
 	// Accessors
 	void		SetValue		(const QString& name, bool				value);
@@ -79,17 +101,45 @@ public:
 
 	void		SetValue		(const QString& name, const Color&		value);
 	void		SetValue		(const QString& name, const Texture*	value, quint8 index);
+	void		SetValue		(const QString& name, const float*		values, quint32 count);
+
+	void		SetValue		(UniformHandle handle, bool					value);
+	void		SetValue		(UniformHandle handle, float				value);
+	void		SetValue		(UniformHandle handle, qint32				value);
+	void		SetValue		(UniformHandle handle, quint32				value);
+
+	void		SetValue		(UniformHandle handle, const Matrix&		value);
+	void		SetValue		(UniformHandle handle, const Vector2&		value);
+	void		SetValue		(UniformHandle handle, const Vector3&		value);
+	void		SetValue		(UniformHandle handle, const Vector4&		value);
+	void		SetValue		(UniformHandle handle, const Quaternion&	value);
+
+	void		SetValue		(UniformHandle handle, const Color&			value);
+	void		SetValue		(UniformHandle handle, const Texture*		value, quint8 index);
+	void		SetValue		(UniformHandle handle, const float*			values, quint32 count);
+
+	void		SetBlock		(const QString& name, quint32 binding);
 
 public:
 	// Properties
 	QByteArray	Vertex;			// Vertex   shader source
 	QByteArray	Fragment;		// Fragment shader source
 
+	// Vertex outputs captured by transform feedback
+	QList<QByteArray> Varyings;		// Stored with the asset
+
+private:
+	// Internal
+	void		ReflectUniforms	(void);
+
 private:
 	// Fields
 	quint32		mVertexID;		// OpenGL vertex ID
 	quint32		mFragmentID;	// OpenGL fragment ID
 	quint32		mProgramID;		// OpenGL program ID
+
+	// Active uniform locations by name
+	QHash<QByteArray, qint32> mUniforms;
 };
 
 #endif // GRAPHICS_SHADER_H
@@ -0,0 +1,60 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/Skeleton.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                           Skeleton //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+qint32 Skeleton::FindBone (const QString& name) const
+{
+	for (qint32 i = 0; i < Bones.length(); ++i)
+		if (Bones[i].Name == name) return i;
+
+	return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Parents always precede their children so a single pass is enough
+
+void Skeleton::ComputeGlobals (const Matrix* locals, Matrix* globals) const
+{
+	for (qint32 i = 0; i < Bones.length(); ++i)
+	{
+		qint32 parent = Bones[i].Parent;
+
+		if (parent < 0)
+			 globals[i] = locals[i];
+		else globals[i] = globals[parent] * locals[i];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void Skeleton::ComputePalette (const Matrix* locals, Matrix* palette) const
+{
+	// Compute the global bone transforms
+	ComputeGlobals (locals, palette);
+
+	// Move vertices into bone space first
+	for (qint32 i = 0; i < Bones.length(); ++i)
+		palette[i] = palette[i] * Bones[i].BindInverse;
+}
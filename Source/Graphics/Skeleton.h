@@ -0,0 +1,68 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_SKELETON_H
+#define GRAPHICS_SKELETON_H
+
+#include "Math/Matrix.h"
+
+#include <QList.h>
+#include <QString.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+class Skeleton
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Bone
+	{
+	public:
+		// Properties
+		QString		Name;			// Name of the source node
+		qint32		Parent;			// Parent bone or -1 for roots
+		Matrix		Transform;		// Local bind pose transform
+		Matrix		BindInverse;	// Inverse of the global bind pose
+	};
+
+public:
+	// Constructors
+	Skeleton (void) { }
+
+public:
+	// Methods
+	qint32			FindBone		(const QString& name) const;
+
+	void			ComputeGlobals	(const Matrix* locals, Matrix* globals) const;
+	void			ComputePalette	(const Matrix* locals, Matrix* palette) const;
+
+public:
+	// Static
+	static const quint32 MaxBones = 64;
+
+public:
+	// Properties
+	QList<Bone>		Bones;			// Bones ordered parents first
+};
+
+#endif // GRAPHICS_SKELETON_H
@@ -0,0 +1,378 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Graphics/SkinBuffer.h"
+#include "Graphics/Mesh.h"
+#include "Graphics/Vertex.h"
+
+#include "Math/Matrix.h"
+#include "Math/Random.h"
+#include "Engine/Console.h"
+
+#include <QVector.h>
+#include <QElapsedTimer.h>
+#include <xmmintrin.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static const VertexElement* FindElement
+	(const VertexDeclaration* declaration, quint32 type)
+{
+	const VertexElement* elements = declaration->GetElements();
+	for (quint8 i = 0; i < declaration->GetElementCount(); ++i)
+		if (elements[i].ElementType == type) return &elements[i];
+
+	return nullptr;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                    SkinBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SkinBuffer::SkinBuffer (void)
+{
+	mVertexCount = 0;
+	mPaddedCount = 0;
+	mData = nullptr;
+
+	mPositionOffset =  0;
+	mNormalOffset   = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SkinBuffer::~SkinBuffer (void)
+{
+	Destroy();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                         SkinBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Fails when any influence references a bone outside of the skeleton
+
+bool SkinBuffer::Create (const Mesh* mesh, quint32 boneCount)
+{
+	Destroy();
+
+	// Check if the data has been purged
+	VertexBuffer* vertices = mesh->GetVertices();
+	if (vertices->IsPurged()) return false;
+
+	// Skinning gathers palette entries without checks
+	if (!Validate (mesh, boneCount)) return false;
+
+	// Find the skinning vertex elements
+	const VertexDeclaration* declaration = vertices->GetVertexDeclaration();
+	const VertexElement* position = FindElement (declaration, VertexElement::PositionType    );
+	const VertexElement* normal   = FindElement (declaration, VertexElement::NormalType      );
+	const VertexElement* indices  = FindElement (declaration, VertexElement::BlendIndicesType);
+	const VertexElement* weights  = FindElement (declaration, VertexElement::BlendWeightType );
+
+	if (position == nullptr || indices == nullptr || weights == nullptr)
+	{
+		Console::Error ("Mesh has no skinning information");
+		return false;
+	}
+
+	mVertexCount = vertices->GetVertexCount();
+	mPaddedCount = (mVertexCount + 3) & ~3;
+
+	mPositionOffset = position->Offset;
+	mNormalOffset   = normal != nullptr ? normal->Offset : -1;
+
+	// Allocate every stream in one block, 16 byte aligned
+	const quint32 streams = 3 + 3 + Influences * 2 + 3 + 3;
+	mData = (float*) qMallocAligned (streams * mPaddedCount * sizeof (float), 16);
+	memset (mData, 0, streams * mPaddedCount * sizeof (float));
+
+	float* stream = mData;
+	for (quint32 i = 0; i < 3; ++i, stream += mPaddedCount) mPositions		 [i] = stream;
+	for (quint32 i = 0; i < 3; ++i, stream += mPaddedCount) mNormals		 [i] = stream;
+	for (quint32 i = 0; i < 3; ++i, stream += mPaddedCount) mResultPositions [i] = stream;
+	for (quint32 i = 0; i < 3; ++i, stream += mPaddedCount) mResultNormals	 [i] = stream;
+
+	for (quint32 i = 0; i < Influences; ++i, stream += mPaddedCount) mWeights[i] = stream;
+	for (quint32 i = 0; i < Influences; ++i, stream += mPaddedCount) mIndices[i] = (qint32*) stream;
+
+	// Split the interleaved vertices into streams
+	const quint8* data = vertices->GetData();
+	const quint16 size = declaration->GetVertexSize();
+
+	for (quint32 i = 0; i < mVertexCount; ++i, data += size)
+	{
+		const float* p = (const float*) (data + position->Offset);
+		const float* w = (const float*) (data + weights ->Offset);
+		const float* b = (const float*) (data + indices ->Offset);
+
+		mPositions[0][i] = p[0];
+		mPositions[1][i] = p[1];
+		mPositions[2][i] = p[2];
+
+		if (normal != nullptr)
+		{
+			const float* n = (const float*) (data + normal->Offset);
+			mNormals[0][i] = n[0];
+			mNormals[1][i] = n[1];
+			mNormals[2][i] = n[2];
+		}
+
+		for (quint32 j = 0; j < Influences; ++j)
+		{
+			mWeights[j][i] = w[j];
+			mIndices[j][i] = (qint32) b[j];
+		}
+	}
+
+	// Padding vertices have zero weights and reference bone zero
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void SkinBuffer::Destroy (void)
+{
+	if (mData != nullptr)
+		qFreeAligned (mData);
+
+	mData = nullptr;
+	mVertexCount = 0;
+	mPaddedCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Blends the top three rows of each influence and transforms four vertices at once
+
+void SkinBuffer::Skin (const Matrix* palette)
+{
+	for (quint32 i = 0; i < mPaddedCount; i += 4)
+	{
+		// Blended matrix rows, one lane per vertex
+		__m128 m[12];
+		for (quint32 j = 0; j < 12; ++j)
+			m[j] = _mm_setzero_ps();
+
+		for (quint32 k = 0; k < Influences; ++k)
+		{
+			__m128 weight = _mm_load_ps (mWeights[k] + i);
+
+			// Gather the bone matrix of each lane
+			const float* a = &palette[mIndices[k][i + 0]].M11;
+			const float* b = &palette[mIndices[k][i + 1]].M11;
+			const float* c = &palette[mIndices[k][i + 2]].M11;
+			const float* d = &palette[mIndices[k][i + 3]].M11;
+
+			for (quint32 j = 0; j < 12; ++j)
+				m[j] = _mm_add_ps (m[j], _mm_mul_ps (weight,
+					_mm_set_ps (d[j], c[j], b[j], a[j])));
+		}
+
+		// Transform the positions
+		__m128 x = _mm_load_ps (mPositions[0] + i);
+		__m128 y = _mm_load_ps (mPositions[1] + i);
+		__m128 z = _mm_load_ps (mPositions[2] + i);
+
+		for (quint32 r = 0; r < 3; ++r)
+		{
+			__m128 result = _mm_add_ps (
+				_mm_add_ps (_mm_mul_ps (m[r * 4 + 0], x), _mm_mul_ps (m[r * 4 + 1], y)),
+				_mm_add_ps (_mm_mul_ps (m[r * 4 + 2], z), m[r * 4 + 3]));
+
+			_mm_store_ps (mResultPositions[r] + i, result);
+		}
+
+		// Rotate the normals
+		x = _mm_load_ps (mNormals[0] + i);
+		y = _mm_load_ps (mNormals[1] + i);
+		z = _mm_load_ps (mNormals[2] + i);
+
+		for (quint32 r = 0; r < 3; ++r)
+		{
+			__m128 result = _mm_add_ps (_mm_add_ps (_mm_mul_ps
+				(m[r * 4 + 0], x), _mm_mul_ps (m[r * 4 + 1], y)),
+				_mm_mul_ps (m[r * 4 + 2], z));
+
+			_mm_store_ps (mResultNormals[r] + i, result);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Mesh should be a copy of the mesh used to create this buffer
+
+void SkinBuffer::Write (Mesh* mesh) const
+{
+	VertexBuffer* vertices = mesh->GetVertices();
+	if (vertices->IsPurged() || vertices->GetVertexCount() != mVertexCount) return;
+
+	quint8* data = vertices->GetData();
+	const quint16 size = vertices->GetVertexDeclaration()->GetVertexSize();
+
+	// Interleave the skinned streams back into the vertex data
+	for (quint32 i = 0; i < mVertexCount; ++i, data += size)
+	{
+		float* p = (float*) (data + mPositionOffset);
+		p[0] = mResultPositions[0][i];
+		p[1] = mResultPositions[1][i];
+		p[2] = mResultPositions[2][i];
+
+		if (mNormalOffset >= 0)
+		{
+			float* n = (float*) (data + mNormalOffset);
+			n[0] = mResultNormals[0][i];
+			n[1] = mResultNormals[1][i];
+			n[2] = mResultNormals[2][i];
+		}
+	}
+}
+
+
+//----------------------------------------------------------------------------//
+// Static                                                          SkinBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks that every influence references an existing bone. </summary>
+/// Meshes without bone indices are always valid
+
+bool SkinBuffer::Validate (const Mesh* mesh, quint32 boneCount)
+{
+	const VertexBuffer* vertices = mesh->GetVertices();
+	const VertexDeclaration* declaration = vertices->GetVertexDeclaration();
+	if (declaration == nullptr) return true;
+
+	const VertexElement* indices = FindElement (declaration, VertexElement::BlendIndicesType);
+	if (indices == nullptr) return true;
+
+	if (vertices->IsPurged())
+	{
+		Console::Error ("Skinned mesh data has been purged");
+		return false;
+	}
+
+	const quint8* data = vertices->GetData() + indices->Offset;
+	const quint16 size = declaration->GetVertexSize();
+
+	for (quint32 i = 0; i < vertices->GetVertexCount(); ++i, data += size)
+	{
+		const float* b = (const float*) data;
+		for (quint32 j = 0; j < Influences; ++j)
+		{
+			// Indices are stored as floats and must be whole
+			if (!(b[j] >= 0 && b[j] < boneCount) || b[j] != (qint32) b[j])
+			{
+				Console::Error ("Vertex %u references bone %g of %u", i, b[j], boneCount);
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Times skinning meshes of increasing size, no GL context is required. </summary>
+
+void SkinBuffer::Benchmark (void)
+{
+	Random random;
+	QElapsedTimer timer;
+
+	Console::Message ("\nSkinning benchmark");
+	Console::Message ("------------------");
+
+	// Every bone turns and moves a little
+	const quint32 boneCount = 64;
+	QVector<Matrix> palette (boneCount);
+
+	for (quint32 i = 0; i < boneCount; ++i)
+	{
+		palette[i] = Matrix::CreateTranslation (random.NextReal(),
+			random.NextReal(), random.NextReal()) *
+			Matrix::CreateRotationY (random.NextReal());
+	}
+
+	for (quint32 count = 1024; count <= 256 * 1024; count *= 4)
+	{
+		Mesh mesh;
+		mesh.Create (count, VertexPositionNormalTextureSkin::ElementCount,
+			VertexPositionNormalTextureSkin::VertexElements, 3, 4);
+
+		// Random positions with four normalized influences
+		VertexPositionNormalTextureSkin* vertices =
+			(VertexPositionNormalTextureSkin*) mesh.GetVertices()->GetData();
+
+		for (quint32 i = 0; i < count; ++i)
+		{
+			VertexPositionNormalTextureSkin& v = vertices[i];
+			v.Position = Vector4 (random.NextReal(), random.NextReal(), random.NextReal(), 1);
+			v.Normal   = Vector3 (0, 1, 0);
+			v.Texture  = Vector2 (0, 0);
+
+			float w[Influences], total = 0;
+			for (quint32 j = 0; j < Influences; ++j)
+				total += w[j] = random.NextReal() + 0.01f;
+
+			v.BlendIndices = Vector4 ((float) random.NextInt (boneCount), (float) random.NextInt (boneCount),
+									  (float) random.NextInt (boneCount), (float) random.NextInt (boneCount));
+			v.BlendWeights = Vector4 (w[0] / total, w[1] / total, w[2] / total, w[3] / total);
+		}
+
+		SkinBuffer skin;
+		if (!skin.Create (&mesh, boneCount)) return;
+
+		// Take the best of several runs
+		qint64 best = -1, write = -1;
+		for (quint32 run = 0; run < 5; ++run)
+		{
+			timer.start();
+			skin.Skin (palette.constData());
+			qint64 elapsed = timer.nsecsElapsed();
+
+			if (best < 0 || elapsed < best)
+				best = elapsed;
+
+			timer.start();
+			skin.Write (&mesh);
+			elapsed = timer.nsecsElapsed();
+
+			if (write < 0 || elapsed < write)
+				write = elapsed;
+		}
+
+		Console::Message ("%8u vertices: skin %8.3f ms, write %8.3f ms",
+			count, best / 1000000.0, write / 1000000.0);
+	}
+}
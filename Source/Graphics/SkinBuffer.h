@@ -0,0 +1,74 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_SKIN_BUFFER_H
+#define GRAPHICS_SKIN_BUFFER_H
+
+class Mesh;
+class Matrix;
+
+#include <QGlobal.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Structure of arrays copy of a skinned mesh, skinned four vertices at a time
+
+class SkinBuffer
+{
+public:
+	// Constructors
+	 SkinBuffer (void);
+	~SkinBuffer (void);
+
+public:
+	// Methods
+	bool		Create			(const Mesh* mesh, quint32 boneCount);
+	void		Destroy			(void);
+
+	void		Skin			(const Matrix* palette);
+	void		Write			(Mesh* mesh) const;
+
+	quint32		GetVertexCount	(void) const { return mVertexCount; }
+
+public:
+	// Static
+	static bool	Validate		(const Mesh* mesh, quint32 boneCount);
+	static void	Benchmark		(void);
+
+	static const quint32 Influences = 4;
+
+private:
+	// Fields
+	quint32		mVertexCount;				// Number of vertices
+	quint32		mPaddedCount;				// Vertices rounded up to four
+
+	float*		mData;						// Single aligned allocation
+
+	float*		mPositions	[3];			// Bind pose positions
+	float*		mNormals	[3];			// Bind pose normals
+	float*		mWeights	[Influences];	// Bone weights
+	qint32*		mIndices	[Influences];	// Bone indices
+
+	float*		mResultPositions[3];		// Skinned positions
+	float*		mResultNormals	[3];		// Skinned normals
+
+	quint16		mPositionOffset;			// Vertex position offset
+	qint32		mNormalOffset;				// Vertex normal offset or -1
+};
+
+#endif // GRAPHICS_SKIN_BUFFER_H
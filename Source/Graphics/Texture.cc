@@ -15,6 +15,7 @@
 
 #include "Graphics/Color.h"
 #include "Graphics/Texture.h"
+#include "Graphics/RenderState.h"
 ASSET_DEFINITION (Texture);
 
 #define GLEW_STATIC
@@ -169,7 +170,7 @@ bool Texture::Load (void)
 
 	// Create a texture object
 	GL_CALL (glGenTextures (1, &mTexID));
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, mTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, mTexID);
 
 	// Define texture filtering modes
 	GL_CALL (glTexParameterf (GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
@@ -184,7 +185,7 @@ bool Texture::Load (void)
 		mHeight, 0, format, GL_UNSIGNED_BYTE, mData));
 
 	// Unbind the texture object
-	GL_CALL (glBindTexture (GL_TEXTURE_2D, 0));
+	RenderState::BindTexture (0, GL_TEXTURE_2D, 0);
 
 	// Check for any OpenGL errors
 	GL_CHECK (Unload (true); return false);
@@ -213,7 +214,7 @@ void Texture::Unload (bool force)
 	if (force || mReferences == 1)
 	{
 		// Delete the texture object
-		GL_CALL (glBindTexture (GL_TEXTURE_2D, 0));
+		RenderState::ForgetTexture (mTexID);
 		GL_CALL (glDeleteTextures (1, &mTexID));
 		mTexID = 0;
 	}
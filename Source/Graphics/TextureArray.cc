@@ -0,0 +1,143 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/TextureArray.h"
+#include "Graphics/Texture.h"
+#include "Graphics/RenderState.h"
+
+#include "Engine/Console.h"
+
+#define GLEW_STATIC
+#include <glew.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                  TextureArray //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+TextureArray::TextureArray (void)
+{
+	mTexID  = 0;
+	mWidth  = 0;
+	mHeight = 0;
+	mDepth  = 0;
+	mLayers = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+TextureArray::~TextureArray (void)
+{
+	Unload();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                       TextureArray //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Uploads the pixel data of every texture as one layer. </summary>
+/// The textures must share a size and depth and must not be purged
+
+bool TextureArray::Load (const QVector<const Texture*>& layers)
+{
+	// Check if already loaded
+	if (IsLoaded()) return true;
+	if (layers.isEmpty()) return false;
+
+	quint16 width  = layers[0]->GetWidth ();
+	quint16 height = layers[0]->GetHeight();
+	quint8  depth  = layers[0]->GetDepth ();
+
+	// Validate every layer
+	for (qint32 i = 0; i < layers.size(); ++i)
+	{
+		const Texture* layer = layers[i];
+
+		if (layer->IsPurged())
+		{
+			Console::Error ("Unable to pack purged texture layer %d", i);
+			return false;
+		}
+
+		if (layer->GetWidth () != width  ||
+			layer->GetHeight() != height ||
+			layer->GetDepth () != depth)
+		{
+			Console::Error ("Texture layer %d does not match the array format", i);
+			return false;
+		}
+	}
+
+	// Create a texture array object
+	GL_CALL (glGenTextures (1, &mTexID));
+	RenderState::BindTexture (0, GL_TEXTURE_2D_ARRAY, mTexID);
+
+	// Define texture filtering modes
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT));
+	GL_CALL (glTexParameterf (GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT));
+
+	// Allocate storage and copy every layer
+	quint32 format = (depth == 32) ? GL_RGBA : GL_RGB;
+	GL_CALL (glTexImage3D (GL_TEXTURE_2D_ARRAY, 0, format, width,
+		height, layers.size(), 0, format, GL_UNSIGNED_BYTE, nullptr));
+
+	for (qint32 i = 0; i < layers.size(); ++i)
+	{
+		GL_CALL (glTexSubImage3D (GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width,
+			height, 1, format, GL_UNSIGNED_BYTE, layers[i]->GetData()));
+	}
+
+	// Unbind the texture object
+	RenderState::BindTexture (0, GL_TEXTURE_2D_ARRAY, 0);
+
+	mWidth  = width;
+	mHeight = height;
+	mDepth  = depth;
+	mLayers = layers.size();
+
+	// Check for any OpenGL errors
+	GL_CHECK (Unload(); return false);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void TextureArray::Unload (void)
+{
+	// Check if already unloaded
+	if (!IsLoaded()) return;
+
+	// Delete the texture object
+	RenderState::ForgetTexture (mTexID);
+	GL_CALL (glDeleteTextures (1, &mTexID));
+
+	mTexID  = 0;
+	mWidth  = 0;
+	mHeight = 0;
+	mDepth  = 0;
+	mLayers = 0;
+}
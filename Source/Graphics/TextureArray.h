@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_TEXTURE_ARRAY_H
+#define GRAPHICS_TEXTURE_ARRAY_H
+
+class Texture;
+
+#include <QGlobal.h>
+#include <QVector.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Stores same-sized textures as layers of one array texture. </summary>
+
+class TextureArray
+{
+public:
+	// Constructors
+	 TextureArray (void);
+	~TextureArray (void);
+
+public:
+	// Methods
+	bool		Load			(const QVector<const Texture*>& layers);
+	void		Unload			(void);
+
+	bool		IsLoaded		(void) const { return mTexID != 0;	}
+
+	quint32		GetTexID		(void) const { return mTexID;		}
+	quint16		GetWidth		(void) const { return mWidth;		}
+	quint16		GetHeight		(void) const { return mHeight;		}
+	quint8		GetDepth		(void) const { return mDepth;		}
+	quint16		GetLayers		(void) const { return mLayers;		}
+
+private:
+	// Fields
+	quint32		mTexID;			// OpenGL texture ID
+
+	quint16		mWidth;			// Width of every layer
+	quint16		mHeight;		// Height of every layer
+	quint8		mDepth;			// Depth (24 or 32)
+	quint16		mLayers;		// Number of layers
+};
+
+#endif // GRAPHICS_TEXTURE_ARRAY_H
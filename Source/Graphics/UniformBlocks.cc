@@ -0,0 +1,172 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/UniformBlocks.h"
+#include "Graphics/Light.h"
+
+#include "Engine/Console.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                       UniformBlocks //
+//----------------------------------------------------------------------------//
+
+UniformBlocks::FrameBlock  UniformBlocks::mFrame;
+UniformBlocks::CameraBlock UniformBlocks::mCamera;
+UniformBlocks::LightBlock  UniformBlocks::mLights;
+
+UniformBuffer UniformBlocks::mFrameBuffer;
+UniformBuffer UniformBlocks::mCameraBuffer;
+UniformBuffer UniformBlocks::mLightBuffer;
+
+bool UniformBlocks::mFrameDirty  = false;
+bool UniformBlocks::mCameraDirty = false;
+bool UniformBlocks::mLightDirty  = false;
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                       UniformBlocks //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool UniformBlocks::Load (void)
+{
+	// The blocks are uploaded as is
+	Q_ASSERT (sizeof (FrameBlock ) ==  16);
+	Q_ASSERT (sizeof (CameraBlock) == 256);
+	Q_ASSERT (sizeof (LightBlock ) == 752);
+
+	if (!mFrameBuffer .Load (sizeof (FrameBlock )) ||
+		!mCameraBuffer.Load (sizeof (CameraBlock)) ||
+		!mLightBuffer .Load (sizeof (LightBlock )))
+	{
+		Console::Error ("Unable to create uniform blocks");
+		Unload(); return false;
+	}
+
+	SetFrame    (0, 0, 0, 0);
+	SetCamera   (Matrix::Identity, Matrix::Identity);
+	SetShadow   (Matrix::Identity, Matrix::Identity, 0, 1);
+	SetLights   (nullptr, 0);
+	SetCascades (nullptr, nullptr, 0);
+
+	// Attach buffers to their binding points
+	mFrameBuffer .Bind (UniformBuffer::FrameBinding );
+	mCameraBuffer.Bind (UniformBuffer::CameraBinding);
+	mLightBuffer .Bind (UniformBuffer::LightBinding );
+
+	Update();
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::Unload (void)
+{
+	mFrameBuffer .Unload();
+	mCameraBuffer.Unload();
+	mLightBuffer .Unload();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::SetFrame (float time, float elapsedTime, float width, float height)
+{
+	mFrame.Time			= time;
+	mFrame.ElapsedTime	= elapsedTime;
+	mFrame.ScreenWidth	= width;
+	mFrame.ScreenHeight	= height;
+	mFrameDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::SetCamera (const Matrix& view, const Matrix& projection)
+{
+	mCamera.View		= view;
+	mCamera.Projection	= projection;
+	mCamera.ViewProj	= projection * view;
+	mCamera.ViewInverse	= Matrix::Invert (view);
+	mCameraDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::SetShadow (const Matrix& view, const Matrix& projection, float near, float far)
+{
+	mLights.ShadowView	= view;
+	mLights.ShadowProj	= projection;
+	mLights.ShadowLight	= projection * view;
+	mLights.ShadowNear	= near;
+	mLights.ShadowFar	= far;
+	mLightDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::SetLights (const Light* const* lights, quint32 count)
+{
+	if (count > MaxLights) count = MaxLights;
+
+	for (quint32 i = 0; i < count; ++i)
+	{
+		mLights.Positions[i] = Vector4 (lights[i]->Position, 1);
+		mLights.Colors   [i] = lights[i]->Diffuse;
+	}
+
+	mLights.Count	= count;
+	mLights.Padding	= 0;
+	mLightDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBlocks::SetCascades (const Matrix* matrices, const float* splits, quint32 count)
+{
+	if (count > MaxCascades) count = MaxCascades;
+
+	for (quint32 i = 0; i < MaxCascades; ++i)
+	{
+		mLights.Cascades[i] = i < count ? matrices[i] : Matrix::Identity;
+		mLights.Splits  [i] = i < count ? splits  [i] : 0.0f;
+	}
+
+	mLights.CascadeCount = count;
+	mLights.Padding2[0] = mLights.Padding2[1] = mLights.Padding2[2] = 0;
+	mLightDirty = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Uploads every block which changed since the last update
+
+void UniformBlocks::Update (void)
+{
+	if (mFrameDirty ) mFrameBuffer .Update (&mFrame,  sizeof (FrameBlock ));
+	if (mCameraDirty) mCameraBuffer.Update (&mCamera, sizeof (CameraBlock));
+	if (mLightDirty ) mLightBuffer .Update (&mLights, sizeof (LightBlock ));
+
+	mFrameDirty  = false;
+	mCameraDirty = false;
+	mLightDirty  = false;
+}
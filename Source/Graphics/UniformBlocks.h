@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_UNIFORM_BLOCKS_H
+#define GRAPHICS_UNIFORM_BLOCKS_H
+
+class Light;
+
+#include "Math/Matrix.h"
+#include "Math/Vector4.h"
+#include "Graphics/Color.h"
+#include "Graphics/UniformBuffer.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Per-frame uniform buffers shared by every shader. </summary>
+/// Layouts mirror the std140 Frame, Camera and Lights blocks
+
+class UniformBlocks
+{
+private:
+	// Constructors
+	 UniformBlocks (void) { }
+	 UniformBlocks (const UniformBlocks& blocks) { }
+	~UniformBlocks (void) { }
+
+public:
+	// Static
+	static const quint32 MaxLights = 8;
+	static const quint32 MaxCascades = 4;
+
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class FrameBlock
+	{
+	public:
+		// Properties
+		float		Time;					// Total time in seconds
+		float		ElapsedTime;			// Frame time in seconds
+		float		ScreenWidth;			// Viewport width
+		float		ScreenHeight;			// Viewport height
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class CameraBlock
+	{
+	public:
+		// Properties
+		Matrix		View;					// World to view
+		Matrix		Projection;				// View to clip
+		Matrix		ViewProj;				// World to clip
+		Matrix		ViewInverse;			// View to world
+	};
+
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class LightBlock
+	{
+	public:
+		// Properties
+		Matrix		ShadowView;				// World to light view
+		Matrix		ShadowProj;				// Light view to clip
+		Matrix		ShadowLight;			// World to light clip
+
+		Vector4		Positions[MaxLights];	// World positions
+		Color		Colors   [MaxLights];	// Diffuse colors
+
+		qint32		Count;					// Number of lights
+		float		ShadowNear;				// Shadow depth range
+		float		ShadowFar;
+		float		Padding;
+
+		Matrix		Cascades[MaxCascades];	// World to clip of each cascade
+		float		Splits  [MaxCascades];	// Farthest view depth of each cascade
+		qint32		CascadeCount;			// Number of cascades in use
+		float		Padding2[3];
+	};
+
+public:
+	// Static
+	static bool		Load			(void);
+	static void		Unload			(void);
+
+	static void		SetFrame		(float time, float elapsedTime, float width, float height);
+	static void		SetCamera		(const Matrix& view, const Matrix& projection);
+	static void		SetShadow		(const Matrix& view, const Matrix& projection, float near, float far);
+	static void		SetLights		(const Light* const* lights, quint32 count);
+	static void		SetCascades		(const Matrix* matrices, const float* splits, quint32 count);
+
+	static void		Update			(void);
+
+	static const FrameBlock&	GetFrame	(void) { return mFrame;		}
+	static const CameraBlock&	GetCamera	(void) { return mCamera;	}
+	static const LightBlock&	GetLights	(void) { return mLights;	}
+
+private:
+	// Fields
+	static FrameBlock		mFrame;
+	static CameraBlock		mCamera;
+	static LightBlock		mLights;
+
+	static UniformBuffer	mFrameBuffer;
+	static UniformBuffer	mCameraBuffer;
+	static UniformBuffer	mLightBuffer;
+
+	static bool				mFrameDirty;		// Blocks waiting to be uploaded
+	static bool				mCameraDirty;
+	static bool				mLightDirty;
+};
+
+#endif // GRAPHICS_UNIFORM_BLOCKS_H
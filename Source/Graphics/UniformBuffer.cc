@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Graphics/UniformBuffer.h"
+#include "Engine/Console.h"
+
+#define GLEW_STATIC
+#include <glew.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                 UniformBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+UniformBuffer::UniformBuffer (void)
+{
+	mBufferID   = 0;
+	mDataLength = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+UniformBuffer::~UniformBuffer (void)
+{
+	Unload();
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                      UniformBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool UniformBuffer::Load (quint32 dataLength)
+{
+	// Check if already loaded
+	if (IsLoaded()) return true;
+
+	// Create the uniform buffer
+	GL_CALL (glGenBuffers (1, &mBufferID));
+	GL_CALL (glBindBuffer (GL_UNIFORM_BUFFER, mBufferID));
+
+	// Allocate the buffer storage
+	GL_CALL (glBufferData (GL_UNIFORM_BUFFER,
+		dataLength, nullptr, GL_DYNAMIC_DRAW));
+
+	GL_CALL (glBindBuffer (GL_UNIFORM_BUFFER, 0));
+	mDataLength = dataLength;
+
+	// Check for any OpenGL errors
+	GL_CHECK (Unload(); return false);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBuffer::Unload (void)
+{
+	// Check if already unloaded
+	if (!IsLoaded()) return;
+
+	// Delete the uniform buffer
+	GL_CALL (glDeleteBuffers (1, &mBufferID));
+	mBufferID   = 0;
+	mDataLength = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBuffer::Update (const void* data, quint32 length, quint32 offset)
+{
+	// Check buffer bounds
+	if (!IsLoaded() || offset + length > mDataLength) return;
+
+	GL_CALL (glBindBuffer (GL_UNIFORM_BUFFER, mBufferID));
+	GL_CALL (glBufferSubData (GL_UNIFORM_BUFFER, offset, length, data));
+	GL_CALL (glBindBuffer (GL_UNIFORM_BUFFER, 0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void UniformBuffer::Bind (BindingPoint binding) const
+{
+	GL_CALL (glBindBufferBase (GL_UNIFORM_BUFFER, binding, mBufferID));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Binds part of the buffer, the offset must be a multiple
+/// 		  of the offset alignment. </summary>
+
+void UniformBuffer::Bind (BindingPoint binding, quint32 offset, quint32 length) const
+{
+	GL_CALL (glBindBufferRange (GL_UNIFORM_BUFFER, binding, mBufferID, offset, length));
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                       UniformBuffer //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Required alignment of ranges bound with Bind. </summary>
+
+quint32 UniformBuffer::GetOffsetAlignment (void)
+{
+	static GLint alignment = 0;
+
+	if (alignment <= 0)
+	{
+		GL_CALL (glGetIntegerv (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+		if (alignment <= 0) alignment = 256;
+	}
+
+	return alignment;
+}
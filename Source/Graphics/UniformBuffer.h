@@ -0,0 +1,72 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef GRAPHICS_UNIFORM_BUFFER_H
+#define GRAPHICS_UNIFORM_BUFFER_H
+
+#include <QGlobal.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+class UniformBuffer
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	enum BindingPoint
+	{
+		BoneBinding				= 0,
+		FrameBinding			= 1,
+		CameraBinding			= 2,
+		LightBinding			= 3,
+		MaterialBinding			= 4,
+	};
+
+public:
+	// Constructors
+	 UniformBuffer (void);
+	~UniformBuffer (void);
+
+public:
+	// Methods
+	bool		Load			(quint32 dataLength);
+	void		Unload			(void);
+
+	bool		IsLoaded		(void) const { return mBufferID != 0;	}
+
+	void		Update			(const void* data, quint32 length, quint32 offset = 0);
+	void		Bind			(BindingPoint binding) const;
+	void		Bind			(BindingPoint binding, quint32 offset, quint32 length) const;
+
+	quint32		GetBufferID		(void) const { return mBufferID;		}
+	quint32		GetDataLength	(void) const { return mDataLength;		}
+
+public:
+	// Static
+	static quint32 GetOffsetAlignment (void);
+
+private:
+	// Fields
+	quint32		mBufferID;		// OpenGL buffer ID
+	quint32		mDataLength;	// Buffer data length
+};
+
+#endif // GRAPHICS_UNIFORM_BUFFER_H
@@ -100,6 +100,9 @@ VertexDeclaration::VertexDeclaration (const VertexDeclaration& declaration)
 	mElements = new VertexElement[mElementCount];
 	mVertexSize = declaration.mVertexSize;
 
+	mDivisor  = declaration.mDivisor;
+	mLocation = declaration.mLocation;
+
 	// Copy elements array
 	memcpy (mElements, declaration.mElements,
 		mElementCount * sizeof (VertexElement));
@@ -108,13 +111,17 @@ VertexDeclaration::VertexDeclaration (const VertexDeclaration& declaration)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-VertexDeclaration::VertexDeclaration (quint8 elementCount, const VertexElement* elements)
+VertexDeclaration::VertexDeclaration (quint8 elementCount,
+	const VertexElement* elements, quint32 divisor, quint8 location)
 {
 	// Create a new list of vertex elements
 	mElementCount = elementCount;
 	mElements = new VertexElement[mElementCount];
 	mVertexSize = 0;
 
+	mDivisor  = divisor;
+	mLocation = location;
+
 	// Copy vertex elements and compute size
 	for (quint8 i = 0; i < mElementCount; ++i)
 	{
@@ -156,9 +163,14 @@ void VertexDeclaration::LoadPointers (void) const
 {
 	for (quint32 i = 0; i < mElementCount; ++i)
 	{
-		GL_CALL (glEnableVertexAttribArray (i));
-		GL_CALL (glVertexAttribPointer (i, mElements[i].GetComponentCount(), mElements[i].
+		quint32 location = mLocation + i;
+
+		GL_CALL (glEnableVertexAttribArray (location));
+		GL_CALL (glVertexAttribPointer (location, mElements[i].GetComponentCount(), mElements[i].
 			GetFormatType(), GL_FALSE, mVertexSize, (void*) mElements[i].Offset));
+
+		if (mDivisor != 0)
+			GL_CALL (glVertexAttribDivisor (location, mDivisor));
 	}
 }
 
@@ -168,7 +180,14 @@ void VertexDeclaration::LoadPointers (void) const
 void VertexDeclaration::UnloadPointers (void) const
 {
 	for (quint32 i = 0; i < mElementCount; ++i)
-		GL_CALL (glDisableVertexAttribArray (i));
+	{
+		quint32 location = mLocation + i;
+
+		if (mDivisor != 0)
+			GL_CALL (glVertexAttribDivisor (location, 0));
+
+		GL_CALL (glDisableVertexAttribArray (location));
+	}
 }
 
 
@@ -262,8 +281,10 @@ bool VertexBuffer::Load (void)
 	GL_CALL (glBufferData (GL_ARRAY_BUFFER,
 		mDataLength, mData, GL_STATIC_DRAW));
 
-	// Load the vertex array pointers
-	mVertexDeclaration->LoadPointers();
+	// Load the vertex array pointers, instance
+	// streams are attached when they are drawn
+	if (mVertexDeclaration->GetDivisor() == 0)
+		mVertexDeclaration->LoadPointers();
 
 	// Check for any OpenGL errors
 	GL_CHECK (Unload(); return false);
@@ -288,8 +309,9 @@ void VertexBuffer::Unload (void)
 	// Check if already unloaded
 	if (!IsLoaded()) return;
 
-	// Load the vertex array pointers
-	mVertexDeclaration->UnloadPointers();
+	// Unload the vertex array pointers
+	if (mVertexDeclaration->GetDivisor() == 0)
+		mVertexDeclaration->UnloadPointers();
 
 	// Delete the vertex buffer
 	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, 0));
@@ -297,6 +319,84 @@ void VertexBuffer::Unload (void)
 	mVertexID = 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Orphans the previous storage so the driver doesn't stall on it
+
+bool VertexBuffer::Update (void)
+{
+	// Buffer must be loaded with data
+	if (!IsLoaded() || IsPurged()) return false;
+
+	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mVertexID));
+	GL_CALL (glBufferData (GL_ARRAY_BUFFER,
+		mDataLength, mData, GL_STREAM_DRAW));
+
+	// Check for any OpenGL errors
+	GL_CHECK (return false);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Uploads only the first vertices of the buffer. </summary>
+/// Orphans the previous storage, the remaining vertices are undefined
+
+bool VertexBuffer::Update (quint32 vertexCount)
+{
+	// Buffer must be loaded with data
+	if (!IsLoaded() || IsPurged()) return false;
+	if (vertexCount > mVertexCount) return false;
+
+	quint32 length = vertexCount * mVertexDeclaration->GetVertexSize();
+
+	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mVertexID));
+	GL_CALL (glBufferData (GL_ARRAY_BUFFER,
+		mDataLength, nullptr, GL_STREAM_DRAW));
+
+	GL_CALL (glBufferSubData (GL_ARRAY_BUFFER, 0, length, mData));
+
+	// Check for any OpenGL errors
+	GL_CHECK (return false);
+
+	// All done
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Orphans the buffer and maps the new storage for writing. </summary>
+/// Works on purged buffers, the contents must be rewritten entirely
+
+void* VertexBuffer::Map (void)
+{
+	if (!IsLoaded()) return nullptr;
+	quint32 length = mVertexCount * mVertexDeclaration->GetVertexSize();
+
+	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mVertexID));
+	GL_CALL (glBufferData (GL_ARRAY_BUFFER, length, nullptr, GL_STREAM_DRAW));
+
+	void* data = nullptr;
+	GL_CALL (data = glMapBufferRange (GL_ARRAY_BUFFER, 0, length,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+
+	return data;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool VertexBuffer::Unmap (void)
+{
+	if (!IsLoaded()) return false;
+
+	GLboolean result = GL_FALSE;
+	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mVertexID));
+	GL_CALL (result = glUnmapBuffer (GL_ARRAY_BUFFER));
+
+	return result == GL_TRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
@@ -314,8 +414,8 @@ void VertexBuffer::Purge (void)
 ////////////////////////////////////////////////////////////////////////////////
 /// <summary> </summary>
 
-bool VertexBuffer::Create (quint32 vertexCount,
-	quint8 elementCount, const VertexElement* elements)
+bool VertexBuffer::Create (quint32 vertexCount, quint8 elementCount,
+	const VertexElement* elements, quint32 divisor, quint8 location)
 {
 	// Check parameters
 	if (vertexCount  == 0 ||
@@ -329,7 +429,8 @@ bool VertexBuffer::Create (quint32 vertexCount,
 		delete mVertexDeclaration;
 
 	// Create vertex declaration
-	mVertexDeclaration = new VertexDeclaration (elementCount, elements);
+	mVertexDeclaration = new VertexDeclaration
+		(elementCount, elements, divisor, location);
 	mVertexCount = vertexCount;
 
 	// Compute data length and allocate memory
@@ -340,6 +441,27 @@ bool VertexBuffer::Create (quint32 vertexCount,
 	return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Points the bound vertex array at this buffer. </summary>
+/// Used to attach instance streams to a mesh for one draw
+
+void VertexBuffer::Attach (void) const
+{
+	if (!IsLoaded()) return;
+
+	GL_CALL (glBindBuffer (GL_ARRAY_BUFFER, mVertexID));
+	mVertexDeclaration->LoadPointers();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void VertexBuffer::Detach (void) const
+{
+	if (!IsLoaded()) return;
+	mVertexDeclaration->UnloadPointers();
+}
+
 
 
 //----------------------------------------------------------------------------//
@@ -492,6 +614,22 @@ bool IndexBuffer::Create (quint32 indexCount, quint8 indexSize)
 	return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Reads a single index whatever the index size. </summary>
+/// The buffer must not be purged
+
+quint32 IndexBuffer::GetIndex (quint32 index) const
+{
+	switch (mIndexSize)
+	{
+		case 1: return ((const quint8 *) mData)[index];
+		case 2: return ((const quint16*) mData)[index];
+		case 4: return ((const quint32*) mData)[index];
+	}
+
+	return 0;
+}
+
 
 
 //----------------------------------------------------------------------------//
@@ -559,3 +697,47 @@ SYNTHESIZE_VERTEX_DEFINITION
 	VertexElement (VertexElement::Vector3Format, VertexElement::NormalType),
 	VertexElement (VertexElement::Vector2Format, VertexElement::TextureUVType)
 );
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SYNTHESIZE_VERTEX_DEFINITION
+(
+	VertexPositionNormalTextureSkin, 5,
+	VertexElement (VertexElement::Vector4Format, VertexElement::PositionType),
+	VertexElement (VertexElement::Vector3Format, VertexElement::NormalType),
+	VertexElement (VertexElement::Vector2Format, VertexElement::TextureUVType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::BlendIndicesType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::BlendWeightType)
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SYNTHESIZE_VERTEX_DEFINITION
+(
+	VertexParticle, 2,
+	VertexElement (VertexElement::Vector4Format, VertexElement::PositionType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::VelocityType)
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SYNTHESIZE_VERTEX_DEFINITION
+(
+	VertexInstance, 4,
+	VertexElement (VertexElement::Vector4Format, VertexElement::TransformType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::TransformType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::TransformType),
+	VertexElement (VertexElement::Vector4Format, VertexElement::TransformType)
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+SYNTHESIZE_VERTEX_DEFINITION
+(
+	VertexIndex, 1,
+	VertexElement (VertexElement::FloatFormat, VertexElement::IndexType)
+);
@@ -17,6 +17,7 @@
 #include "Math/Vector2.h"
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
+#include "Math/Matrix.h"
 #include "Graphics/Color.h"
 
 
@@ -60,6 +61,11 @@ public:
 		TangentType				= 80,
 		TessellateFactorType	= 90,
 		TextureUVType			= 100,
+		BlendIndicesType		= 110,
+		BlendWeightType			= 120,
+		TransformType			= 130,
+		VelocityType			= 140,
+		IndexType				= 150,
 	};
 
 public:
@@ -129,7 +135,8 @@ class VertexDeclaration
 public:
 	// Constructors
 	 VertexDeclaration (const VertexDeclaration& declaration);
-	 VertexDeclaration (quint8 elementCount, const VertexElement* elements);
+	 VertexDeclaration (quint8 elementCount, const VertexElement* elements,
+						quint32 divisor = 0, quint8 location = 0);
 	~VertexDeclaration (void);
 
 public:
@@ -141,11 +148,17 @@ public:
 	quint8					GetElementCount	(void) const { return mElementCount;	}
 	const VertexElement*	GetElements		(void) const { return mElements;		}
 
+	quint32					GetDivisor		(void) const { return mDivisor;			}
+	quint8					GetLocation		(void) const { return mLocation;		}
+
 private:
 	// Fields
 	quint16					mVertexSize;	// Size of declaration
 	quint8					mElementCount;	// Number of elements
 	VertexElement*			mElements;		// Vertex element list
+
+	quint32					mDivisor;		// Instances per element, zero for vertices
+	quint8					mLocation;		// First attribute location
 };
 
 
@@ -166,6 +179,11 @@ public:
 	bool		Load			(void);
 	bool		Reload			(void);
 	void		Unload			(void);
+	bool		Update			(void);
+	bool		Update			(quint32 vertexCount);
+
+	void*		Map				(void);
+	bool		Unmap			(void);
 
 	void		Purge			(void);
 
@@ -180,7 +198,12 @@ public:
 
 	bool		Create			(quint32 vertexCount,
 								 quint8 elementCount,
-								 const VertexElement* elements);
+								 const VertexElement* elements,
+								 quint32 divisor = 0,
+								 quint8 location = 0);
+
+	void		Attach			(void) const;
+	void		Detach			(void) const;
 
 	VertexDeclaration* GetVertexDeclaration (void) const { return mVertexDeclaration; }
 
@@ -226,6 +249,7 @@ public:
 
 	quint32		GetDataLength	(void) const { return mDataLength;		}
 	quint8*		GetData			(void) const { return mData;			}
+	quint32		GetIndex		(quint32 index) const;
 
 	bool		Create			(quint32 indexCount, quint8 indexSize);
 
@@ -347,4 +371,49 @@ SYNTHESIZE_VERTEX_DECLARATION
 	Vector2 Texture;
 );
 
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Blend indices are stored as floats to share the float attribute path
+
+SYNTHESIZE_VERTEX_DECLARATION
+(
+	VertexPositionNormalTextureSkin, 5,
+	Vector4 Position;
+	Vector3 Normal;
+	Vector2 Texture;
+	Vector4 BlendIndices;
+	Vector4 BlendWeights;
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Age is stored in Position.W and lifetime in Velocity.W
+
+SYNTHESIZE_VERTEX_DECLARATION
+(
+	VertexParticle, 2,
+	Vector4 Position;
+	Vector4 Velocity;
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Each matrix row occupies one attribute location
+
+SYNTHESIZE_VERTEX_DECLARATION
+(
+	VertexInstance, 4,
+	Matrix World;
+);
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+/// Instance indices are stored as floats to share the float attribute path
+
+SYNTHESIZE_VERTEX_DECLARATION
+(
+	VertexIndex, 1,
+	float Index;
+);
+
 #endif // GRAPHICS_VERTEX_H
@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Math/Math.h"
+#include "Math/Matrix.h"
+#include "Math/BoundingBox.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                   BoundingBox //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates a new instance of this class. </summary>
+/// <param name="min"> Minimum corner of the box. </param>
+/// <param name="max"> Maximum corner of the box. </param>
+
+BoundingBox::BoundingBox (const Vector3& min, const Vector3& max)
+{
+	Min = min;
+	Max = max;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                        BoundingBox //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns the point halfway between both corners. </summary>
+
+Vector3 BoundingBox::GetCenter (void) const
+{
+	return (Min + Max) * 0.5f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Returns half the size of the box along each axis. </summary>
+
+Vector3 BoundingBox::GetExtents (void) const
+{
+	return (Max - Min) * 0.5f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+float BoundingBox::GetSurfaceArea (void) const
+{
+	Vector3 size = Max - Min;
+	return 2.0f * (size.X * size.Y + size.Y * size.Z + size.Z * size.X);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether this box contains a point. </summary>
+
+BoundingBox::Containment BoundingBox::Contains (const Vector3& point) const
+{
+	if (point.X < Min.X || point.X > Max.X ||
+		point.Y < Min.Y || point.Y > Max.Y ||
+		point.Z < Min.Z || point.Z > Max.Z) return Outside;
+
+	return Inside;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether this box contains another box. </summary>
+
+BoundingBox::Containment BoundingBox::Contains (const BoundingBox& box) const
+{
+	if (box.Max.X < Min.X || box.Min.X > Max.X ||
+		box.Max.Y < Min.Y || box.Min.Y > Max.Y ||
+		box.Max.Z < Min.Z || box.Min.Z > Max.Z) return Outside;
+
+	if (box.Min.X >= Min.X && box.Max.X <= Max.X &&
+		box.Min.Y >= Min.Y && box.Max.Y <= Max.Y &&
+		box.Min.Z >= Min.Z && box.Max.Z <= Max.Z) return Inside;
+
+	return Intersecting;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                         BoundingBox //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the smallest box containing both boxes. </summary>
+
+BoundingBox BoundingBox::CreateMerged (const BoundingBox& box1, const BoundingBox& box2)
+{
+	return BoundingBox (Vector3::Min (box1.Min, box2.Min),
+						Vector3::Max (box1.Max, box2.Max));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates a box containing the transformed box. </summary>
+/// Projects the extents onto each axis instead of transforming all eight corners
+
+BoundingBox BoundingBox::Transform (const BoundingBox& box, const Matrix& matrix)
+{
+	Vector3 c = box.GetCenter ();
+	Vector3 e = box.GetExtents();
+
+	Vector3 center
+	(
+		matrix.M11 * c.X + matrix.M12 * c.Y + matrix.M13 * c.Z + matrix.M14,
+		matrix.M21 * c.X + matrix.M22 * c.Y + matrix.M23 * c.Z + matrix.M24,
+		matrix.M31 * c.X + matrix.M32 * c.Y + matrix.M33 * c.Z + matrix.M34
+	);
+
+	Vector3 extents
+	(
+		Math::Abs (matrix.M11) * e.X + Math::Abs (matrix.M12) * e.Y + Math::Abs (matrix.M13) * e.Z,
+		Math::Abs (matrix.M21) * e.X + Math::Abs (matrix.M22) * e.Y + Math::Abs (matrix.M23) * e.Z,
+		Math::Abs (matrix.M31) * e.X + Math::Abs (matrix.M32) * e.Y + Math::Abs (matrix.M33) * e.Z
+	);
+
+	return BoundingBox (center - extents, center + extents);
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Operators                                                                  //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool operator == (const BoundingBox& value1, const BoundingBox& value2)
+{
+	return value1.Min == value2.Min && value1.Max == value2.Max;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool operator != (const BoundingBox& value1, const BoundingBox& value2)
+{
+	return value1.Min != value2.Min || value1.Max != value2.Max;
+}
@@ -0,0 +1,78 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef MATH_BOUNDING_BOX_H
+#define MATH_BOUNDING_BOX_H
+
+class Matrix;
+
+#include "Math/Vector3.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Represents an axis-aligned box using two corners. </summary>
+
+class BoundingBox
+{
+public:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Describes how one bounding volume relates to another. </summary>
+
+	enum Containment
+	{
+		Outside,		// Volumes do not overlap
+		Inside,			// Volume is entirely inside
+		Intersecting,	// Volumes partially overlap
+	};
+
+public:
+	// Constructors
+	explicit BoundingBox				(void) { }
+	explicit BoundingBox				(const Vector3& min, const Vector3& max);
+
+public:
+	// Methods
+	Vector3				GetCenter		(void) const;
+	Vector3				GetExtents		(void) const;
+	float				GetSurfaceArea	(void) const;
+
+	Containment			Contains		(const Vector3& point) const;
+	Containment			Contains		(const BoundingBox& box) const;
+
+public:
+	// Static
+	static BoundingBox	CreateMerged	(const BoundingBox& box1, const BoundingBox& box2);
+	static BoundingBox	Transform		(const BoundingBox& box, const Matrix& matrix);
+
+public:
+	// Fields
+	Vector3 Min;	// Minimum corner of the box
+	Vector3 Max;	// Maximum corner of the box
+};
+
+
+
+//----------------------------------------------------------------------------//
+// Operators                                                                  //
+//----------------------------------------------------------------------------//
+
+bool operator == (const BoundingBox& value1, const BoundingBox& value2);
+bool operator != (const BoundingBox& value1, const BoundingBox& value2);
+
+#endif // MATH_BOUNDING_BOX_H
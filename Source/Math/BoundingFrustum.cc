@@ -0,0 +1,173 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Math/Math.h"
+#include "Math/BoundingFrustum.h"
+
+#include <xmmintrin.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                               BoundingFrustum //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates a new instance of this class. </summary>
+/// <param name="viewProjection"> Combined view and projection matrix. </param>
+
+BoundingFrustum::BoundingFrustum (const Matrix& viewProjection)
+{
+	SetMatrix (viewProjection);
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                    BoundingFrustum //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether this frustum contains a box. </summary>
+
+BoundingBox::Containment BoundingFrustum::Contains (const BoundingBox& box) const
+{
+	Vector3 c = box.GetCenter ();
+	Vector3 e = box.GetExtents();
+
+	BoundingBox::Containment result = BoundingBox::Inside;
+	for (quint32 i = 0; i < PlaneCount; ++i)
+	{
+		const Plane& p = Planes[i];
+
+		// Signed distance of the center and the projected radius
+		float distance = p.Normal.X * c.X + p.Normal.Y * c.Y + p.Normal.Z * c.Z + p.Distance;
+		float radius   = Math::Abs (p.Normal.X) * e.X +
+						 Math::Abs (p.Normal.Y) * e.Y +
+						 Math::Abs (p.Normal.Z) * e.Z;
+
+		if (distance < -radius) return BoundingBox::Outside;
+		if (distance <  radius) result = BoundingBox::Intersecting;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether this frustum contains a sphere. </summary>
+
+BoundingBox::Containment BoundingFrustum::Contains (const BoundingSphere& sphere) const
+{
+	const Vector3& c = sphere.Center;
+
+	BoundingBox::Containment result = BoundingBox::Inside;
+	for (quint32 i = 0; i < PlaneCount; ++i)
+	{
+		const Plane& p = Planes[i];
+		float distance = p.Normal.X * c.X + p.Normal.Y * c.Y + p.Normal.Z * c.Z + p.Distance;
+
+		if (distance < -sphere.Radius) return BoundingBox::Outside;
+		if (distance <  sphere.Radius) result = BoundingBox::Intersecting;
+	}
+
+	return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests many boxes against this frustum, four at a time. </summary>
+/// Writes one for each box that is at least partially visible
+
+void BoundingFrustum::Cull (quint32 length, const BoundingBox* boxes, quint8* visible) const
+{
+	// Broadcast the plane coefficients
+	__m128 nx[PlaneCount], ny[PlaneCount], nz[PlaneCount], d[PlaneCount];
+	__m128 ax[PlaneCount], ay[PlaneCount], az[PlaneCount];
+
+	for (quint32 i = 0; i < PlaneCount; ++i)
+	{
+		const Plane& p = Planes[i];
+		nx[i] = _mm_set1_ps (p.Normal.X); ax[i] = _mm_set1_ps (Math::Abs (p.Normal.X));
+		ny[i] = _mm_set1_ps (p.Normal.Y); ay[i] = _mm_set1_ps (Math::Abs (p.Normal.Y));
+		nz[i] = _mm_set1_ps (p.Normal.Z); az[i] = _mm_set1_ps (Math::Abs (p.Normal.Z));
+		d [i] = _mm_set1_ps (p.Distance);
+	}
+
+	const __m128 half = _mm_set1_ps (0.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	quint32 last = length & ~3;
+	for (quint32 i = 0; i < last; i += 4)
+	{
+		const BoundingBox* b = boxes + i;
+
+		// Gather the centers and extents of four boxes
+		__m128 minX = _mm_set_ps (b[3].Min.X, b[2].Min.X, b[1].Min.X, b[0].Min.X);
+		__m128 minY = _mm_set_ps (b[3].Min.Y, b[2].Min.Y, b[1].Min.Y, b[0].Min.Y);
+		__m128 minZ = _mm_set_ps (b[3].Min.Z, b[2].Min.Z, b[1].Min.Z, b[0].Min.Z);
+		__m128 maxX = _mm_set_ps (b[3].Max.X, b[2].Max.X, b[1].Max.X, b[0].Max.X);
+		__m128 maxY = _mm_set_ps (b[3].Max.Y, b[2].Max.Y, b[1].Max.Y, b[0].Max.Y);
+		__m128 maxZ = _mm_set_ps (b[3].Max.Z, b[2].Max.Z, b[1].Max.Z, b[0].Max.Z);
+
+		__m128 cx = _mm_mul_ps (_mm_add_ps (maxX, minX), half);
+		__m128 cy = _mm_mul_ps (_mm_add_ps (maxY, minY), half);
+		__m128 cz = _mm_mul_ps (_mm_add_ps (maxZ, minZ), half);
+		__m128 ex = _mm_mul_ps (_mm_sub_ps (maxX, minX), half);
+		__m128 ey = _mm_mul_ps (_mm_sub_ps (maxY, minY), half);
+		__m128 ez = _mm_mul_ps (_mm_sub_ps (maxZ, minZ), half);
+
+		// A box is culled once it lies behind any plane
+		__m128 outside = zero;
+		for (quint32 p = 0; p < PlaneCount; ++p)
+		{
+			__m128 distance = _mm_add_ps (
+				_mm_add_ps (_mm_mul_ps (nx[p], cx), _mm_mul_ps (ny[p], cy)),
+				_mm_add_ps (_mm_mul_ps (nz[p], cz), d[p]));
+
+			__m128 radius = _mm_add_ps (
+				_mm_add_ps (_mm_mul_ps (ax[p], ex), _mm_mul_ps (ay[p], ey)),
+				_mm_mul_ps (az[p], ez));
+
+			outside = _mm_or_ps (outside, _mm_cmplt_ps (_mm_add_ps (distance, radius), zero));
+		}
+
+		int mask = _mm_movemask_ps (outside);
+		visible[i + 0] = (mask & 1) == 0;
+		visible[i + 1] = (mask & 2) == 0;
+		visible[i + 2] = (mask & 4) == 0;
+		visible[i + 3] = (mask & 8) == 0;
+	}
+
+	// Test the remaining boxes one at a time
+	for (quint32 i = last; i < length; ++i)
+		visible[i] = Contains (boxes[i]) != BoundingBox::Outside;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Extracts the planes from a view projection matrix. </summary>
+
+void BoundingFrustum::SetMatrix (const Matrix& viewProjection)
+{
+	const Matrix& m = viewProjection;
+	mMatrix = m;
+
+	// Combine the last row with each of the others
+	Planes[LeftPlane  ] = Plane (m.M41 + m.M11, m.M42 + m.M12, m.M43 + m.M13, m.M44 + m.M14);
+	Planes[RightPlane ] = Plane (m.M41 - m.M11, m.M42 - m.M12, m.M43 - m.M13, m.M44 - m.M14);
+	Planes[BottomPlane] = Plane (m.M41 + m.M21, m.M42 + m.M22, m.M43 + m.M23, m.M44 + m.M24);
+	Planes[TopPlane   ] = Plane (m.M41 - m.M21, m.M42 - m.M22, m.M43 - m.M23, m.M44 - m.M24);
+	Planes[NearPlane  ] = Plane (m.M41 + m.M31, m.M42 + m.M32, m.M43 + m.M33, m.M44 + m.M34);
+	Planes[FarPlane   ] = Plane (m.M41 - m.M31, m.M42 - m.M32, m.M43 - m.M33, m.M44 - m.M34);
+
+	for (quint32 i = 0; i < PlaneCount; ++i)
+		Planes[i].Normalize();
+}
@@ -0,0 +1,70 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef MATH_BOUNDING_FRUSTUM_H
+#define MATH_BOUNDING_FRUSTUM_H
+
+#include "Math/Plane.h"
+#include "Math/Matrix.h"
+#include "Math/BoundingBox.h"
+#include "Math/BoundingSphere.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Represents the volume seen through a view projection
+/// 		  matrix as six planes facing inwards. </summary>
+
+class BoundingFrustum
+{
+public:
+	// Types
+	enum PlaneIndex
+	{
+		LeftPlane,
+		RightPlane,
+		BottomPlane,
+		TopPlane,
+		NearPlane,
+		FarPlane,
+		PlaneCount,
+	};
+
+public:
+	// Constructors
+	explicit BoundingFrustum				(void) { }
+	explicit BoundingFrustum				(const Matrix& viewProjection);
+
+public:
+	// Methods
+	BoundingBox::Containment Contains		(const BoundingBox&    box   ) const;
+	BoundingBox::Containment Contains		(const BoundingSphere& sphere) const;
+
+	void				Cull				(quint32 length, const BoundingBox* boxes, quint8* visible) const;
+
+	const Matrix&		GetMatrix			(void) const { return mMatrix; }
+	void				SetMatrix			(const Matrix& viewProjection);
+
+public:
+	// Fields
+	Plane Planes[PlaneCount];	// Normalized planes facing inwards
+
+private:
+	Matrix mMatrix;				// Matrix the planes were extracted from
+};
+
+#endif // MATH_BOUNDING_FRUSTUM_H
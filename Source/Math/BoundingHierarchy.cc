@@ -0,0 +1,374 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Math/Math.h"
+#include "Math/BoundingHierarchy.h"
+#include "Math/BoundingFrustum.h"
+
+#include <QVarLengthArray.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+// Ranges this small are never split
+static const quint32 MinLeafSize = 2;
+
+// Leaves always hold fewer objects than this
+static const quint32 MaxLeafSize = 16;
+
+// Number of buckets evaluated per split
+static const quint32 BinCount = 12;
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+static inline float Axis (const Vector3& value, quint32 axis)
+{
+	return axis == 0 ? value.X : axis == 1 ? value.Y : value.Z;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Tests a box against the planes in the mask. </summary>
+/// Clears the planes the box is fully inside of, returns false once culled
+
+static inline bool TestPlanes (const BoundingFrustum& frustum,
+	const BoundingBox& box, quint32& mask)
+{
+	Vector3 c = box.GetCenter ();
+	Vector3 e = box.GetExtents();
+
+	for (quint32 i = 0; i < BoundingFrustum::PlaneCount; ++i)
+	{
+		if ((mask & (1 << i)) == 0) continue;
+		const Plane& p = frustum.Planes[i];
+
+		float distance = p.Normal.X * c.X + p.Normal.Y * c.Y + p.Normal.Z * c.Z + p.Distance;
+		float radius   = Math::Abs (p.Normal.X) * e.X +
+						 Math::Abs (p.Normal.Y) * e.Y +
+						 Math::Abs (p.Normal.Z) * e.Z;
+
+		if (distance < -radius) return false;
+		if (distance >= radius) mask &= ~(1 << i);
+	}
+
+	return true;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                             BoundingHierarchy //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+BoundingHierarchy::BoundingHierarchy (void)
+{
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                  BoundingHierarchy //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds the hierarchy over the given boxes. </summary>
+
+void BoundingHierarchy::Build (quint32 length, const BoundingBox* boxes)
+{
+	Clear();
+	if (length == 0) return;
+
+	mIndices.resize (length);
+	mCenters.resize (length);
+
+	for (quint32 i = 0; i < length; ++i)
+	{
+		mIndices[i] = i;
+		mCenters[i] = boxes[i].GetCenter();
+	}
+
+	mNodes.reserve (2 * length);
+	BuildNode (boxes, 0, length);
+
+	mCenters.clear();
+
+	// Link the nodes back up for partial refits
+	mParents.resize (mNodes.size());
+	mLeaves .resize (length);
+	mParents[0] = 0;
+
+	for (qint32 i = 0; i < mNodes.size(); ++i)
+	{
+		const Node& node = mNodes[i];
+
+		if (node.Right != 0)
+		{
+			mParents[i + 1]		 = i;
+			mParents[node.Right] = i;
+		}
+
+		else
+		{
+			for (quint32 j = 0; j < node.Count; ++j)
+				mLeaves[mIndices[node.First + j]] = i;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Recomputes the node bounds after objects moved. </summary>
+/// Keeps the tree structure, rebuild when objects moved far
+
+void BoundingHierarchy::Refit (const BoundingBox* boxes)
+{
+	// Children always follow their parent
+	for (qint32 i = mNodes.size() - 1; i >= 0; --i)
+		RefitNode (boxes, i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Recomputes only the nodes above the given objects. </summary>
+/// Every other node keeps its bounds from the last build or refit
+
+void BoundingHierarchy::Refit (const BoundingBox* boxes,
+	const quint32* objects, quint32 count)
+{
+	if (mNodes.isEmpty() || count == 0) return;
+
+	// Flag the leaves holding the moved objects
+	mDirty.fill (0, mNodes.size());
+	for (quint32 i = 0; i < count; ++i)
+		mDirty[mLeaves[objects[i]]] = 1;
+
+	// Children always follow their parent, so a single backwards
+	// pass refits every flagged node before its parent is reached
+	for (qint32 i = mNodes.size() - 1; i >= 0; --i)
+	{
+		if (mDirty[i] == 0) continue;
+
+		RefitNode (boxes, i);
+		if (i > 0) mDirty[mParents[i]] = 1;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void BoundingHierarchy::Clear (void)
+{
+	mNodes  .resize (0);
+	mIndices.resize (0);
+	mParents.resize (0);
+	mLeaves .resize (0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Collects the objects intersecting the frustum. </summary>
+/// Subtrees entirely inside are accepted without testing their children
+
+void BoundingHierarchy::Query (const BoundingFrustum& frustum,
+	const BoundingBox* boxes, QVector<quint32>& results) const
+{
+	results.resize (0);
+	if (mNodes.isEmpty()) return;
+
+	// Nodes waiting to be visited, with the planes they still straddle
+	QVarLengthArray<quint32, 128> stack;
+	stack.append (0);
+	stack.append ((1 << BoundingFrustum::PlaneCount) - 1);
+
+	while (!stack.isEmpty())
+	{
+		quint32 mask  = stack.last(); stack.removeLast();
+		quint32 index = stack.last(); stack.removeLast();
+		const Node& node = mNodes[index];
+
+		if (!TestPlanes (frustum, node.Bounds, mask)) continue;
+
+		// Fully inside, accept the whole subtree
+		if (mask == 0)
+		{
+			for (quint32 i = 0; i < node.Count; ++i)
+				results.append (mIndices[node.First + i]);
+		}
+
+		// Test the objects of partially visible leaves
+		else if (node.Right == 0)
+		{
+			for (quint32 i = 0; i < node.Count; ++i)
+			{
+				quint32 object = mIndices[node.First + i];
+				quint32 planes = mask;
+
+				if (TestPlanes (frustum, boxes[object], planes))
+					results.append (object);
+			}
+		}
+
+		else
+		{
+			stack.append (node.Right); stack.append (mask);
+			stack.append (index + 1 ); stack.append (mask);
+		}
+	}
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                 BoundingHierarchy //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Builds a subtree over a range of objects. </summary>
+/// Returns the index of the subtree root
+
+quint32 BoundingHierarchy::BuildNode (const BoundingBox* boxes, quint32 first, quint32 count)
+{
+	quint32 index = mNodes.size();
+	mNodes.append (Node());
+
+	// Find the bounds of the objects and of their centers
+	BoundingBox bounds = boxes[mIndices[first]];
+	BoundingBox centers (mCenters[mIndices[first]], mCenters[mIndices[first]]);
+
+	for (quint32 i = first + 1; i < first + count; ++i)
+	{
+		const Vector3& c = mCenters[mIndices[i]];
+		bounds = BoundingBox::CreateMerged (bounds, boxes[mIndices[i]]);
+		centers.Min = Vector3::Min (centers.Min, c);
+		centers.Max = Vector3::Max (centers.Max, c);
+	}
+
+	mNodes[index].Bounds = bounds;
+	mNodes[index].First  = first;
+	mNodes[index].Count  = count;
+	mNodes[index].Right  = 0;
+
+	if (count <= MinLeafSize) return index;
+
+	// Split along the axis where the centers spread the most
+	Vector3 spread = centers.Max - centers.Min;
+	quint32 axis = spread.X > spread.Y && spread.X > spread.Z ? 0 : spread.Y > spread.Z ? 1 : 2;
+
+	float start  = Axis (centers.Min, axis);
+	float extent = Axis (spread, axis);
+
+	quint32 split = first + count / 2;
+	if (extent > 0)
+	{
+		// Sort the objects into buckets
+		quint32		binCounts[BinCount] = { 0 };
+		BoundingBox	binBounds[BinCount];
+
+		float scale = BinCount / extent;
+		for (quint32 i = first; i < first + count; ++i)
+		{
+			quint32 o = mIndices[i];
+			quint32 b = qMin ((quint32) ((Axis (mCenters[o], axis) - start) * scale), BinCount - 1);
+
+			binBounds[b] = binCounts[b]++ == 0 ? boxes[o] :
+				BoundingBox::CreateMerged (binBounds[b], boxes[o]);
+		}
+
+		// Sweep from the right to find the cost of every right side
+		float rightCosts[BinCount];
+		BoundingBox side; quint32 sideCount = 0;
+
+		for (quint32 b = BinCount - 1; b > 0; --b)
+		{
+			if (binCounts[b] > 0)
+				side = sideCount == 0 ? binBounds[b] :
+					BoundingBox::CreateMerged (side, binBounds[b]);
+
+			sideCount += binCounts[b];
+			rightCosts[b] = sideCount == 0 ? 0 : sideCount * side.GetSurfaceArea();
+		}
+
+		// Sweep from the left and keep the cheapest split
+		float bestCost = -1; quint32 bestBin = 0;
+		sideCount = 0;
+
+		for (quint32 b = 0; b < BinCount - 1; ++b)
+		{
+			if (binCounts[b] > 0)
+				side = sideCount == 0 ? binBounds[b] :
+					BoundingBox::CreateMerged (side, binBounds[b]);
+
+			sideCount += binCounts[b];
+			if (sideCount == 0 || sideCount == count) continue;
+
+			float cost = sideCount * side.GetSurfaceArea() + rightCosts[b + 1];
+			if (bestCost < 0 || cost < bestCost)
+				{ bestCost = cost; bestBin = b; }
+		}
+
+		// Keep small leaves when splitting costs more than testing every object
+		float area = bounds.GetSurfaceArea();
+		if (count < MaxLeafSize && (bestCost < 0 || area <= 0 ||
+			1.0f + bestCost / area >= count)) return index;
+
+		if (bestCost >= 0)
+		{
+			// Partition the objects around the chosen bucket
+			quint32 i = first, j = first + count;
+			while (i < j)
+			{
+				quint32 o = mIndices[i];
+				quint32 b = qMin ((quint32) ((Axis (mCenters[o], axis) - start) * scale), BinCount - 1);
+
+				if (b <= bestBin) ++i;
+				else qSwap (mIndices[i], mIndices[--j]);
+			}
+
+			split = i;
+		}
+	}
+
+	// Coincident centers, only split ranges too large for a leaf
+	else if (count < MaxLeafSize) return index;
+
+	BuildNode (boxes, first, split - first);
+	quint32 right = BuildNode (boxes, split, first + count - split);
+
+	mNodes[index].Right = right;
+	return index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Merges the bounds of a node's children or objects. </summary>
+
+void BoundingHierarchy::RefitNode (const BoundingBox* boxes, quint32 index)
+{
+	Node& node = mNodes[index];
+
+	if (node.Right != 0)
+	{
+		node.Bounds = BoundingBox::CreateMerged
+			(mNodes[index + 1].Bounds, mNodes[node.Right].Bounds);
+		return;
+	}
+
+	node.Bounds = boxes[mIndices[node.First]];
+	for (quint32 j = 1; j < node.Count; ++j)
+	{
+		node.Bounds = BoundingBox::CreateMerged
+			(node.Bounds, boxes[mIndices[node.First + j]]);
+	}
+}
@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef MATH_BOUNDING_HIERARCHY_H
+#define MATH_BOUNDING_HIERARCHY_H
+
+class BoundingFrustum;
+
+#include <QVector.h>
+#include "Math/BoundingBox.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Bounding volume hierarchy over a set of boxes, built
+/// 		  using the surface area heuristic. </summary>
+/// Nodes are stored depth first, the left child of a node directly follows it
+/// and every subtree references a contiguous range of objects
+
+class BoundingHierarchy
+{
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> </summary>
+
+	class Node
+	{
+	public:
+		// Properties
+		BoundingBox		Bounds;			// Bounds of every object below
+		quint32			First;			// First object of the subtree
+		quint32			Count;			// Number of objects in the subtree
+		quint32			Right;			// Right child or zero for leaves
+	};
+
+public:
+	// Constructors
+	BoundingHierarchy (void);
+
+public:
+	// Methods
+	void			Build			(quint32 length, const BoundingBox* boxes);
+	void			Refit			(const BoundingBox* boxes);
+	void			Refit			(const BoundingBox* boxes,
+									 const quint32* objects, quint32 count);
+	void			Clear			(void);
+
+	void			Query			(const BoundingFrustum& frustum,
+									 const BoundingBox* boxes,
+									 QVector<quint32>& results) const;
+
+	quint32			GetObjectCount	(void) const { return mIndices.size(); }
+	quint32			GetNodeCount	(void) const { return mNodes  .size(); }
+
+private:
+	// Internal
+	quint32			BuildNode		(const BoundingBox* boxes, quint32 first, quint32 count);
+	void			RefitNode		(const BoundingBox* boxes, quint32 index);
+
+private:
+	// Fields
+	QVector<Node>		mNodes;			// Flattened nodes
+	QVector<quint32>	mIndices;		// Objects ordered by leaf
+	QVector<Vector3>	mCenters;		// Object centers used while building
+
+	QVector<quint32>	mParents;		// Parent of every node
+	QVector<quint32>	mLeaves;		// Leaf holding every object
+	QVector<quint8>		mDirty;			// Nodes waiting to be refit
+};
+
+#endif // MATH_BOUNDING_HIERARCHY_H
@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include "Math/Math.h"
+#include "Math/Matrix.h"
+#include "Math/BoundingSphere.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                BoundingSphere //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates a new instance of this class. </summary>
+/// <param name="center"> Center of the sphere. </param>
+/// <param name="radius"> Radius of the sphere. </param>
+
+BoundingSphere::BoundingSphere (const Vector3& center, float radius)
+{
+	Center = center;
+	Radius = radius;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                     BoundingSphere //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Checks whether this sphere contains a point. </summary>
+
+BoundingBox::Containment BoundingSphere::Contains (const Vector3& point) const
+{
+	return Vector3::DistanceSquared (Center, point) <=
+		Radius * Radius ? BoundingBox::Inside : BoundingBox::Outside;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                      BoundingSphere //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Creates the sphere passing through the corners of a box. </summary>
+
+BoundingSphere BoundingSphere::CreateFromBox (const BoundingBox& box)
+{
+	return BoundingSphere (box.GetCenter(), box.GetExtents().Length());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Transforms a sphere, the radius is scaled by the
+/// 		  largest scale of the matrix. </summary>
+
+BoundingSphere BoundingSphere::Transform (const BoundingSphere& sphere, const Matrix& matrix)
+{
+	const Vector3& c = sphere.Center;
+	Vector3 center
+	(
+		matrix.M11 * c.X + matrix.M12 * c.Y + matrix.M13 * c.Z + matrix.M14,
+		matrix.M21 * c.X + matrix.M22 * c.Y + matrix.M23 * c.Z + matrix.M24,
+		matrix.M31 * c.X + matrix.M32 * c.Y + matrix.M33 * c.Z + matrix.M34
+	);
+
+	float x = matrix.M11 * matrix.M11 + matrix.M21 * matrix.M21 + matrix.M31 * matrix.M31;
+	float y = matrix.M12 * matrix.M12 + matrix.M22 * matrix.M22 + matrix.M32 * matrix.M32;
+	float z = matrix.M13 * matrix.M13 + matrix.M23 * matrix.M23 + matrix.M33 * matrix.M33;
+
+	return BoundingSphere (center, sphere.Radius *
+		Math::Sqrt (Math::Max (x, Math::Max (y, z))));
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Operators                                                                  //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool operator == (const BoundingSphere& value1, const BoundingSphere& value2)
+{
+	return value1.Center == value2.Center && value1.Radius == value2.Radius;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+bool operator != (const BoundingSphere& value1, const BoundingSphere& value2)
+{
+	return value1.Center != value2.Center || value1.Radius != value2.Radius;
+}
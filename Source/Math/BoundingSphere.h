@@ -0,0 +1,61 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef MATH_BOUNDING_SPHERE_H
+#define MATH_BOUNDING_SPHERE_H
+
+class Matrix;
+
+#include "Math/BoundingBox.h"
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Represents a sphere using a center and a radius. </summary>
+
+class BoundingSphere
+{
+public:
+	// Constructors
+	explicit BoundingSphere					(void) { }
+	explicit BoundingSphere					(const Vector3& center, float radius);
+
+public:
+	// Methods
+	BoundingBox::Containment Contains		(const Vector3& point) const;
+
+public:
+	// Static
+	static BoundingSphere	CreateFromBox	(const BoundingBox& box);
+	static BoundingSphere	Transform		(const BoundingSphere& sphere, const Matrix& matrix);
+
+public:
+	// Fields
+	Vector3 Center;	// Center of the sphere
+	float Radius;	// Radius of the sphere
+};
+
+
+
+//----------------------------------------------------------------------------//
+// Operators                                                                  //
+//----------------------------------------------------------------------------//
+
+bool operator == (const BoundingSphere& value1, const BoundingSphere& value2);
+bool operator != (const BoundingSphere& value1, const BoundingSphere& value2);
+
+#endif // MATH_BOUNDING_SPHERE_H
@@ -643,10 +643,10 @@ Matrix Matrix::CreateOrthographic (float width,
 
 	return Matrix
 	(
-		2 / width,  0, 0, 0, 0,
-		2 / height, 0, 0, 0, 0,
-		1 / d, 0, 0, 0,
-		zNearPlane / d, 1
+		2 / width, 0, 0, 0,
+		0, 2 / height, 0, 0,
+		0, 0, 2 / d, (zNearPlane + zFarPlane) / d,
+		0, 0, 0, 1
 	);
 }
 
@@ -668,13 +668,10 @@ Matrix Matrix::CreateOrthographicOffCenter (float left, float right,
 
 	return Matrix
 	(
-		2 / (right - left), 0, 0, 0, 0,
-		2 / (top - bottom), 0, 0, 0, 0,
-		1 / d, 0,
-
-		(left + right) / (left - right),
-		(top + bottom) / (bottom - top),
-		zNearPlane / d, 1
+		2 / (right - left), 0, 0, (left + right) / (left - right),
+		0, 2 / (top - bottom), 0, (top + bottom) / (bottom - top),
+		0, 0, 2 / d, (zNearPlane + zFarPlane) / d,
+		0, 0, 0, 1
 	);
 }
 
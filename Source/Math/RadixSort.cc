@@ -0,0 +1,238 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#include <cstring>
+#include "Math/RadixSort.h"
+#include "Math/Random.h"
+#include "Engine/Console.h"
+
+#include <QThread.h>
+#include <QElapsedTimer.h>
+#include <QtConcurrentMap.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                                   //
+//----------------------------------------------------------------------------//
+
+// Fewest keys worth handing to a worker
+static const quint32 MinKeysPerJob = 16384;
+
+// Bits sorted in every pass
+static const quint32 DigitBits  = 8;
+static const quint32 DigitCount = 1 << DigitBits;
+static const quint32 DigitMask  = DigitCount - 1;
+
+
+
+//----------------------------------------------------------------------------//
+// Constructors                                                     RadixSort //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+RadixSort::RadixSort (void)
+{
+	mCount		= 0;
+	mCurrent	= 0;
+	mShift		= 0;
+	mInput		= nullptr;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Methods                                                          RadixSort //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sorts the keys in ascending order. </summary>
+/// Keys must remain valid for the duration of the call
+
+void RadixSort::Sort (const float* keys, quint32 count)
+{
+	mCount   = count;
+	mCurrent = 0;
+	mInput   = keys;
+
+	for (quint32 i = 0; i < 2; ++i)
+	{
+		mKeys	[i].resize (count);
+		mIndices[i].resize (count);
+	}
+
+	if (count == 0) return;
+
+	// Split the keys into contiguous ranges
+	quint32 ranges = qBound<quint32> (1, count / MinKeysPerJob,
+		qMax (1, QThread::idealThreadCount()));
+	quint32 length = (count + ranges - 1) / ranges;
+
+	mJobs.resize (ranges);
+	for (quint32 i = 0; i < ranges; ++i)
+	{
+		mJobs[i].Owner = this;
+		mJobs[i].Range = i;
+		mJobs[i].Begin = qMin (i * length, count);
+		mJobs[i].End   = qMin (i * length + length, count);
+	}
+
+	mOffsets.resize (ranges * DigitCount);
+
+	if (ranges > 1)
+		QtConcurrent::blockingMap (mJobs, &SortJob::Convert);
+	else mJobs[0].Convert();
+
+	for (mShift = 0; mShift < 32; mShift += DigitBits)
+	{
+		// Count the digits of every range
+		if (ranges > 1)
+			QtConcurrent::blockingMap (mJobs, &SortJob::Count);
+		else mJobs[0].Count();
+
+		// Skip passes where every key shares the same digit
+		quint32* offsets = mOffsets.data();
+		quint32 digit = mKeys[mCurrent][0] >> mShift & DigitMask;
+
+		quint32 same = 0;
+		for (quint32 r = 0; r < ranges; ++r)
+			same += offsets[r * DigitCount + digit];
+
+		if (same == count) continue;
+
+		// Turn the counts into starting offsets, ordered by
+		// digit first and range second to keep the sort stable
+		quint32 total = 0;
+		for (quint32 d = 0; d < DigitCount; ++d)
+		{
+			for (quint32 r = 0; r < ranges; ++r)
+			{
+				quint32 c = offsets[r * DigitCount + d];
+				offsets[r * DigitCount + d] = total;
+				total += c;
+			}
+		}
+
+		if (ranges > 1)
+			QtConcurrent::blockingMap (mJobs, &SortJob::Scatter);
+		else mJobs[0].Scatter();
+
+		mCurrent = 1 - mCurrent;
+	}
+
+	mInput = nullptr;
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Static                                                           RadixSort //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Prints the time taken to sort random keys of
+/// 		  increasing counts to the console. </summary>
+
+void RadixSort::Benchmark (void)
+{
+	Random random;
+	RadixSort sort;
+	QElapsedTimer timer;
+
+	Console::Message ("\nRadix sort benchmark");
+	Console::Message ("--------------------");
+
+	for (quint32 count = 1024; count <= 1024 * 1024; count *= 4)
+	{
+		QVector<float> keys (count);
+		for (quint32 i = 0; i < count; ++i)
+			keys[i] = random.NextReal() * 2000.0f - 1000.0f;
+
+		// Take the best of several runs
+		qint64 best = -1;
+		for (quint32 run = 0; run < 5; ++run)
+		{
+			timer.start();
+			sort.Sort (keys.constData(), count);
+			qint64 elapsed = timer.nsecsElapsed();
+
+			if (best < 0 || elapsed < best)
+				best = elapsed;
+		}
+
+		Console::Message ("%8u keys: %8.3f ms", count, best / 1000000.0);
+	}
+}
+
+
+
+//----------------------------------------------------------------------------//
+// Internal                                                         RadixSort //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Maps a range of floats onto unsigned integers
+/// 		  which sort in the same order. </summary>
+
+void RadixSort::Convert (quint32 begin, quint32 end)
+{
+	quint32* keys	 = mKeys	[mCurrent].data();
+	quint32* indices = mIndices	[mCurrent].data();
+
+	for (quint32 i = begin; i < end; ++i)
+	{
+		quint32 bits;
+		memcpy (&bits, mInput + i, sizeof (quint32));
+
+		// Flip every bit of negative numbers, only the sign of positive ones
+		keys	[i] = bits ^ ((bits >> 31) != 0 ? 0xFFFFFFFF : 0x80000000);
+		indices	[i] = i;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RadixSort::Count (quint32 range, quint32 begin, quint32 end)
+{
+	const quint32* keys = mKeys[mCurrent].constData();
+
+	quint32* counts = mOffsets.data() + range * DigitCount;
+	memset (counts, 0, DigitCount * sizeof (quint32));
+
+	for (quint32 i = begin; i < end; ++i)
+		++counts[keys[i] >> mShift & DigitMask];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> </summary>
+
+void RadixSort::Scatter (quint32 range, quint32 begin, quint32 end)
+{
+	const quint32* keys		= mKeys		[mCurrent].constData();
+	const quint32* indices	= mIndices	[mCurrent].constData();
+
+	quint32* outKeys	= mKeys		[1 - mCurrent].data();
+	quint32* outIndices	= mIndices	[1 - mCurrent].data();
+
+	quint32* offsets = mOffsets.data() + range * DigitCount;
+
+	for (quint32 i = begin; i < end; ++i)
+	{
+		quint32 o = offsets[keys[i] >> mShift & DigitMask]++;
+		outKeys	  [o] = keys	[i];
+		outIndices[o] = indices	[i];
+	}
+}
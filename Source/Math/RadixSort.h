@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////
+// -------------------------------------------------------------------------- //
+//                                                                            //
+//                        (C) 2012-2013  David Krutsko                        //
+//                        See LICENSE.md for copyright                        //
+//                                                                            //
+// -------------------------------------------------------------------------- //
+////////////////////////////////////////////////////////////////////////////////
+
+//----------------------------------------------------------------------------//
+// Prefaces                                                                   //
+//----------------------------------------------------------------------------//
+
+#ifndef MATH_RADIX_SORT_H
+#define MATH_RADIX_SORT_H
+
+#include <QVector.h>
+
+
+
+//----------------------------------------------------------------------------//
+// Classes                                                                    //
+//----------------------------------------------------------------------------//
+
+////////////////////////////////////////////////////////////////////////////////
+/// <summary> Sorts float keys into an index order using a stable
+/// 		  least significant digit radix sort. </summary>
+/// Large inputs are counted and scattered in parallel ranges
+
+class RadixSort
+{
+private:
+	// Types
+	////////////////////////////////////////////////////////////////////////////////
+	/// <summary> Processes a range of keys on a worker thread. </summary>
+
+	class SortJob
+	{
+	public:
+		// Methods
+		void Convert	(void) { Owner->Convert (Begin, End); }
+		void Count		(void) { Owner->Count	(Range, Begin, End); }
+		void Scatter	(void) { Owner->Scatter	(Range, Begin, End); }
+
+	public:
+		// Properties
+		RadixSort*	Owner;			// Sort owning the buffers
+		quint32		Range;			// Index of this range
+		quint32		Begin;			// First key
+		quint32		End;			// One past the last key
+	};
+
+public:
+	// Constructors
+	RadixSort (void);
+
+public:
+	// Methods
+	void			Sort		(const float* keys, quint32 count);
+
+	const quint32*	GetIndices	(void) const { return mIndices[mCurrent].constData(); }
+	quint32			GetCount	(void) const { return mCount; }
+
+public:
+	// Static
+	static void		Benchmark	(void);
+
+private:
+	// Internal
+	void			Convert		(quint32 begin, quint32 end);
+	void			Count		(quint32 range, quint32 begin, quint32 end);
+	void			Scatter		(quint32 range, quint32 begin, quint32 end);
+
+private:
+	// Fields
+	quint32				mCount;			// Number of keys sorted
+	quint32				mCurrent;		// Buffers holding the latest pass
+	quint32				mShift;			// Digit of the current pass
+	const float*		mInput;			// Keys being sorted
+
+	QVector<quint32>	mKeys	[2];	// Ping-ponged sortable keys
+	QVector<quint32>	mIndices[2];	// Ping-ponged key indices
+	QVector<quint32>	mOffsets;		// Digit offsets of every range
+	QVector<SortJob>	mJobs;			// Ranges of the current sort
+};
+
+#endif // MATH_RADIX_SORT_H